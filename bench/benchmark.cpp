@@ -1,7 +1,12 @@
 #include "benchmark.hpp"
 
+#include <algorithm>
+#include <command_buffer.hpp>
+#include <query.hpp>
+#include <random>
 #include <registry.hpp>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace xecs;
@@ -38,6 +43,104 @@ struct Component
   uint64_t data2;
 };
 
+struct Team
+{
+  uint32_t id;
+};
+
+struct PagedEntity
+{};
+
+template<>
+struct xecs::entity_traits<PagedEntity> : entity_traits<unsigned int>
+{};
+
+template<>
+struct xecs::sparse_array_traits<PagedEntity> : default_sparse_array_traits
+{
+  static constexpr size_t page_size = 4096;
+};
+
+template<>
+struct xecs::storage_traits<archetype<
+  Component<10>,
+  Component<11>,
+  Component<12>,
+  Component<13>,
+  Component<14>,
+  Component<15>,
+  Component<16>,
+  Component<17>,
+  Component<18>,
+  Component<19>>> : default_storage_traits
+{
+  static constexpr bool huge_pages = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Team>> : default_storage_traits
+{
+  static constexpr size_t groups = 8;
+
+  using group_component = Team;
+
+  static size_t group(const Team& team) { return team.id; }
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Velocity, Component<31>>> : default_storage_traits
+{
+  static constexpr bool deferred_erase = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Velocity, Component<34>>> : default_storage_traits
+{
+  static constexpr bool ordered = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Component<32>>> : default_storage_traits
+{
+  static constexpr bool stable_addresses = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Component<35>>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Component<36>>> : default_storage_traits
+{
+  static constexpr size_t version_block = 1024;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Component<37>>> : default_storage_traits
+{
+  using dirty_components = list<Position>;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Component<38>>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Position, Color>> : default_storage_traits
+{
+  static constexpr bool enableable = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Velocity, Color>> : default_storage_traits
+{
+  static constexpr bool compact_disabled = true;
+};
+
 void Create_NoComponents()
 {
   using entity_type = unsigned int;
@@ -85,6 +188,33 @@ void Create_OneComponent()
   benchmark::do_not_optimize(registry.size());
 }
 
+void Create_OneComponent_Observed()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Component<35>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  size_t constructed = 0;
+
+  registry.on_construct<Component<35>>([&constructed](auto, auto&)
+    { ++constructed; });
+
+  const size_t iterations = 10000000;
+
+  BEGIN_BENCHMARK(Create_OneComponent_Observed);
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    benchmark::do_not_optimize(registry.create(Component<35> {}));
+  }
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(constructed);
+}
+
 void Create_OneComponentNonTrivial()
 {
   using entity_type = unsigned int;
@@ -788,32 +918,983 @@ void Iterate_WithSomeWork()
   benchmark::do_not_optimize(registry.size());
 }
 
-int main()
+void SwapArchetype_TwoComponents()
 {
-  Create_NoComponents();
-  Create_OneComponent();
-  Create_OneComponentNonTrivial();
-  Create_TwoComponents();
-  Create_ThreeComponents();
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::add<
+    archetype<Position, Velocity, Color>>::build;
 
-  Destroy_NoComponents();
-  Destroy_OneComponent();
-  Destroy_TwoComponents();
-  Destroy_ThreeComponents();
-  Destroy_TwoArchetypes();
-  Destroy_ThreeArchetypes();
-  Destroy_TenArchetypesTwoComponents();
-  Destroy_TenArchetypesTwoComponents_KnownTypes();
+  registry<entity_type, registered_archetypes> registry;
 
-  Iterate_STD_Vector_AsComparaison();
-  Iterate_NoComponents();
-  Iterate_OneComponent();
-  Iterate_TwoComponents();
-  Iterate_ThreeComponents();
-  Iterate_TenComponents();
-  Iterate_TenArchetypesNoComponents();
-  Iterate_STDVectorToCompare_WithSomeWork();
-  Iterate_WithSomeWork();
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Velocity {}));
+
+  BEGIN_BENCHMARK(SwapArchetype_TwoComponents);
+
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    registry.swap_archetype<Position, Velocity, Color>(entities[i]);
+  }
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void CommandBuffer_SwapArchetype_TwoComponents()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::add<
+    archetype<Position, Velocity, Color>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {}, Velocity {});
+
+  BEGIN_BENCHMARK(CommandBuffer_SwapArchetype_TwoComponents);
+
+  registry.for_each<Position, Velocity>([&commands](auto entity, auto&, auto&)
+    { commands.swap_archetype<Position, Velocity, Color>(entity); });
+
+  commands.flush();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void CommandBuffer_Add_OneComponent()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::add<
+    archetype<Position, Velocity, Color>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {}, Velocity {});
+
+  BEGIN_BENCHMARK(CommandBuffer_Add_OneComponent);
+
+  registry.for_each<Position, Velocity>([&commands](auto entity, auto&, auto&)
+    { commands.add(entity, Color {}); });
+
+  commands.flush();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void CommandBuffer_Create_OneComponent()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  const size_t iterations = 10000000;
+
+  BEGIN_BENCHMARK(CommandBuffer_Create_OneComponent);
+
+  for (size_t i = 0; i < iterations; i++) commands.create(Position {});
+
+  commands.flush();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void ConcurrentCommandBuffer_Destroy_FourSlots()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<entity_type, registered_archetypes, list<>, concurrent_entity_manager<entity_type>> registry;
+
+  concurrent_command_buffer commands { registry, 4 };
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {});
+
+  BEGIN_BENCHMARK(ConcurrentCommandBuffer_Destroy_FourSlots);
+
+  std::vector<std::thread> threads;
+
+  for (size_t slot = 0; slot < commands.slots(); slot++)
+  {
+    threads.emplace_back([&registry, &commands, slot]()
+      {
+        auto& local = commands.local(slot);
+
+        registry.for_each([&local, slot](auto entity)
+          {
+            if (entity % 4 == slot) local.destroy<Position>(entity);
+          });
+      });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  commands.flush();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void MigrateIf_TwoComponents()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::add<
+    archetype<Position, Velocity, Color>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {}, Velocity {});
+
+  BEGIN_BENCHMARK(MigrateIf_TwoComponents);
+
+  registry.view<Position, Velocity>().migrate_if<Position, Velocity, Color>([](auto, auto&, auto&)
+    { return true; });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Sort_ThreeComponents_Comparison()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<33>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 1000000;
+
+  std::mt19937 generator { 42 };
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {}, Velocity {}, Component<33> { generator() % 100000, 0 });
+
+  auto& storage = registry.access<archetype<Position, Velocity, Component<33>>>();
+
+  BEGIN_BENCHMARK(Sort_ThreeComponents_Comparison);
+
+  storage.sort([](auto lhs, auto rhs)
+    { return lhs.template unpack<Component<33>>().data1 < rhs.template unpack<Component<33>>().data1; });
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Sort_ThreeComponents_Radix()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<33>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 1000000;
+
+  std::mt19937 generator { 42 };
+
+  for (size_t i = 0; i < iterations; i++) registry.create(Position {}, Velocity {}, Component<33> { generator() % 100000, 0 });
+
+  BEGIN_BENCHMARK(Sort_ThreeComponents_Radix);
+
+  registry.view<Component<33>>().sort<Position, Velocity, Component<33>>([](auto, const auto& component)
+    { return component.data1; });
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Iterate_ChangedSince_OnePercent()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<36>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(Position {}, Component<36> {});
+  }
+
+  const auto since = registry.version();
+
+  registry.tick();
+
+  // One block out of a hundred is written
+  for (size_t i = 0; i < iterations; i += 1024 * 100)
+  {
+    registry.unpack<Position>(static_cast<entity_type>(i)).x = 1;
+  }
+
+  BEGIN_BENCHMARK(Iterate_ChangedSince_OnePercent);
+
+  registry.for_each_changed_since<Position, Component<36>>(since, [](auto entity, const auto& position, const auto& component)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(position);
+      benchmark::do_not_optimize(component);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_Dirty_Sparse()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<37>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 2000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(Position {}, Component<37> {});
+  }
+
+  registry.clear_dirty<Position>();
+
+  // Only 50 entities moved
+  for (size_t i = 0; i < iterations; i += iterations / 50)
+  {
+    registry.mark_dirty<Position>(static_cast<entity_type>(i));
+  }
+
+  BEGIN_BENCHMARK(Iterate_Dirty_Sparse);
+
+  registry.for_each_dirty<Position, Component<37>>([](auto entity, auto& position, auto& component)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(position);
+      benchmark::do_not_optimize(component);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_Filter_OnePercent()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<38>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(Position { i % 100 == 0 ? 1.0 : 0.0, 0 }, Component<38> {});
+  }
+
+  BEGIN_BENCHMARK(Iterate_Filter_OnePercent);
+
+  registry.for_each<Position, Component<38>>([](auto entity, auto& position, auto& component)
+    {
+      if (position.x > 0)
+      {
+        benchmark::do_not_optimize(entity);
+        benchmark::do_not_optimize(component);
+      }
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_CachedQuery_OnePercent()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<38>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(Position { i % 100 == 0 ? 1.0 : 0.0, 0 }, Component<38> {});
+  }
+
+  auto& query = registry.cache<Position, Component<38>>([](auto, const auto& position, const auto&)
+    { return position.x > 0; });
+
+  BEGIN_BENCHMARK(Iterate_CachedQuery_OnePercent);
+
+  query.for_each([](auto entity, auto& position, auto& component)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(position);
+      benchmark::do_not_optimize(component);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_MostlyDisabled()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Color>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    auto entity = registry.create(Position {}, Color {});
+
+    // Keep one entity out of ten enabled
+    if (i % 10 != 0) registry.disable(entity);
+  }
+
+  BEGIN_BENCHMARK(Iterate_MostlyDisabled);
+
+  registry.for_each<Position, Color>([](auto entity, auto& component, auto& color)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(component);
+      benchmark::do_not_optimize(color);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_MostlyDisabled_Compact()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Velocity, Color>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    auto entity = registry.create(Velocity {}, Color {});
+
+    // Keep one entity out of ten enabled
+    if (i % 10 != 0) registry.disable(entity);
+  }
+
+  BEGIN_BENCHMARK(Iterate_MostlyDisabled_Compact);
+
+  registry.for_each<Velocity, Color>([](auto entity, auto& component, auto& color)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(component);
+      benchmark::do_not_optimize(color);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_OneGroup()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Team>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(Position {}, Team { static_cast<uint32_t>(i % 8) });
+  }
+
+  BEGIN_BENCHMARK(Iterate_OneGroup);
+
+  registry.for_each_group<Position, Team>(3, [](auto entity, auto& position, auto& team)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(position);
+      benchmark::do_not_optimize(team);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Create_OneComponent_Paged()
+{
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<PagedEntity, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  BEGIN_BENCHMARK(Create_OneComponent_Paged);
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    benchmark::do_not_optimize(registry.create(Position {}));
+  }
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Destroy_OneComponent_Paged()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<PagedEntity, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}));
+
+  BEGIN_BENCHMARK(Destroy_OneComponent_Paged);
+
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    registry.destroy(entities[i]);
+  }
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Destroy_Random_ThreeComponents()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<30>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Velocity {}, Component<30> {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  // Destroy half of the entities, like a busy tick would
+  BEGIN_BENCHMARK(Destroy_Random_ThreeComponents);
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.destroy(entities[i]);
+  }
+
+  END_BENCHMARK(iterations / 2, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Destroy_Random_ThreeComponents_Deferred()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<31>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Velocity {}, Component<31> {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  // Includes the compaction
+  BEGIN_BENCHMARK(Destroy_Random_ThreeComponents_Deferred);
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.destroy(entities[i]);
+  }
+
+  registry.compact();
+
+  END_BENCHMARK(iterations / 2, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Churn_Random_ThreeComponents_Deferred()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<31>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Velocity {}, Component<31> {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  // Recycled entities are created out of order, includes the compaction
+  BEGIN_BENCHMARK(Churn_Random_ThreeComponents_Deferred);
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.destroy(entities[i]);
+  }
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.create(Position {}, Velocity {}, Component<31> {});
+  }
+
+  registry.compact();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Churn_Random_ThreeComponents_Ordered()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity, Component<34>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 1000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Velocity {}, Component<34> {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  // Recycled entities are created out of order, includes the compaction
+  BEGIN_BENCHMARK(Churn_Random_ThreeComponents_Ordered);
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.destroy(entities[i]);
+  }
+
+  for (size_t i = 0; i < entities.size() / 2; i++)
+  {
+    registry.create(Position {}, Velocity {}, Component<34> {});
+  }
+
+  registry.compact();
+
+  END_BENCHMARK(iterations, 1);
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Unpack_Random()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  BEGIN_BENCHMARK(Unpack_Random);
+
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    benchmark::do_not_optimize(registry.unpack<Position>(entities[i]));
+  }
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Unpack_Random_Stable()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<32>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}, Component<32> {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  BEGIN_BENCHMARK(Unpack_Random_Stable);
+
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    benchmark::do_not_optimize(registry.unpack<Position>(entities[i]));
+  }
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Unpack_Random_CachedPointers()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Component<32>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<Position*> positions {};
+
+  const size_t iterations = 10000000;
+
+  // Addresses are stable, so they can be kept while creating
+  for (size_t i = 0; i < iterations; i++) positions.push_back(&registry.unpack<Position>(registry.create(Position {}, Component<32> {})));
+
+  std::shuffle(positions.begin(), positions.end(), std::mt19937 { 42 });
+
+  BEGIN_BENCHMARK(Unpack_Random_CachedPointers);
+
+  for (size_t i = 0; i < positions.size(); i++)
+  {
+    benchmark::do_not_optimize(*positions[i]);
+  }
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Unpack_Random_Paged()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position>>::build;
+
+  registry<PagedEntity, registered_archetypes> registry;
+
+  std::vector<entity_type> entities {};
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++) entities.push_back(registry.create(Position {}));
+
+  std::shuffle(entities.begin(), entities.end(), std::mt19937 { 42 });
+
+  BEGIN_BENCHMARK(Unpack_Random_Paged);
+
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    benchmark::do_not_optimize(registry.unpack<Position>(entities[i]));
+  }
+
+  END_BENCHMARK(iterations, 1);
+}
+
+void Iterate_TenComponents_RegularPages()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<
+      Component<20>,
+      Component<21>,
+      Component<22>,
+      Component<23>,
+      Component<24>,
+      Component<25>,
+      Component<26>,
+      Component<27>,
+      Component<28>,
+      Component<29>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(
+      Component<20> {},
+      Component<21> {},
+      Component<22> {},
+      Component<23> {},
+      Component<24> {},
+      Component<25> {},
+      Component<26> {},
+      Component<27> {},
+      Component<28> {},
+      Component<29> {});
+  }
+
+  benchmark::tlb_counter tlb;
+
+  BEGIN_BENCHMARK(Iterate_TenComponents_RegularPages);
+
+  registry.for_each<
+    Component<20>,
+    Component<21>,
+    Component<22>,
+    Component<23>,
+    Component<24>,
+    Component<25>,
+    Component<26>,
+    Component<27>,
+    Component<28>,
+    Component<29>>(
+    [](auto entity, auto& c0, auto& c1, auto& c2, auto& c3, auto& c4, auto& c5, auto& c6, auto& c7, auto& c8, auto& c9)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(c0);
+      benchmark::do_not_optimize(c1);
+      benchmark::do_not_optimize(c2);
+      benchmark::do_not_optimize(c3);
+      benchmark::do_not_optimize(c4);
+      benchmark::do_not_optimize(c5);
+      benchmark::do_not_optimize(c6);
+      benchmark::do_not_optimize(c7);
+      benchmark::do_not_optimize(c8);
+      benchmark::do_not_optimize(c9);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  tlb.print();
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void Iterate_TenComponents_HugePages()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<
+      Component<10>,
+      Component<11>,
+      Component<12>,
+      Component<13>,
+      Component<14>,
+      Component<15>,
+      Component<16>,
+      Component<17>,
+      Component<18>,
+      Component<19>>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t iterations = 10000000;
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    registry.create(
+      Component<10> {},
+      Component<11> {},
+      Component<12> {},
+      Component<13> {},
+      Component<14> {},
+      Component<15> {},
+      Component<16> {},
+      Component<17> {},
+      Component<18> {},
+      Component<19> {});
+  }
+
+  benchmark::tlb_counter tlb;
+
+  BEGIN_BENCHMARK(Iterate_TenComponents_HugePages);
+
+  registry.for_each<
+    Component<10>,
+    Component<11>,
+    Component<12>,
+    Component<13>,
+    Component<14>,
+    Component<15>,
+    Component<16>,
+    Component<17>,
+    Component<18>,
+    Component<19>>(
+    [](auto entity, auto& c0, auto& c1, auto& c2, auto& c3, auto& c4, auto& c5, auto& c6, auto& c7, auto& c8, auto& c9)
+    {
+      benchmark::do_not_optimize(entity);
+      benchmark::do_not_optimize(c0);
+      benchmark::do_not_optimize(c1);
+      benchmark::do_not_optimize(c2);
+      benchmark::do_not_optimize(c3);
+      benchmark::do_not_optimize(c4);
+      benchmark::do_not_optimize(c5);
+      benchmark::do_not_optimize(c6);
+      benchmark::do_not_optimize(c7);
+      benchmark::do_not_optimize(c8);
+      benchmark::do_not_optimize(c9);
+    });
+
+  END_BENCHMARK(iterations, 1);
+
+  tlb.print();
+
+  benchmark::do_not_optimize(registry.size());
+}
+
+void EntityManager_GenerateRelease()
+{
+  using entity_type = unsigned int;
+
+  entity_manager<entity_type> manager;
+
+  const size_t iterations = 10000000;
+
+  std::vector<entity_type> entities(iterations);
+
+  BEGIN_BENCHMARK(EntityManager_GenerateRelease);
+
+  for (size_t i = 0; i < iterations; i++) entities[i] = manager.generate();
+  for (size_t i = 0; i < iterations; i++) manager.release(entities[i]);
+  for (size_t i = 0; i < iterations; i++) entities[i] = manager.generate();
+
+  END_BENCHMARK(iterations, 3);
+
+  benchmark::do_not_optimize(entities.data());
+}
+
+void EntityManager_GenerateRelease_Batch()
+{
+  using entity_type = unsigned int;
+
+  entity_manager<entity_type> manager;
+
+  const size_t iterations = 10000000;
+
+  std::vector<entity_type> entities(iterations);
+
+  BEGIN_BENCHMARK(EntityManager_GenerateRelease_Batch);
+
+  manager.generate(entities.data(), iterations);
+  manager.release(entities.data(), iterations);
+  manager.generate(entities.data(), iterations);
+
+  END_BENCHMARK(iterations, 3);
+
+  benchmark::do_not_optimize(entities.data());
+}
+
+int main()
+{
+  Create_NoComponents();
+  Create_OneComponent();
+  Create_OneComponent_Observed();
+  Create_OneComponentNonTrivial();
+  Create_TwoComponents();
+  Create_ThreeComponents();
+
+  Destroy_NoComponents();
+  Destroy_OneComponent();
+  Destroy_TwoComponents();
+  Destroy_ThreeComponents();
+  Destroy_TwoArchetypes();
+  Destroy_ThreeArchetypes();
+  Destroy_TenArchetypesTwoComponents();
+  Destroy_TenArchetypesTwoComponents_KnownTypes();
+
+  Iterate_STD_Vector_AsComparaison();
+  Iterate_NoComponents();
+  Iterate_OneComponent();
+  Iterate_TwoComponents();
+  Iterate_ThreeComponents();
+  Iterate_TenComponents();
+  Iterate_TenArchetypesNoComponents();
+  Iterate_STDVectorToCompare_WithSomeWork();
+  Iterate_WithSomeWork();
+
+  SwapArchetype_TwoComponents();
+  MigrateIf_TwoComponents();
+  CommandBuffer_SwapArchetype_TwoComponents();
+  CommandBuffer_Add_OneComponent();
+  CommandBuffer_Create_OneComponent();
+  ConcurrentCommandBuffer_Destroy_FourSlots();
+
+  Sort_ThreeComponents_Comparison();
+  Sort_ThreeComponents_Radix();
+
+  Iterate_ChangedSince_OnePercent();
+  Iterate_Dirty_Sparse();
+  Iterate_Filter_OnePercent();
+  Iterate_CachedQuery_OnePercent();
+  Iterate_MostlyDisabled();
+  Iterate_MostlyDisabled_Compact();
+  Iterate_OneGroup();
+
+  EntityManager_GenerateRelease();
+  EntityManager_GenerateRelease_Batch();
+
+  Create_OneComponent_Paged();
+  Destroy_OneComponent_Paged();
+  Destroy_Random_ThreeComponents();
+  Destroy_Random_ThreeComponents_Deferred();
+  Churn_Random_ThreeComponents_Deferred();
+  Churn_Random_ThreeComponents_Ordered();
+  Unpack_Random();
+  Unpack_Random_Paged();
+  Unpack_Random_Stable();
+  Unpack_Random_CachedPointers();
+
+  Iterate_TenComponents_RegularPages();
+  Iterate_TenComponents_HugePages();
 
   return 0;
 }
\ No newline at end of file
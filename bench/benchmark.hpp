@@ -2,9 +2,17 @@
 #define XECS_BENCHMARK_HPP
 
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+#if __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace benchmark
 {
 using clock_t = std::chrono::high_resolution_clock;
@@ -40,6 +48,55 @@ inline void do_not_optimize(T const&)
 {}
 #endif
 
+// Counts the data TLB load misses of the calling thread from construction
+// Only available on linux when performance counters are accessible
+
+class tlb_counter
+{
+public:
+  tlb_counter()
+  {
+#if __linux__
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HW_CACHE;
+    attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    _descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+  }
+
+  ~tlb_counter()
+  {
+#if __linux__
+    if (_descriptor != -1) close(_descriptor);
+#endif
+  }
+
+  tlb_counter(const tlb_counter&) = delete;
+  tlb_counter& operator=(const tlb_counter&) = delete;
+
+  void print() const
+  {
+    long long misses = -1;
+
+#if __linux__
+    if (_descriptor != -1 && read(_descriptor, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+#endif
+
+    if (misses < 0) std::cout << "[ DTLB    ] unavailable" << std::endl;
+    else
+      std::cout << "[ DTLB    ] " << misses << " misses" << std::endl;
+  }
+
+private:
+  int _descriptor = -1;
+};
+
 } // namespace benchmark
 
 // NOLINTNEXTLINE
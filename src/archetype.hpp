@@ -235,6 +235,118 @@ struct push_back<Type, List<Types...>>
 template<typename Type, typename List>
 using push_back_t = typename push_back<Type, List>::type;
 
+/**
+ * @brief Removes every occurence of a type from a list.
+ * 
+ * @tparam Type Type to remove
+ * @tparam List List to remove type from
+ */
+template<typename Type, typename List>
+struct remove;
+
+template<typename Type, typename... Types, template<typename...> class List>
+struct remove<Type, List<Types...>>
+{
+  using type = List<>;
+};
+
+template<typename Type, typename Head, typename... Types, template<typename...> class List>
+struct remove<Type, List<Head, Types...>>
+{
+private:
+  using next = typename remove<Type, List<Types...>>::type;
+
+public:
+  using type = typename std::conditional_t<std::is_same_v<Type, Head>, next, typename push_front<Head, next>::type>;
+};
+
+template<typename Type, typename List>
+using remove_t = typename remove<Type, List>::type;
+
+/**
+ * @brief Keeps the types of a list that are not contained by another list.
+ * 
+ * @tparam List List to filter
+ * @tparam OtherList Types to remove
+ */
+template<typename List, typename OtherList>
+struct difference;
+
+template<typename OtherList, template<typename...> class List>
+struct difference<List<>, OtherList>
+{
+  using type = List<>;
+};
+
+template<typename Head, typename... Types, template<typename...> class List, typename OtherList>
+struct difference<List<Head, Types...>, OtherList>
+{
+private:
+  using next = typename difference<List<Types...>, OtherList>::type;
+
+public:
+  using type = typename std::conditional_t<contains_v<Head, OtherList>, next, typename push_front<Head, next>::type>;
+};
+
+template<typename List, typename OtherList>
+using difference_t = typename difference<List, OtherList>::type;
+
+/**
+ * @brief Keeps the types of a list that are also contained by another list.
+ * 
+ * @tparam List List to filter
+ * @tparam OtherList Types to keep
+ */
+template<typename List, typename OtherList>
+struct intersection;
+
+template<typename OtherList, template<typename...> class List>
+struct intersection<List<>, OtherList>
+{
+  using type = List<>;
+};
+
+template<typename Head, typename... Types, template<typename...> class List, typename OtherList>
+struct intersection<List<Head, Types...>, OtherList>
+{
+private:
+  using next = typename intersection<List<Types...>, OtherList>::type;
+
+public:
+  using type = typename std::conditional_t<contains_v<Head, OtherList>, typename push_front<Head, next>::type, next>;
+};
+
+template<typename List, typename OtherList>
+using intersection_t = typename intersection<List, OtherList>::type;
+
+/**
+ * @brief Keeps the types of a list that satisfy a predicate.
+ * 
+ * @tparam Predicate Template that has a boolean value member for a type
+ * @tparam List List to filter
+ */
+template<template<typename> class Predicate, typename List>
+struct filter;
+
+template<template<typename> class Predicate, template<typename...> class List>
+struct filter<Predicate, List<>>
+{
+  using type = List<>;
+};
+
+template<template<typename> class Predicate, typename Head, typename... Types, template<typename...> class List>
+struct filter<Predicate, List<Head, Types...>>
+{
+private:
+  using next = typename filter<Predicate, List<Types...>>::type;
+
+public:
+  using type = typename std::conditional_t<Predicate<Head>::value, typename push_front<Head, next>::type, next>;
+};
+
+template<template<typename> class Predicate, typename List>
+using filter_t = typename filter<Predicate, List>::type;
+
 /**
  * @brief Finds the first occurence of a list that.
  * 
@@ -268,6 +380,113 @@ public:
 template<typename ListOfLists, typename... RequiredTypes>
 using find_for_t = typename find_for<ListOfLists, RequiredTypes...>::type;
 
+/**
+ * @brief Checks if a list of lists contains a list with the exact same types as another list.
+ * 
+ * Unlike find_for, this can tell the difference between an empty list that was found and
+ * a list that was not found.
+ * 
+ * @tparam ListOfLists A List of lists to search
+ * @tparam List List with the exact types to search for
+ */
+template<typename ListOfLists, typename List>
+struct contains_same;
+
+template<typename... Lists, template<typename...> class ListOfLists, typename List>
+struct contains_same<ListOfLists<Lists...>, List> : std::disjunction<is_same_types<Lists, List>...>
+{};
+
+template<typename ListOfLists, typename List>
+constexpr auto contains_same_v = contains_same<ListOfLists, List>::value;
+
+/**
+ * @brief Finds the first occurence of a list with the exact same types as another list.
+ * 
+ * Same as find_for but takes the types as a list.
+ * 
+ * @tparam ListOfLists A List of lists to search
+ * @tparam List List with the exact types to search for
+ */
+template<typename ListOfLists, typename List>
+struct find_same;
+
+template<typename ListOfLists, typename... Types, template<typename...> class List>
+struct find_same<ListOfLists, List<Types...>> : find_for<ListOfLists, Types...>
+{};
+
+template<typename ListOfLists, typename List>
+using find_same_t = typename find_same<ListOfLists, List>::type;
+
+/**
+ * @brief Keeps all lists that do not contain the type and for which the list with the type
+ * added is also part of the list of lists.
+ * 
+ * This is used to resolve add operations between archetypes at compile time.
+ * 
+ * @tparam Type The type to add
+ * @tparam ListOfLists A List of lists to prune
+ * @tparam Candidates Lists left to check during recursion (defaults to the list of lists)
+ */
+template<typename Type, typename ListOfLists, typename Candidates = ListOfLists>
+struct prune_for_add;
+
+template<typename Type, typename ListOfLists, template<typename...> class Candidates>
+struct prune_for_add<Type, ListOfLists, Candidates<>>
+{
+  using type = list<>;
+};
+
+template<typename Type, typename ListOfLists, typename HeadList, typename... Lists, template<typename...> class Candidates>
+struct prune_for_add<Type, ListOfLists, Candidates<HeadList, Lists...>>
+{
+private:
+  using next = typename prune_for_add<Type, ListOfLists, Candidates<Lists...>>::type;
+  using accept = typename push_front<HeadList, next>::type;
+
+  static constexpr bool valid = !contains_v<Type, HeadList> && contains_same_v<ListOfLists, push_back_t<Type, HeadList>>;
+
+public:
+  using type = typename std::conditional_t<valid, accept, next>;
+};
+
+template<typename Type, typename ListOfLists>
+using prune_for_add_t = typename prune_for_add<Type, ListOfLists>::type;
+
+/**
+ * @brief Keeps all lists that contain the type and for which the list with the type
+ * removed is also part of the list of lists.
+ * 
+ * This is used to resolve remove operations between archetypes at compile time.
+ * 
+ * @tparam Type The type to remove
+ * @tparam ListOfLists A List of lists to prune
+ * @tparam Candidates Lists left to check during recursion (defaults to the list of lists)
+ */
+template<typename Type, typename ListOfLists, typename Candidates = ListOfLists>
+struct prune_for_remove;
+
+template<typename Type, typename ListOfLists, template<typename...> class Candidates>
+struct prune_for_remove<Type, ListOfLists, Candidates<>>
+{
+  using type = list<>;
+};
+
+template<typename Type, typename ListOfLists, typename HeadList, typename... Lists, template<typename...> class Candidates>
+struct prune_for_remove<Type, ListOfLists, Candidates<HeadList, Lists...>>
+{
+private:
+  using next = typename prune_for_remove<Type, ListOfLists, Candidates<Lists...>>::type;
+  using accept = typename push_front<HeadList, next>::type;
+
+  static constexpr bool valid = contains_v<Type, HeadList> && contains_same_v<ListOfLists, remove_t<Type, HeadList>>;
+
+public:
+  using type = typename std::conditional_t<valid, accept, next>;
+};
+
+template<typename Type, typename ListOfLists>
+using prune_for_remove_t = typename prune_for_remove<Type, ListOfLists>::type;
+
 /**
  * @brief Removes all lists that do not contains the required types.
  * 
@@ -301,6 +520,24 @@ public:
 template<typename ListOfLists, typename... RequiredTypes>
 using prune_for_t = typename prune_for<ListOfLists, RequiredTypes...>::type;
 
+/**
+ * @brief Removes all lists that do not contains the required types.
+ * 
+ * Same as prune_for but takes the required types as a list.
+ * 
+ * @tparam ListOfLists A List of lists to prune
+ * @tparam List List of types that must be present in the list
+ */
+template<typename ListOfLists, typename List>
+struct prune_for_list;
+
+template<typename ListOfLists, typename... Types, template<typename...> class List>
+struct prune_for_list<ListOfLists, List<Types...>> : prune_for<ListOfLists, Types...>
+{};
+
+template<typename ListOfLists, typename List>
+using prune_for_list_t = typename prune_for_list<ListOfLists, List>::type;
+
 /**
  * @brief Assert's a component to verify that is is valid.
  * 
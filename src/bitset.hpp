@@ -0,0 +1,301 @@
+#ifndef XECS_BITSET_HPP
+#define XECS_BITSET_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if _MSC_VER
+#include <intrin.h> // For _BitScanForward64 and _BitScanReverse64
+#endif
+
+namespace xecs
+{
+/**
+ * @brief Returns the index of the lowest set bit of a word.
+ * 
+ * @warning Undefined behaviour if the word is zero.
+ * 
+ * @param word Word to scan
+ * @return size_t Index of the lowest set bit
+ */
+inline size_t lowest_bit(const uint64_t word)
+{
+#if _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return static_cast<size_t>(index);
+#else
+  return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+}
+
+/**
+ * @brief Returns the index of the highest set bit of a word.
+ * 
+ * @warning Undefined behaviour if the word is zero.
+ * 
+ * @param word Word to scan
+ * @return size_t Index of the highest set bit
+ */
+inline size_t highest_bit(const uint64_t word)
+{
+#if _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, word);
+  return static_cast<size_t>(index);
+#else
+  return static_cast<size_t>(63 - __builtin_clzll(word));
+#endif
+}
+
+/**
+ * @brief Resizable array of bits.
+ * 
+ * Bits are packed in 64 bit words so that they can be scanned a whole word at a time. This is used
+ * for the masks of the storages, where most of the time entire words are either all set or all cleared.
+ * 
+ * New bits are always cleared. The bitset never shrinks by itself.
+ */
+class bitset final
+{
+public:
+  using word_type = uint64_t;
+  using size_type = size_t;
+
+  /**
+   * @brief Amount of bits in a word.
+   */
+  static constexpr size_type word_bits = 64;
+
+  /**
+   * @brief Construct a new bitset object
+   */
+  bitset()
+    : _words(NULL), _size(0)
+  {}
+
+  /**
+   * @brief Destroy the bitset object
+   */
+  ~bitset()
+  {
+    if (_words) free(_words);
+  }
+
+  bitset(const bitset&) = delete;
+  bitset(bitset&&) = delete;
+  bitset& operator=(const bitset&) = delete;
+  bitset& operator=(bitset&&) = delete;
+
+  /**
+   * @brief Resizes the bitset to be able to contain at least the specified amount of bits.
+   * 
+   * Added bits are cleared. Bits over the amount are discarded when shrinking.
+   * 
+   * @param bits Amount of bits
+   */
+  void resize(const size_type bits)
+  {
+    const size_type size = (bits + word_bits - 1) / word_bits;
+
+    if (size == 0)
+    {
+      if (_words) free(_words);
+
+      _words = NULL;
+      _size = 0;
+    }
+    else if (size != _size)
+    {
+      _words = static_cast<word_type*>(std::realloc(_words, size * sizeof(word_type)));
+
+      if (size > _size) std::memset(_words + _size, 0, (size - _size) * sizeof(word_type));
+
+      _size = size;
+    }
+  }
+
+  /**
+   * @brief Sets the bit at the specified index.
+   * 
+   * @param index Index of the bit
+   */
+  void set(const size_type index) { _words[index / word_bits] |= word_type { 1 } << (index % word_bits); }
+
+  /**
+   * @brief Clears the bit at the specified index.
+   * 
+   * @param index Index of the bit
+   */
+  void reset(const size_type index) { _words[index / word_bits] &= ~(word_type { 1 } << (index % word_bits)); }
+
+  /**
+   * @brief Sets or clears the bit at the specified index.
+   * 
+   * @param index Index of the bit
+   * @param value Value of the bit
+   */
+  void assign(const size_type index, const bool value)
+  {
+    if (value) set(index);
+    else
+      reset(index);
+  }
+
+  /**
+   * @brief Returns whether or not the bit at the specified index is set.
+   * 
+   * @param index Index of the bit
+   * @return true If the bit is set, false otherwise
+   */
+  [[nodiscard]] bool test(const size_type index) const
+  {
+    return (_words[index / word_bits] >> (index % word_bits)) & 1;
+  }
+
+  /**
+   * @brief Clears every bit.
+   */
+  void clear()
+  {
+    if (_words) std::memset(_words, 0, _size * sizeof(word_type));
+  }
+
+  /**
+   * @brief Returns the word at the specified word index.
+   * 
+   * @param index Index of the word
+   * @return word_type Word of bits
+   */
+  [[nodiscard]] word_type word(const size_type index) const { return _words[index]; }
+
+  /*! @copydoc word */
+  [[nodiscard]] word_type& word(const size_type index) { return _words[index]; }
+
+  /**
+   * @brief Returns the amount of words.
+   * 
+   * @return size_type Amount of words
+   */
+  [[nodiscard]] size_type words() const { return _size; }
+
+private:
+  word_type* _words;
+  size_type _size;
+};
+
+/**
+ * @brief Array of bits that are mostly cleared, with a summary of the words that may have set bits.
+ * 
+ * Every word of bits has a bit in the summary, that is set with any of its bits. Scanning and clearing
+ * then only go through the summary and the words that had bits set, so they cost about the amount of set
+ * bits instead of the size of the bitset. Summary bits of words that were emptied by reset are dropped
+ * lazily by the next scan.
+ */
+class summary_bitset final
+{
+public:
+  using word_type = bitset::word_type;
+  using size_type = bitset::size_type;
+
+  /*! @copydoc bitset::word_bits */
+  static constexpr size_type word_bits = bitset::word_bits;
+
+  /**
+   * @brief Resizes the bitset to be able to contain at least the specified amount of bits.
+   * 
+   * Added bits are cleared.
+   * 
+   * @param bits Amount of bits
+   */
+  void resize(const size_type bits)
+  {
+    const size_type words = (bits + word_bits - 1) / word_bits;
+
+    _bits.resize(bits);
+    _summary.resize(words);
+
+    // The last summary word may still summarize words that were dropped
+    if (words % word_bits) _summary.word(words / word_bits) &= (word_type { 1 } << (words % word_bits)) - 1;
+  }
+
+  /*! @copydoc bitset::set */
+  void set(const size_type index)
+  {
+    _bits.set(index);
+    _summary.set(index / word_bits);
+  }
+
+  /*! @copydoc bitset::reset */
+  void reset(const size_type index) { _bits.reset(index); }
+
+  /*! @copydoc bitset::assign */
+  void assign(const size_type index, const bool value)
+  {
+    if (value) set(index);
+    else
+      reset(index);
+  }
+
+  /*! @copydoc bitset::test */
+  [[nodiscard]] bool test(const size_type index) const { return _bits.test(index); }
+
+  /**
+   * @brief Clears every bit, only the words that had bits set are written.
+   */
+  void clear()
+  {
+    for (size_type s = 0; s < _summary.words(); s++)
+    {
+      auto& summary = _summary.word(s);
+
+      while (summary)
+      {
+        const size_type bit = lowest_bit(summary);
+
+        _bits.word(s * word_bits + bit) = 0;
+
+        summary &= summary - 1;
+      }
+    }
+  }
+
+  /**
+   * @brief Calls the function with every word that has set bits, in decreasing order of words.
+   * 
+   * The function is invoked with the index of the word and a copy of the word, it can modify the bitset.
+   * 
+   * @tparam Function Function type
+   * @param function Function invoked with the index of every word and the word
+   */
+  template<typename Function>
+  void each(const Function& function)
+  {
+    for (size_type s = _summary.words(); s-- > 0;)
+    {
+      auto summary = _summary.word(s);
+
+      while (summary)
+      {
+        const size_type bit = highest_bit(summary);
+        const size_type w = s * word_bits + bit;
+
+        summary &= ~(word_type { 1 } << bit);
+
+        const word_type word = _bits.word(w);
+
+        if (word) function(w, word);
+        else
+          _summary.reset(w);
+      }
+    }
+  }
+
+private:
+  bitset _bits;
+  bitset _summary;
+};
+} // namespace xecs
+
+#endif
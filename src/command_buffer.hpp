@@ -0,0 +1,1019 @@
+#ifndef XECS_COMMAND_BUFFER_HPP
+#define XECS_COMMAND_BUFFER_HPP
+
+#include "bitset.hpp"
+#include "registry.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Records structural changes to apply them later on a registry.
+ * 
+ * Creating, destroying or changing the archetype of entities while iterating a view moves the rows of the storages
+ * being iterated, so rows would be skipped or visited twice. Instead, record the changes in a command buffer and
+ * flush it after the iteration.
+ * 
+ * @code{.cpp}
+ * xecs::command_buffer commands { registry };
+ * 
+ * registry.for_each<Health>([&](auto entity, auto& health)
+ *   {
+ *     if (health.value <= 0) commands.destroy<Health>(entity);
+ *   });
+ * 
+ * commands.flush();
+ * @endcode
+ * 
+ * Commands are stored compactly, a small record per command and the components in an arena of blocks that are
+ * reused from one flush to the next. The entities of created entities are reserved right away, so they can be used
+ * by the following commands.
+ * 
+ * When flushed, the commands are grouped by operation with a counting sort, then every group is applied at once.
+ * Creations are grouped by archetype and inserted after growing the storage once. Other groups are split by the
+ * archetype of their entities, the entities of each archetype are partitioned to the back of its storage and moved
+ * or erased together with one copy per component (see storage::transfer_back). Creations are applied first,
+ * then archetype changes and finally destructions. Archetype changes
+ * of the same entity are applied in the order they were recorded. Groups are applied in the order they were first
+ * recorded, so flushing the same commands always produces the same storages.
+ * 
+ * @tparam Registry Registry type to apply the commands on
+ */
+template<typename Registry>
+class command_buffer
+{
+public:
+  using registry_type = Registry;
+  using traits_type = typename registry_type::traits_type;
+  using entity_type = typename registry_type::entity_type;
+  using archetype_list_type = typename registry_type::archetype_list_type;
+  using size_type = size_t;
+
+private:
+  struct command;
+
+  /**
+   * @brief Describes how to apply a kind of command.
+   */
+  struct operation
+  {
+    /**
+     * @brief Commands are applied in increasing phases.
+     */
+    uint32_t phase;
+
+    /**
+     * @brief Applies a group of commands with this operation.
+     */
+    void (*apply)(registry_type&, const command*, size_type);
+
+    /**
+     * @brief Destroys the components of a command that will never be applied, NULL if trivial.
+     */
+    void (*discard)(char*);
+  };
+
+  /**
+   * @brief Record of a command.
+   */
+  struct command
+  {
+    char* payload;
+    entity_type entity;
+    uint32_t group;
+  };
+
+  /**
+   * @brief Block of the arena.
+   */
+  struct block
+  {
+    char* memory;
+    size_type size;
+  };
+
+  /**
+   * @brief Minimum size of a block of the arena.
+   */
+  static constexpr size_type block_size = 16384;
+
+  static constexpr uint32_t create_phase = 0;
+  static constexpr uint32_t change_phase = 1;
+  static constexpr uint32_t destroy_phase = 2;
+
+public:
+  /**
+   * @brief Construct a new command buffer object
+   * 
+   * @param registry Registry to apply the commands on
+   */
+  explicit command_buffer(registry_type& registry)
+    : _registry(&registry), _commands(NULL), _sorted(NULL), _size(0), _capacity(0), _groups(NULL), _groups_size(0),
+      _groups_capacity(0), _last(0), _blocks(NULL), _blocks_size(0), _block(0), _used(0)
+  {}
+
+  /**
+   * @brief Destroy the command buffer object, the commands that were not flushed are discarded.
+   */
+  ~command_buffer()
+  {
+    clear();
+
+    if (_commands) free(_commands);
+    if (_sorted) free(_sorted);
+    if (_groups) free(_groups);
+
+    for (size_type i = 0; i < _blocks_size; i++) free(_blocks[i].memory);
+
+    if (_blocks) free(_blocks);
+  }
+
+  command_buffer(const command_buffer&) = delete;
+  command_buffer(command_buffer&&) = delete;
+  command_buffer& operator=(const command_buffer&) = delete;
+  command_buffer& operator=(command_buffer&&) = delete;
+
+  /**
+   * @brief Records the creation of an entity with the given components.
+   * 
+   * The entity is reserved right away (see registry::reserve) but only exists in the registry once flushed.
+   * 
+   * @tparam Components The exact component types of one of the registry archetypes
+   * @param components The components to initialize with
+   * @return entity_type The reserved entity's identifier
+   */
+  template<typename... Components>
+  entity_type create(const Components&... components)
+  {
+    using current = find_for_t<archetype_list_type, Components...>;
+
+    static_assert(size_v<current> == sizeof...(Components),
+      "Registry does not contain suitable archetype for provided components");
+
+    const entity_type entity = _registry->reserve();
+
+    record<create_operation<current, Components...>>(entity, components...);
+
+    return entity;
+  }
+
+  /**
+   * @brief Records the destruction of an entity.
+   * 
+   * @tparam Components Component types that you know this entity's archetype has (see registry::destroy)
+   * @param entity The entity to destroy
+   */
+  template<typename... Components>
+  void destroy(const entity_type entity)
+  {
+    static_assert(size_v<prune_for_t<archetype_list_type, Components...>> > 0,
+      "Registry does not contain suitable archetype for provided components");
+
+    record<destroy_operation<Components...>>(entity);
+  }
+
+  /**
+   * @brief Records adding a component to an entity (see registry::add).
+   * 
+   * @tparam Component The component type to add
+   * @param entity The entity to add the component to
+   * @param component The value of the added component
+   */
+  template<typename Component>
+  void add(const entity_type entity, const Component& component)
+  {
+    record<add_operation<Component>>(entity, component);
+  }
+
+  /**
+   * @brief Records removing a component from an entity (see registry::remove).
+   * 
+   * @tparam Component The component type to remove
+   * @param entity The entity to remove the component from
+   */
+  template<typename Component>
+  void remove(const entity_type entity)
+  {
+    record<remove_operation<Component>>(entity);
+  }
+
+  /**
+   * @brief Records changing the archetype of an entity (see registry::swap_archetype).
+   * 
+   * Swaps to the same archetype are applied together as a single migration.
+   * 
+   * @tparam SwapComponents The components of the archetype to swap to
+   * @param entity The entity to swap archetype for
+   */
+  template<typename... SwapComponents>
+  void swap_archetype(const entity_type entity)
+  {
+    static_assert(size_v<prune_for_t<archetype_list_type, SwapComponents...>> > 0,
+      "The archetype to swap to does not exist.");
+
+    record<swap_operation<SwapComponents...>>(entity);
+  }
+
+  /**
+   * @brief Applies every recorded command on the registry and clears the buffer.
+   * 
+   * @warning Must not be called while a view of the registry is being iterated.
+   */
+  void flush()
+  {
+    if (_size == 0) return;
+
+    uint32_t* generations = number_changes();
+
+    const size_type generation_count = generations ? *std::max_element(generations, generations + _size) + 1 : 1;
+
+    // Buckets are ordered by phase, then generation, then group
+    const size_type bucket_count = (generation_count + 2) * _groups_size;
+
+    size_type* counts = static_cast<size_type*>(std::calloc(bucket_count * 2, sizeof(size_type)));
+    size_type* offsets = counts + bucket_count;
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      ++counts[bucket_of(_commands[i].group, generations ? generations[i] : 0, generation_count)];
+    }
+
+    const command* sorted = _commands;
+
+    if (std::count(counts, counts + bucket_count, size_type { 0 }) + 1 < static_cast<std::ptrdiff_t>(bucket_count))
+    {
+      for (size_type i = 1; i < bucket_count; i++) offsets[i] = offsets[i - 1] + counts[i - 1];
+
+      if (!_sorted) _sorted = static_cast<command*>(std::malloc(_capacity * sizeof(command)));
+
+      for (size_type i = 0; i < _size; i++)
+      {
+        _sorted[offsets[bucket_of(_commands[i].group, generations ? generations[i] : 0, generation_count)]++] = _commands[i];
+      }
+
+      sorted = _sorted;
+    }
+
+    for (size_type i = 0, begin = 0; i < bucket_count; i++)
+    {
+      if (counts[i])
+      {
+        _groups[i % _groups_size]->apply(*_registry, sorted + begin, counts[i]);
+
+        begin += counts[i];
+      }
+    }
+
+    std::free(counts);
+
+    if (generations) std::free(generations);
+
+    reset();
+  }
+
+  /**
+   * @brief Discards every recorded command without applying them.
+   * 
+   * @note Entities reserved by discarded creations are not given back.
+   */
+  void clear()
+  {
+    for (size_type i = 0; i < _size; i++)
+    {
+      const operation* op = _groups[_commands[i].group];
+
+      if (op->discard) op->discard(_commands[i].payload);
+    }
+
+    reset();
+  }
+
+  /**
+   * @brief Returns the amount of recorded commands.
+   * 
+   * @return size_type Amount of commands
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Returns whether or not there are no recorded commands.
+   * 
+   * @return true If there are no commands, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _size == 0; }
+
+private:
+  template<typename>
+  friend class concurrent_command_buffer;
+
+  /**
+   * @brief Operation that creates entities of an archetype.
+   */
+  template<typename Archetype, typename... Components>
+  struct create_operation
+  {
+    using payload_type = std::tuple<Components...>;
+
+    static constexpr uint32_t phase = create_phase;
+
+    static void apply(registry_type& registry, const command* commands, const size_type count)
+    {
+      auto& storage = registry.template access<Archetype>();
+
+      // Grow once for the whole group
+      if (storage.size() + count > storage.capacity())
+        storage.reserve(std::max(storage.size() + count, storage.capacity() * 2));
+
+      for (size_type i = 0; i < count; i++)
+      {
+        payload_type* payload = reinterpret_cast<payload_type*>(commands[i].payload);
+
+        storage.insert(commands[i].entity, std::get<Components>(*payload)...);
+
+        payload->~payload_type();
+      }
+
+      if constexpr (storage_traits<Archetype>::observed)
+      {
+        std::vector<entity_type> entities;
+        entities.reserve(count);
+
+        for (size_type i = 0; i < count; i++) entities.push_back(commands[i].entity);
+
+        // The whole group is delivered as a single span
+        registry.template notify_entered<Archetype>(entities.data(), count);
+      }
+    }
+  };
+
+  /**
+   * @brief Operation that destroys entities.
+   */
+  template<typename... Components>
+  struct destroy_operation
+  {
+    using payload_type = void;
+
+    static constexpr uint32_t phase = destroy_phase;
+
+    static void apply(registry_type& registry, const command* commands, const size_type count)
+    {
+      entity_type* entities = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+
+      each_storage(registry, prune_for_t<archetype_list_type, Components...> {}, [&](auto& storage)
+        {
+          using source = typename std::decay_t<decltype(storage)>::archetype_type;
+
+          const size_type contained = gather(storage, commands, count, entities);
+
+          if (contained == 0) return;
+
+          registry.template notify_leaving<source>(entities, contained);
+
+          if constexpr (std::decay_t<decltype(storage)>::stable_addresses)
+          {
+            for (size_type i = 0; i < contained; i++) storage.erase(entities[i]);
+          }
+          else
+          {
+            storage.partition(entities, contained);
+            storage.erase_back(contained);
+          }
+        });
+
+      std::free(entities);
+
+      for (size_type i = 0; i < count; i++)
+      {
+        registry.erase_side_components(commands[i].entity);
+        registry._manager.release(commands[i].entity);
+      }
+    }
+  };
+
+  /**
+   * @brief Operation that adds a component to entities.
+   */
+  template<typename Component>
+  struct add_operation
+  {
+    using payload_type = Component;
+
+    static constexpr uint32_t phase = change_phase;
+
+    static void apply(registry_type& registry, const command* commands, const size_type count)
+    {
+      if constexpr (contains_v<Component, typename registry_type::side_component_list_type>)
+      {
+        auto view = registry.template view<>();
+
+        for (size_type i = 0; i < count; i++)
+        {
+          payload_type* payload = reinterpret_cast<payload_type*>(commands[i].payload);
+
+          view.add(commands[i].entity, *payload);
+
+          payload->~payload_type();
+        }
+      }
+      else
+      {
+        using sources = typename prune_for_add<Component, archetype_list_type, archetype_list_type>::type;
+
+        entity_type* entities = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+        size_type* indices = static_cast<size_type*>(std::malloc(count * sizeof(size_type)));
+
+        each_storage(registry, sources {}, [&](auto& storage)
+          {
+            using source = typename std::decay_t<decltype(storage)>::archetype_type;
+            using target = find_same_t<archetype_list_type, push_back_t<Component, source>>;
+
+            auto& destination = registry.template access<target>();
+
+            const size_type contained = gather(storage, commands, count, entities, indices);
+
+            if (contained == 0) return;
+
+            // Moving rows to the back would move the rows of other entities
+            if constexpr (std::decay_t<decltype(storage)>::stable_addresses || !std::is_default_constructible_v<Component>)
+            {
+              for (size_type i = 0; i < contained; i++)
+                storage.transfer(entities[i], destination, *reinterpret_cast<payload_type*>(commands[indices[i]].payload));
+            }
+            else
+            {
+              storage.partition(entities, contained);
+              storage.transfer_back(contained, destination);
+
+              for (size_type i = 0; i < contained; i++)
+              {
+                destination.template unpack<Component>(entities[i]) = *reinterpret_cast<payload_type*>(commands[indices[i]].payload);
+
+                if constexpr (std::decay_t<decltype(destination)>::grouped) destination.regroup(entities[i]);
+              }
+            }
+
+            for (size_type i = 0; i < contained; i++) reinterpret_cast<payload_type*>(commands[indices[i]].payload)->~payload_type();
+
+            registry.template notify_entered<target, source>(entities, contained);
+          });
+
+        std::free(entities);
+        std::free(indices);
+      }
+    }
+  };
+
+  /**
+   * @brief Operation that removes a component from entities.
+   */
+  template<typename Component>
+  struct remove_operation
+  {
+    using payload_type = void;
+
+    static constexpr uint32_t phase = change_phase;
+
+    static void apply(registry_type& registry, const command* commands, const size_type count)
+    {
+      if constexpr (contains_v<Component, typename registry_type::side_component_list_type>)
+      {
+        auto view = registry.template view<>();
+
+        for (size_type i = 0; i < count; i++) view.template remove<Component>(commands[i].entity);
+      }
+      else
+      {
+        using sources = typename prune_for_remove<Component, archetype_list_type, archetype_list_type>::type;
+
+        entity_type* entities = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+
+        each_storage(registry, sources {}, [&](auto& storage)
+          {
+            using source = typename std::decay_t<decltype(storage)>::archetype_type;
+            using target = find_same_t<archetype_list_type, remove_t<Component, source>>;
+
+            auto& destination = registry.template access<target>();
+
+            const size_type contained = gather(storage, commands, count, entities);
+
+            if (contained == 0) return;
+
+            registry.template notify_leaving<source, target>(entities, contained);
+
+            // Moving rows to the back would move the rows of other entities
+            if constexpr (std::decay_t<decltype(storage)>::stable_addresses)
+            {
+              for (size_type i = 0; i < contained; i++) storage.transfer(entities[i], destination);
+            }
+            else
+            {
+              storage.partition(entities, contained);
+              storage.transfer_back(contained, destination);
+            }
+
+            registry.template notify_entered<target, source>(entities, contained);
+          });
+
+        std::free(entities);
+      }
+    }
+  };
+
+  /**
+   * @brief Operation that moves entities to an archetype.
+   */
+  template<typename... SwapComponents>
+  struct swap_operation
+  {
+    using payload_type = void;
+
+    static constexpr uint32_t phase = change_phase;
+
+    static void apply(registry_type& registry, const command* commands, const size_type count)
+    {
+      entity_type* entities = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+
+      for (size_type i = 0; i < count; i++) entities[i] = commands[i].entity;
+
+      registry.template view<>().template migrate<SwapComponents...>(entities, count);
+
+      std::free(entities);
+    }
+  };
+
+  /**
+   * @brief Invokes a function with the storage of every archetype of a list.
+   * 
+   * @tparam Archetypes Archetypes of the storages
+   * @tparam Function Function type
+   * @param registry Registry of the storages
+   * @param function Function invoked with every storage
+   */
+  template<typename... Archetypes, typename Function>
+  static void each_storage(registry_type& registry, list<Archetypes...>, const Function& function)
+  {
+    (function(registry.template access<Archetypes>()), ...);
+  }
+
+  /**
+   * @brief Gathers the entities of a group of commands that are in a storage.
+   * 
+   * @tparam Storage Storage type
+   * @param storage Storage to check
+   * @param commands Commands of the group
+   * @param count Amount of commands
+   * @param entities Entities in the storage, in the order of the commands
+   * @param indices Index of the command of every gathered entity (optional)
+   * @return size_type Amount of entities in the storage
+   */
+  template<typename Storage>
+  static size_type gather(const Storage& storage, const command* commands, const size_type count, entity_type* entities,
+    size_type* indices = NULL)
+  {
+    size_type contained = 0;
+
+    for (size_type i = 0; i < count; i++)
+    {
+      if (storage.contains(commands[i].entity))
+      {
+        if (indices) indices[contained] = i;
+
+        entities[contained++] = commands[i].entity;
+      }
+    }
+
+    return contained;
+  }
+
+  /**
+   * @brief Destroys a payload.
+   * 
+   * @param memory Memory of the payload
+   */
+  template<typename Payload>
+  static void discard(char* memory)
+  {
+    reinterpret_cast<Payload*>(memory)->~Payload();
+  }
+
+  /**
+   * @brief Returns the function that destroys the payload of an operation.
+   * 
+   * @return auto Function to destroy the payload, NULL if there is nothing to destroy
+   */
+  template<typename Operation>
+  static constexpr auto discarder()
+  {
+    using payload_type = typename Operation::payload_type;
+
+    if constexpr (std::is_void_v<payload_type> || std::is_trivially_destructible_v<payload_type>)
+      return static_cast<void (*)(char*)>(NULL);
+    else
+      return &discard<payload_type>;
+  }
+
+  /**
+   * @brief Description of an operation.
+   */
+  template<typename Operation>
+  static constexpr operation descriptor { Operation::phase, &Operation::apply, discarder<Operation>() };
+
+  /**
+   * @brief Records a command.
+   * 
+   * @tparam Operation Operation of the command
+   * @tparam Arguments Types of the arguments to construct the payload with
+   * @param entity Entity of the command
+   * @param arguments Arguments to construct the payload with
+   */
+  template<typename Operation, typename... Arguments>
+  void record(const entity_type entity, const Arguments&... arguments)
+  {
+    using payload_type = typename Operation::payload_type;
+
+    char* payload = NULL;
+
+    if constexpr (!std::is_void_v<payload_type>)
+    {
+      static_assert(alignof(payload_type) <= alignof(std::max_align_t), "Over-aligned components are not supported");
+
+      payload = allocate(sizeof(payload_type), alignof(payload_type));
+
+      new (payload) payload_type(arguments...);
+    }
+    else
+      ((void)arguments, ...); // Suppress unused warning
+
+    if (_size == _capacity) grow(_capacity ? _capacity * 2 : 64);
+
+    _commands[_size++] = command { payload, entity, group_of(&descriptor<Operation>) };
+  }
+
+  /**
+   * @brief Grows the array of commands.
+   * 
+   * @param capacity New capacity
+   */
+  void grow(const size_type capacity)
+  {
+    _capacity = capacity;
+    _commands = static_cast<command*>(std::realloc(_commands, _capacity * sizeof(command)));
+
+    // Reallocated with the right capacity on the next flush
+    if (_sorted)
+    {
+      free(_sorted);
+      _sorted = NULL;
+    }
+  }
+
+  /**
+   * @brief Appends the commands of another buffer after the commands of this buffer.
+   * 
+   * The payloads stay in the arena of the other buffer, it must not record or clear until this buffer is flushed.
+   * 
+   * @param other Buffer to append
+   */
+  void append(const command_buffer& other)
+  {
+    if (_size + other._size > _capacity) grow(std::max(_size + other._size, _capacity * 2));
+
+    for (size_type i = 0; i < other._size; i++)
+    {
+      const command& appended = other._commands[i];
+
+      _commands[_size++] = command { appended.payload, appended.entity, group_of(other._groups[appended.group]) };
+    }
+  }
+
+  /**
+   * @brief Returns the group of an operation, adding it if it was never recorded.
+   * 
+   * Groups are numbered in the order they are first recorded. There are usually only a few groups, and commands
+   * with the same operation tend to be recorded together.
+   * 
+   * @param op Operation to find
+   * @return uint32_t Group of the operation
+   */
+  uint32_t group_of(const operation* op)
+  {
+    if (_groups_size && _groups[_last] == op) return _last;
+
+    for (uint32_t i = 0; i < _groups_size; i++)
+    {
+      if (_groups[i] == op) return _last = i;
+    }
+
+    if (_groups_size == _groups_capacity)
+    {
+      _groups_capacity = _groups_capacity ? _groups_capacity * 2 : 8;
+      _groups = static_cast<const operation**>(std::realloc(_groups, _groups_capacity * sizeof(const operation*)));
+    }
+
+    _groups[_groups_size] = op;
+
+    return _last = _groups_size++;
+  }
+
+  /**
+   * @brief Returns the bucket of a command for the counting sort.
+   * 
+   * @param group Group of the command
+   * @param generation Generation of the command
+   * @param generation_count Amount of generations
+   * @return size_type Bucket of the command
+   */
+  size_type bucket_of(const uint32_t group, const uint32_t generation, const size_type generation_count) const
+  {
+    const uint32_t phase = _groups[group]->phase;
+
+    // Only archetype changes have more than one generation
+    const size_type before = phase == create_phase ? 0 : (phase == change_phase ? 1 : 1 + generation_count);
+
+    return (before + generation) * _groups_size + group;
+  }
+
+  /**
+   * @brief Numbers the archetype changes of every entity.
+   * 
+   * The n-th change of an entity is in generation n, generations are applied in order. Most of the time entities
+   * change at most once, this is verified with a bitset over the indices of the entities.
+   * 
+   * @return uint32_t* Generation of every command, NULL if every command is in the first generation
+   */
+  uint32_t* number_changes()
+  {
+    entity_type highest = 0;
+    size_type changes = 0;
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      if (_groups[_commands[i].group]->phase == change_phase)
+      {
+        highest = std::max(highest, traits_type::index(_commands[i].entity));
+        ++changes;
+      }
+    }
+
+    if (changes < 2) return NULL;
+
+    bool duplicates = false;
+
+    // Entities that are spread out would need a huge bitset, assume duplicates and sort instead
+    if (static_cast<size_type>(highest) <= changes * 64)
+    {
+      bitset seen;
+      seen.resize(static_cast<size_type>(highest) + 1);
+
+      for (size_type i = 0; i < _size && !duplicates; i++)
+      {
+        if (_groups[_commands[i].group]->phase != change_phase) continue;
+
+        const size_type index = static_cast<size_type>(traits_type::index(_commands[i].entity));
+
+        duplicates = seen.test(index);
+        seen.set(index);
+      }
+    }
+    else
+      duplicates = true;
+
+    if (!duplicates) return NULL;
+
+    // Sort the changes by entity, keeping them in the order they were recorded
+    size_type* order = static_cast<size_type*>(std::malloc(changes * sizeof(size_type)));
+
+    for (size_type i = 0, j = 0; i < _size; i++)
+    {
+      if (_groups[_commands[i].group]->phase == change_phase) order[j++] = i;
+    }
+
+    std::stable_sort(order, order + changes, [this](const size_type lhs, const size_type rhs)
+      { return _commands[lhs].entity < _commands[rhs].entity; });
+
+    uint32_t* generations = static_cast<uint32_t*>(std::calloc(_size, sizeof(uint32_t)));
+
+    for (size_type i = 1; i < changes; i++)
+    {
+      if (_commands[order[i]].entity == _commands[order[i - 1]].entity)
+        generations[order[i]] = generations[order[i - 1]] + 1;
+    }
+
+    std::free(order);
+
+    return generations;
+  }
+
+  /**
+   * @brief Allocates memory for a payload in the arena.
+   * 
+   * Payloads are never moved once constructed, blocks are only freed with the buffer.
+   * 
+   * @param size Size of the payload
+   * @param alignment Alignment of the payload
+   * @return char* Memory of the payload
+   */
+  char* allocate(const size_type size, const size_type alignment)
+  {
+    for (; _block < _blocks_size; ++_block, _used = 0)
+    {
+      const size_type offset = (_used + alignment - 1) & ~(alignment - 1);
+
+      if (offset + size <= _blocks[_block].size)
+      {
+        _used = offset + size;
+        return _blocks[_block].memory + offset;
+      }
+    }
+
+    // Every block is full, append a new one
+    const size_type allocated = std::max(size, block_size);
+
+    _blocks = static_cast<block*>(std::realloc(_blocks, (_blocks_size + 1) * sizeof(block)));
+    _blocks[_blocks_size++] = block { static_cast<char*>(std::malloc(allocated)), allocated };
+
+    _used = size;
+
+    return _blocks[_block].memory;
+  }
+
+  /**
+   * @brief Forgets every command, keeping the memory for the next ones.
+   */
+  void reset()
+  {
+    _size = 0;
+    _groups_size = 0;
+    _block = 0;
+    _used = 0;
+  }
+
+private:
+  registry_type* _registry;
+
+  command* _commands;
+  command* _sorted;
+  size_type _size;
+  size_type _capacity;
+
+  const operation** _groups;
+  uint32_t _groups_size;
+  uint32_t _groups_capacity;
+  uint32_t _last;
+
+  block* _blocks;
+  size_type _blocks_size;
+  size_type _block;
+  size_type _used;
+};
+/**
+ * @brief Command buffers for multiple threads, merged into a single flush.
+ * 
+ * Every slot has its own command buffer with its own arena, so threads record commands without any contention.
+ * Slots are usually given to threads or systems, a slot must only be used by one thread at a time.
+ * 
+ * @code{.cpp}
+ * xecs::concurrent_command_buffer commands { registry, workers };
+ * 
+ * // On worker i
+ * auto& local = commands.local(i);
+ * 
+ * local.destroy(entity);
+ * 
+ * // At the sync point, once every worker is done
+ * commands.flush();
+ * @endcode
+ * 
+ * On flush, the commands of every slot are merged in slot order, then grouped and applied like the commands of a
+ * single buffer, every archetype receiving its whole batch at once. The result only depends on the commands of each
+ * slot and not on how the threads were scheduled, as long as reserved entities are not compared across slots.
+ * 
+ * Creations reserve entities from any thread, so the registry must use a concurrent_entity_manager.
+ * 
+ * @tparam Registry Registry type to apply the commands on
+ */
+template<typename Registry>
+class concurrent_command_buffer
+{
+public:
+  using registry_type = Registry;
+  using buffer_type = command_buffer<Registry>;
+  using size_type = size_t;
+
+  static_assert(registry_type::manager_type::concurrent,
+    "Concurrent command buffers reserve entities from any thread, the registry requires a concurrent_entity_manager");
+
+private:
+  /**
+   * @brief Buffer of a slot, aligned to avoid false sharing between threads.
+   */
+  struct alignas(64) slot
+  {
+    explicit slot(registry_type& registry) : buffer { registry } {}
+
+    buffer_type buffer;
+  };
+
+public:
+  /**
+   * @brief Construct a new concurrent command buffer object
+   * 
+   * @param registry Registry to apply the commands on
+   * @param slots Amount of slots
+   */
+  concurrent_command_buffer(registry_type& registry, const size_type slots)
+    : _merged(registry), _slots(static_cast<slot*>(::operator new(slots * sizeof(slot), std::align_val_t { alignof(slot) }))),
+      _slots_size(slots)
+  {
+    for (size_type i = 0; i < _slots_size; i++) new (_slots + i) slot(registry);
+  }
+
+  /**
+   * @brief Destroy the concurrent command buffer object, the commands that were not flushed are discarded.
+   */
+  ~concurrent_command_buffer()
+  {
+    for (size_type i = 0; i < _slots_size; i++) _slots[i].~slot();
+
+    ::operator delete(_slots, std::align_val_t { alignof(slot) });
+  }
+
+  concurrent_command_buffer(const concurrent_command_buffer&) = delete;
+  concurrent_command_buffer(concurrent_command_buffer&&) = delete;
+  concurrent_command_buffer& operator=(const concurrent_command_buffer&) = delete;
+  concurrent_command_buffer& operator=(concurrent_command_buffer&&) = delete;
+
+  /**
+   * @brief Returns the command buffer of a slot.
+   * 
+   * @warning The buffer must not be flushed directly, and must only be used by one thread at a time.
+   * 
+   * @param index Index of the slot
+   * @return buffer_type& Command buffer of the slot
+   */
+  buffer_type& local(const size_type index) { return _slots[index].buffer; }
+
+  /**
+   * @brief Applies the commands of every slot on the registry and clears every slot.
+   * 
+   * @warning Must only be called while no thread records commands, and not while a view is being iterated.
+   */
+  void flush()
+  {
+    for (size_type i = 0; i < _slots_size; i++) _merged.append(_slots[i].buffer);
+
+    _merged.flush();
+
+    // The payloads were destroyed by the merged flush
+    for (size_type i = 0; i < _slots_size; i++) _slots[i].buffer.reset();
+  }
+
+  /**
+   * @brief Discards the commands of every slot without applying them.
+   */
+  void clear()
+  {
+    for (size_type i = 0; i < _slots_size; i++) _slots[i].buffer.clear();
+  }
+
+  /**
+   * @brief Returns the amount of slots.
+   * 
+   * @return size_type Amount of slots
+   */
+  [[nodiscard]] size_type slots() const { return _slots_size; }
+
+  /**
+   * @brief Returns the amount of recorded commands in every slot.
+   * 
+   * @return size_type Amount of commands
+   */
+  [[nodiscard]] size_type size() const
+  {
+    size_type size = 0;
+
+    for (size_type i = 0; i < _slots_size; i++) size += _slots[i].buffer.size();
+
+    return size;
+  }
+
+private:
+  buffer_type _merged;
+
+  slot* _slots;
+  size_type _slots_size;
+};
+} // namespace xecs
+
+#endif
@@ -0,0 +1,447 @@
+#ifndef XECS_CONCURRENT_ENTITY_MANAGER_HPP
+#define XECS_CONCURRENT_ENTITY_MANAGER_HPP
+
+#include "bitset.hpp"
+#include "entity.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace xecs
+{
+/**
+ * @brief Manager responsible for distributing entities from multiple threads.
+ * 
+ * Fresh entities are obtained by bumping an atomic counter. Recycled entities are kept in a global lock-free
+ * pool of batches, and threads generate and release entities through their own cache, that is refilled from and
+ * spilled to the global pool a whole batch at a time. Contention is then only paid once per batch.
+ * 
+ * @code{.cpp}
+ * // On a worker thread
+ * auto cache = manager.local();
+ * 
+ * auto entity = cache.generate();
+ * @endcode
+ * 
+ * The generate and release methods of the manager itself use a cache owned by the manager, they must only
+ * be called by the thread that owns the manager (usually the one that owns the registry). The reserve
+ * method can be called from any thread, the entity can then be inserted later at a sync point.
+ * 
+ * Entities are recycled with their next version (see versioned), but validity is not tracked by this
+ * manager, stale entities are still never found in the storages.
+ * 
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ * @tparam BatchSize Amount of entities moved at once between the caches and the global pool
+ */
+template<typename Entity, size_t BatchSize = 64>
+class concurrent_entity_manager
+{
+public:
+  using traits_type = entity_traits<Entity>;
+  using entity_type = typename traits_type::entity_type;
+  using size_type = size_t;
+
+  static_assert(BatchSize > 0, "Batch size must not be zero");
+
+  /**
+   * @brief Amount of entities moved at once between the caches and the global pool.
+   */
+  static constexpr size_type batch_size = BatchSize;
+
+  /**
+   * @brief Whether or not the manager tracks the validity of entities.
+   */
+  static constexpr bool versioned = false;
+
+  /**
+   * @brief Whether or not entities can be reserved from any thread.
+   */
+  static constexpr bool concurrent = true;
+
+  /**
+   * @brief Cache of entities of one thread.
+   * 
+   * Holds up to two batches of entities, so that alternating generate and release never reaches the global pool.
+   */
+  class cache final
+  {
+  public:
+    /**
+     * @brief Construct a new cache object
+     * 
+     * @param manager Manager to obtain and give back entities
+     */
+    explicit cache(concurrent_entity_manager& manager)
+      : _manager(&manager), _size(0)
+    {}
+
+    /**
+     * @brief Destroy the cache object, giving back the remaining entities.
+     */
+    ~cache()
+    {
+      flush();
+    }
+
+    cache(const cache&) = delete;
+    cache& operator=(const cache&) = delete;
+    cache& operator=(cache&&) = delete;
+
+    /**
+     * @brief Construct a new cache object by taking the entities of another cache.
+     * 
+     * @param other Cache to take the entities from
+     */
+    cache(cache&& other)
+      : _manager(other._manager), _size(other._size)
+    {
+      std::memcpy(_entities, other._entities, _size * sizeof(entity_type));
+      other._size = 0;
+    }
+
+    /**
+     * @brief Generates a unique entity.
+     * 
+     * When the cache is empty, a batch of recycled entities is taken from the global pool, or
+     * a batch of fresh entities is obtained from the counter.
+     * 
+     * @return entity_type The entity identifier generated
+     */
+    entity_type generate()
+    {
+      if (_size == 0) refill();
+
+      return _entities[--_size];
+    }
+
+    /**
+     * @brief Allows an entity to be reused.
+     * 
+     * When the cache is full, a batch of entities is given back to the global pool.
+     * 
+     * @param entity Entity to release
+     */
+    void release(const entity_type entity)
+    {
+      if (_size == capacity) spill(batch_size);
+
+      _entities[_size++] = traits_type::next_version(entity);
+    }
+
+    /**
+     * @brief Gives every entity of the cache back to the global pool.
+     */
+    void flush()
+    {
+      while (_size) spill(_size < batch_size ? _size : batch_size);
+    }
+
+  private:
+    friend class concurrent_entity_manager;
+
+    static constexpr size_type capacity = batch_size * 2;
+
+    /**
+     * @brief Fills the cache with a batch of entities.
+     */
+    void refill()
+    {
+      const uint32_t index = _manager->pop(_manager->_full);
+
+      if (index)
+      {
+        batch& taken = _manager->at(index);
+
+        _size = taken.size;
+        std::memcpy(_entities, taken.entities, _size * sizeof(entity_type));
+
+        _manager->push(_manager->_empty, index);
+      }
+      else
+      {
+        const entity_type first = _manager->_current.fetch_add(batch_size, std::memory_order_relaxed);
+
+        // Generated from the back, so fill in reverse to hand out increasing entities
+        for (size_type i = 0; i < batch_size; i++)
+        {
+          _entities[i] = static_cast<entity_type>(first + batch_size - 1 - i);
+        }
+
+        _size = batch_size;
+      }
+    }
+
+    /**
+     * @brief Gives entities from the top of the cache back to the global pool.
+     * 
+     * @param amount Amount of entities, at most a batch
+     */
+    void spill(const size_type amount)
+    {
+      const uint32_t index = _manager->allocate();
+
+      batch& given = _manager->at(index);
+
+      _size -= amount;
+
+      given.size = amount;
+      std::memcpy(given.entities, _entities + _size, amount * sizeof(entity_type));
+
+      _manager->push(_manager->_full, index);
+    }
+
+  private:
+    concurrent_entity_manager* _manager;
+
+    size_type _size;
+    entity_type _entities[capacity];
+  };
+
+private:
+  /**
+   * @brief Node of the global pool.
+   */
+  struct batch
+  {
+    entity_type entities[batch_size];
+    size_type size;
+    std::atomic<uint32_t> next;
+  };
+
+  /**
+   * @brief Head of a lock-free stack of batches.
+   * 
+   * The lower half is the index of the top batch plus one (zero when empty), the upper half is
+   * a tag incremented on every operation to avoid the ABA problem.
+   */
+  using head_type = std::atomic<uint64_t>;
+
+  /**
+   * @brief Amount of batches of the first chunk, every other chunk is twice as big as the previous.
+   */
+  static constexpr size_type first_chunk = 64;
+
+  /**
+   * @brief Maximum amount of chunks.
+   */
+  static constexpr size_type chunk_count = 32;
+
+public:
+  /**
+   * @brief Construct a new concurrent entity manager object
+   */
+  concurrent_entity_manager()
+    : _current(0), _batches(0), _full(0), _empty(0), _chunks(), _owner(*this)
+  {}
+
+  /**
+   * @brief Destroy the concurrent entity manager object
+   */
+  ~concurrent_entity_manager()
+  {
+    // The pool is about to be freed, nothing to spill
+    _owner._size = 0;
+
+    for (size_type i = 0; i < chunk_count; i++)
+    {
+      delete[] _chunks[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  concurrent_entity_manager(const concurrent_entity_manager&) = delete;
+  concurrent_entity_manager(concurrent_entity_manager&&) = delete;
+  concurrent_entity_manager& operator=(const concurrent_entity_manager&) = delete;
+  concurrent_entity_manager& operator=(concurrent_entity_manager&&) = delete;
+
+  /**
+   * @brief Generates a unique entity using the cache of the owning thread.
+   * 
+   * @warning Must only be called by the thread that owns the manager.
+   * 
+   * @return entity_type The entity identifier generated
+   */
+  entity_type generate() { return _owner.generate(); }
+
+  /**
+   * @brief Allows an entity to be reused, using the cache of the owning thread.
+   * 
+   * @warning Must only be called by the thread that owns the manager.
+   * 
+   * @param entity Entity to release
+   */
+  void release(const entity_type entity) { _owner.release(entity); }
+
+  /**
+   * @brief Generates a fresh entity from any thread.
+   * 
+   * This is a single atomic increment. Recycled entities are never reserved.
+   * 
+   * @return entity_type The entity identifier reserved
+   */
+  entity_type reserve() { return _current.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Returns a cache to generate and release entities from the calling thread.
+   * 
+   * A cache must only be used by one thread at a time. The remaining entities of the cache
+   * are given back to the global pool when it is destroyed.
+   * 
+   * @return cache A cache for the calling thread
+   */
+  cache local() { return cache { *this }; }
+
+  /**
+   * @brief Releases all entities at once.
+   * 
+   * Resets the internal counter and clears reusable entities.
+   * 
+   * @warning Must only be called by the thread that owns the manager, while no other cache is in use.
+   */
+  void release_all()
+  {
+    _owner._size = 0;
+
+    uint32_t index;
+
+    while ((index = pop(_full)) != 0) push(_empty, index);
+
+    _current.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Gives the entities of the owning thread cache back to the global pool.
+   * 
+   * This makes them available to the caches of other threads.
+   * 
+   * @warning Must only be called by the thread that owns the manager.
+   */
+  void swap() { _owner.flush(); }
+
+  /**
+   * @brief Does nothing, batches are reused and freed with the manager.
+   * 
+   * Exists to be interchangeable with entity_manager.
+   */
+  void shrink_to_fit() {}
+
+  /**
+   * @brief Reveals the current value of the internal counter.
+   * 
+   * @warning This value is not guaranted to be the next value to be generated.
+   * 
+   * @return entity_type Next entity for internal counter
+   */
+  [[nodiscard]] entity_type peek() const { return _current.load(std::memory_order_relaxed); }
+
+private:
+  /**
+   * @brief Pushes a batch on a lock-free stack.
+   * 
+   * @param head Head of the stack
+   * @param index Index of the batch plus one
+   */
+  void push(head_type& head, const uint32_t index)
+  {
+    uint64_t old = head.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+      at(index).next.store(static_cast<uint32_t>(old), std::memory_order_relaxed);
+
+      const uint64_t tagged = ((old >> 32) + 1) << 32 | index;
+
+      if (head.compare_exchange_weak(old, tagged, std::memory_order_release, std::memory_order_relaxed)) return;
+    }
+  }
+
+  /**
+   * @brief Pops a batch from a lock-free stack.
+   * 
+   * @param head Head of the stack
+   * @return uint32_t Index of the batch plus one, zero if the stack is empty
+   */
+  uint32_t pop(head_type& head)
+  {
+    uint64_t old = head.load(std::memory_order_acquire);
+
+    while (true)
+    {
+      const uint32_t index = static_cast<uint32_t>(old);
+
+      if (index == 0) return 0;
+
+      const uint64_t tagged = ((old >> 32) + 1) << 32 | at(index).next.load(std::memory_order_relaxed);
+
+      if (head.compare_exchange_weak(old, tagged, std::memory_order_acquire, std::memory_order_acquire)) return index;
+    }
+  }
+
+  /**
+   * @brief Returns an unused batch, allocating it if needed.
+   * 
+   * @return uint32_t Index of the batch plus one
+   */
+  uint32_t allocate()
+  {
+    uint32_t index = pop(_empty);
+
+    if (index != 0) return index;
+
+    index = _batches.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    const size_type chunk = chunk_of(index);
+
+    if (_chunks[chunk].load(std::memory_order_acquire) == nullptr)
+    {
+      batch* expected = nullptr;
+      batch* allocated = new batch[first_chunk << chunk];
+
+      // Another thread may have allocated the chunk first
+      if (!_chunks[chunk].compare_exchange_strong(expected, allocated, std::memory_order_acq_rel)) delete[] allocated;
+    }
+
+    return index;
+  }
+
+  /**
+   * @brief Returns the chunk of a batch.
+   * 
+   * @param index Index of the batch plus one
+   * @return size_type Chunk of the batch
+   */
+  static size_type chunk_of(const uint32_t index)
+  {
+    return highest_bit((index - 1) / first_chunk + 1);
+  }
+
+  /**
+   * @brief Accesses a batch.
+   * 
+   * @param index Index of the batch plus one
+   * @return batch& The batch
+   */
+  batch& at(const uint32_t index)
+  {
+    const size_type chunk = chunk_of(index);
+    const size_type offset = (index - 1) - first_chunk * ((size_type { 1 } << chunk) - 1);
+
+    return _chunks[chunk].load(std::memory_order_acquire)[offset];
+  }
+
+private:
+  std::atomic<entity_type> _current;
+  std::atomic<uint32_t> _batches;
+
+  head_type _full;
+  head_type _empty;
+
+  std::atomic<batch*> _chunks[chunk_count];
+
+  cache _owner;
+};
+
+} // namespace xecs
+
+#endif
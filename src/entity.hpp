@@ -0,0 +1,123 @@
+#ifndef XECS_ENTITY_HPP
+#define XECS_ENTITY_HPP
+
+#include <cstddef>
+#include <limits>
+
+namespace xecs
+{
+/**
+ * @brief Describes an entity identifier split in an index and a version.
+ * 
+ * The index is stored in the lower bits and the version in the VersionBits upper bits. The index is used
+ * to locate the entity, and the version is incremented every time the index is recycled. A stale entity
+ * identifier therefore never aliases an entity created later with the same index (until the version wraps around).
+ * 
+ * Use it in place of the entity type:
+ * 
+ * @code{.cpp}
+ * xecs::registry<xecs::versioned<uint32_t, 12>, archetypes> registry;
+ * @endcode
+ * 
+ * @tparam Entity unsigned integer type of the entity identifier
+ * @tparam VersionBits Amount of upper bits used for the version
+ */
+template<typename Entity, size_t VersionBits>
+struct versioned
+{};
+
+/**
+ * @brief Information on how to decompose an entity identifier.
+ * 
+ * By default entity identifiers are unsigned integers without any version, the whole identifier is the index.
+ * 
+ * @tparam Entity unsigned integer entity type or an entity descriptor (see versioned)
+ */
+template<typename Entity>
+struct entity_traits
+{
+  using entity_type = Entity;
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+  /**
+   * @brief Amount of bits used for the version.
+   */
+  static constexpr size_t version_bits = 0;
+
+  /**
+   * @brief Amount of bits used for the index.
+   */
+  static constexpr size_t index_bits = std::numeric_limits<entity_type>::digits - version_bits;
+
+  /**
+   * @brief Mask of the index bits.
+   */
+  static constexpr entity_type index_mask = std::numeric_limits<entity_type>::max();
+
+  /**
+   * @brief Returns the index of an entity.
+   * 
+   * @param entity Entity identifier
+   * @return entity_type Index of the entity
+   */
+  static constexpr entity_type index(const entity_type entity) { return entity; }
+
+  /**
+   * @brief Returns the version of an entity.
+   * 
+   * @param entity Entity identifier
+   * @return entity_type Version of the entity
+   */
+  static constexpr entity_type version(const entity_type entity)
+  {
+    (void)entity; // Suppress unused warning
+    return 0;
+  }
+
+  /**
+   * @brief Returns the entity identifier with the same index and the next version.
+   * 
+   * @param entity Entity identifier
+   * @return entity_type Entity identifier of the next version
+   */
+  static constexpr entity_type next_version(const entity_type entity) { return entity; }
+};
+
+template<typename Entity, size_t VersionBits>
+struct entity_traits<versioned<Entity, VersionBits>>
+{
+  using entity_type = Entity;
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+  static_assert(VersionBits > 0 && VersionBits < static_cast<size_t>(std::numeric_limits<entity_type>::digits),
+    "Version bits must leave atleast one bit for the index");
+
+  /*! @copydoc entity_traits::version_bits */
+  static constexpr size_t version_bits = VersionBits;
+
+  /*! @copydoc entity_traits::index_bits */
+  static constexpr size_t index_bits = std::numeric_limits<entity_type>::digits - version_bits;
+
+  /*! @copydoc entity_traits::index_mask */
+  static constexpr entity_type index_mask = static_cast<entity_type>((entity_type { 1 } << index_bits) - 1);
+
+  /*! @copydoc entity_traits::index */
+  static constexpr entity_type index(const entity_type entity) { return entity & index_mask; }
+
+  /*! @copydoc entity_traits::version */
+  static constexpr entity_type version(const entity_type entity) { return static_cast<entity_type>(entity >> index_bits); }
+
+  /*! @copydoc entity_traits::next_version */
+  static constexpr entity_type next_version(const entity_type entity)
+  {
+    // The version wraps around by overflowing the upper bits
+    return static_cast<entity_type>(((entity & ~index_mask) + index_mask + 1) | (entity & index_mask));
+  }
+};
+} // namespace xecs
+
+#endif
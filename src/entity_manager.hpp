@@ -1,19 +1,746 @@
 #ifndef XECS_ENTITY_MANAGER_HPP
 #define XECS_ENTITY_MANAGER_HPP
 
+#include "bitset.hpp"
+#include "entity.hpp"
+
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <utility>
 
-#define ENTITY_MANAGER_STACK_SIZE 16384 // This should not be changed unless you know what your doing
+#define ENTITY_MANAGER_STACK_SIZE 16384 // Default stack memory of stack_recycler, use its template parameter to change it
+
+static_assert((ENTITY_MANAGER_STACK_SIZE & (ENTITY_MANAGER_STACK_SIZE - 1)) == 0,
+  "ENTITY_MANAGER_STACK_SIZE must be a power of two");
+
+namespace xecs
+{
+/**
+ * @brief Recycling policy that reuses the last released entities first.
+ * 
+ * This recycler optimizes to use stack memory (could also be static memory). It contains
+ * a small stack allocated on the stack and a bigger stack allocated on the heap. The capacity of the stack memory stack
+ * is the StackCapacity template parameter, by default ENTITY_MANAGER_STACK_SIZE bytes. When the size of recycled entities
+ * exceed this amount, the entity manager will then go to the heap. The manager will always priorize fetching from the stack.
+ * It is possible to swap recycled values accumulated in the heap memory stack into the stack memory stack
+ * 
+ * The stack memory is part of the manager and the heap memory stack is allocated at construction. For registries
+ * that are small or created often, use a small stack capacity or heap_recycler.
+ * 
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ * @tparam StackCapacity Fixed capacity of entities for stack memory stack (optional)
+ */
+template<typename Entity, size_t StackCapacity = ENTITY_MANAGER_STACK_SIZE / sizeof(typename entity_traits<Entity>::entity_type)>
+class stack_recycler
+{
+public:
+  using entity_type = typename entity_traits<Entity>::entity_type;
+  using size_type = size_t;
+
+  static_assert(StackCapacity > 0, "Stack capacity must not be zero, use heap_recycler instead");
+
+  /**
+   * @brief Fixed capacity of entities for stack memory stack.
+   * 
+   */
+  static constexpr size_type stack_capacity = StackCapacity;
+
+  /**
+   * @brief Minimum capacity on entities for the heap memory stack.
+   * 
+   * Twice as big as stack.
+   */
+  static constexpr size_type minimum_heap_capacity = stack_capacity * 2;
+
+  /**
+   * @brief Whether or not the lowest entity is always recycled first.
+   */
+  static constexpr bool ordered = false;
+
+public:
+  using stack_buffer_type = entity_type[stack_capacity];
+  using heap_buffer_type = entity_type*;
+
+  /**
+   * @brief Construct a new stack recycler object
+   */
+  stack_recycler()
+    : _stack_reusable(0), _heap_reusable(0), _heap_capacity(minimum_heap_capacity), _stack_buffer()
+  {
+    _heap_buffer = static_cast<heap_buffer_type>(std::malloc(minimum_heap_capacity * sizeof(entity_type)));
+  }
+
+  /**
+   * @brief Destroy the stack recycler object
+   */
+  ~stack_recycler()
+  {
+    free(_heap_buffer);
+  }
+
+  stack_recycler(const stack_recycler&) = delete;
+  stack_recycler(stack_recycler&&) = delete;
+  stack_recycler& operator=(const stack_recycler&) = delete;
+  stack_recycler& operator=(stack_recycler&&) = delete;
+
+  /**
+   * @brief moves reusable heap memory entites into stack memory as best as possible.
+   * 
+   * This can be good to call every once in a while to insure that we use stack memory
+   * as much as possible by moving the entities accumulated in the heap.
+   */
+  void swap()
+  {
+    if (_heap_reusable && _stack_reusable != stack_capacity)
+    {
+      const auto stack_space = stack_capacity - _stack_reusable;
+      const auto swap_amount = _heap_reusable < stack_space ? _heap_reusable : stack_space;
+
+      void* dst_stack = static_cast<void*>(static_cast<entity_type*>(_stack_buffer) + _stack_reusable);
+      void* src_heap = _heap_buffer + _heap_reusable - swap_amount;
+
+      std::memcpy(dst_stack, src_heap, swap_amount * sizeof(entity_type));
+
+      _stack_reusable += swap_amount;
+      _heap_reusable -= swap_amount;
+    }
+  }
+
+  /**
+   * @brief Resizes the heap memory stack to be as small possible.
+   * 
+   * The heap memory cannot be smaller than minimum_heap_capacity.
+   * 
+   * This is good to call every once in a while to optimize memory usage.
+   */
+  void shrink_to_fit()
+  {
+    if (_heap_reusable != _heap_capacity && _heap_reusable > minimum_heap_capacity)
+    {
+      _heap_capacity = _heap_reusable;
+
+      _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+    }
+  }
+
+  /**
+   * @brief Returns the amount of reusable entities that are in stack memory.
+   * 
+   * @return size_type Amount of reusable entites in stack memory
+   */
+  [[nodiscard]] size_type stack_reusable() const { return _stack_reusable; }
+
+  /**
+   * @brief Returns the amount of reusable entities that are in heap memory.
+   * 
+   * @return size_type amount of reusable entites in heap memory
+   */
+  [[nodiscard]] size_type heap_reusable() const { return _heap_reusable; }
+
+  /**
+   * @brief Returns the total amount of reusable entities.
+   * 
+   * @return size_type Reusable entities
+   */
+  [[nodiscard]] size_type reusable() const { return _stack_reusable + _heap_reusable; }
+
+  /**
+   * @brief Returns the current capacity of the heap memory stack.
+   * 
+   * @return size_type Heap memory stack capacity
+   */
+  [[nodiscard]] size_type heap_capacity() const { return _heap_capacity; }
+
+protected:
+  /**
+   * @brief Adds an entity to the reusable entities.
+   * 
+   * @param entity Entity to add
+   */
+  void push(const entity_type entity)
+  {
+    if (_stack_reusable < stack_capacity) _stack_buffer[_stack_reusable++] = entity;
+    else
+    {
+      // Heap resizing should not happen very often
+      if (_heap_reusable == _heap_capacity)
+      {
+        // Grow by a factor of 1.25
+        // This is ok since we know the heap capacity starts off as a large amount
+        _heap_capacity = (_heap_capacity * 5) / 3;
+        _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+      }
+      _heap_buffer[_heap_reusable++] = entity;
+    }
+  }
+
+  /**
+   * @brief Removes a reusable entity.
+   * 
+   * @param entity Set to the removed entity
+   * @return true If there was a reusable entity, false otherwise
+   */
+  bool pop(entity_type& entity)
+  {
+    if (_stack_reusable) entity = _stack_buffer[--_stack_reusable];
+    else if (_heap_reusable)
+      entity = _heap_buffer[--_heap_reusable];
+    else
+      return false;
+
+    return true;
+  }
+
+  /**
+   * @brief Adds many entities to the reusable entities.
+   * 
+   * Entities are copied in the stack memory stack until it is full, then in the heap memory stack that is
+   * resized at most once.
+   * 
+   * @param entities Entities to add
+   * @param count Amount of entities
+   */
+  void push(const entity_type* entities, size_type count)
+  {
+    const size_type stack_space = stack_capacity - _stack_reusable;
+    const size_type stack_amount = count < stack_space ? count : stack_space;
+
+    std::memcpy(_stack_buffer + _stack_reusable, entities, stack_amount * sizeof(entity_type));
+
+    _stack_reusable += stack_amount;
+    entities += stack_amount;
+    count -= stack_amount;
+
+    if (count == 0) return;
+
+    if (_heap_reusable + count > _heap_capacity)
+    {
+      const size_type grown = (_heap_capacity * 5) / 3;
+
+      _heap_capacity = _heap_reusable + count > grown ? _heap_reusable + count : grown;
+      _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+    }
+
+    std::memcpy(_heap_buffer + _heap_reusable, entities, count * sizeof(entity_type));
+
+    _heap_reusable += count;
+  }
+
+  /**
+   * @brief Removes many reusable entities.
+   * 
+   * Entities are copied from the top of the stack memory stack first, then from the heap memory stack.
+   * 
+   * @param entities Set to the removed entities
+   * @param count Maximum amount of entities to remove
+   * @return size_type Amount of entities removed
+   */
+  size_type pop(entity_type* entities, const size_type count)
+  {
+    const size_type stack_amount = count < _stack_reusable ? count : _stack_reusable;
+
+    _stack_reusable -= stack_amount;
+
+    std::memcpy(entities, _stack_buffer + _stack_reusable, stack_amount * sizeof(entity_type));
+
+    const size_type remaining = count - stack_amount;
+    const size_type heap_amount = remaining < _heap_reusable ? remaining : _heap_reusable;
+
+    _heap_reusable -= heap_amount;
+
+    std::memcpy(entities + stack_amount, _heap_buffer + _heap_reusable, heap_amount * sizeof(entity_type));
+
+    return stack_amount + heap_amount;
+  }
+
+  /**
+   * @brief Removes every reusable entity.
+   */
+  void clear()
+  {
+    _stack_reusable = 0;
+    _heap_reusable = 0;
+  }
+
+private:
+  size_type _stack_reusable;
+  size_type _heap_reusable;
+  size_type _heap_capacity;
+
+  heap_buffer_type _heap_buffer;
+  stack_buffer_type _stack_buffer;
+};
+
+/**
+ * @brief Recycling policy that reuses the last released entities first, using only heap memory.
+ * 
+ * Nothing is allocated until the first entity is released, so a manager that never recycles costs only a few
+ * bytes. This is recommended when many registries exist at once.
+ * 
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ */
+template<typename Entity>
+class heap_recycler
+{
+public:
+  using entity_type = typename entity_traits<Entity>::entity_type;
+  using size_type = size_t;
+
+  /**
+   * @brief Whether or not the lowest entity is always recycled first.
+   */
+  static constexpr bool ordered = false;
+
+  /**
+   * @brief Construct a new heap recycler object
+   */
+  heap_recycler()
+    : _buffer(NULL), _reusable(0), _capacity(0)
+  {}
+
+  /**
+   * @brief Destroy the heap recycler object
+   */
+  ~heap_recycler()
+  {
+    if (_buffer) free(_buffer);
+  }
+
+  heap_recycler(const heap_recycler&) = delete;
+  heap_recycler(heap_recycler&&) = delete;
+  heap_recycler& operator=(const heap_recycler&) = delete;
+  heap_recycler& operator=(heap_recycler&&) = delete;
+
+  /**
+   * @brief Does nothing, exists to be interchangeable with other recyclers.
+   */
+  void swap() {}
+
+  /**
+   * @brief Resizes the heap memory to be as small as possible.
+   * 
+   * The memory is freed when there are no reusable entities.
+   */
+  void shrink_to_fit()
+  {
+    if (_reusable == _capacity) return;
+
+    _capacity = _reusable;
+
+    if (_capacity == 0)
+    {
+      free(_buffer);
+      _buffer = NULL;
+    }
+    else
+      _buffer = static_cast<entity_type*>(std::realloc(_buffer, _capacity * sizeof(entity_type)));
+  }
+
+  /**
+   * @brief Returns the total amount of reusable entities.
+   * 
+   * @return size_type Reusable entities
+   */
+  [[nodiscard]] size_type reusable() const { return _reusable; }
+
+  /**
+   * @brief Returns the current capacity of the heap memory.
+   * 
+   * @return size_type Heap memory capacity
+   */
+  [[nodiscard]] size_type heap_capacity() const { return _capacity; }
+
+protected:
+  /**
+   * @brief Adds an entity to the reusable entities.
+   * 
+   * @param entity Entity to add
+   */
+  void push(const entity_type entity)
+  {
+    if (_reusable == _capacity)
+    {
+      _capacity = (_capacity * 3) / 2 + 64;
+      _buffer = static_cast<entity_type*>(std::realloc(_buffer, _capacity * sizeof(entity_type)));
+    }
+
+    _buffer[_reusable++] = entity;
+  }
+
+  /**
+   * @brief Removes a reusable entity.
+   * 
+   * @param entity Set to the removed entity
+   * @return true If there was a reusable entity, false otherwise
+   */
+  bool pop(entity_type& entity)
+  {
+    if (_reusable == 0) return false;
+
+    entity = _buffer[--_reusable];
+
+    return true;
+  }
+
+  /**
+   * @brief Adds many entities to the reusable entities, resizing at most once.
+   * 
+   * @param entities Entities to add
+   * @param count Amount of entities
+   */
+  void push(const entity_type* entities, const size_type count)
+  {
+    if (_reusable + count > _capacity)
+    {
+      const size_type grown = (_capacity * 3) / 2 + 64;
+
+      _capacity = _reusable + count > grown ? _reusable + count : grown;
+      _buffer = static_cast<entity_type*>(std::realloc(_buffer, _capacity * sizeof(entity_type)));
+    }
+
+    std::memcpy(_buffer + _reusable, entities, count * sizeof(entity_type));
+
+    _reusable += count;
+  }
+
+  /**
+   * @brief Removes many reusable entities.
+   * 
+   * @param entities Set to the removed entities
+   * @param count Maximum amount of entities to remove
+   * @return size_type Amount of entities removed
+   */
+  size_type pop(entity_type* entities, const size_type count)
+  {
+    const size_type amount = count < _reusable ? count : _reusable;
+
+    _reusable -= amount;
+
+    if (amount) std::memcpy(entities, _buffer + _reusable, amount * sizeof(entity_type));
+
+    return amount;
+  }
+
+  /**
+   * @brief Removes every reusable entity.
+   */
+  void clear() { _reusable = 0; }
+
+private:
+  entity_type* _buffer;
+
+  size_type _reusable;
+  size_type _capacity;
+};
+
+/**
+ * @brief Recycling policy that never reuses entities.
+ * 
+ * The manager is then only a counter and holds no memory. This is usefull for short lived registries,
+ * where entities are all destroyed at once with destroy_all.
+ * 
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ */
+template<typename Entity>
+class no_recycler
+{
+public:
+  using entity_type = typename entity_traits<Entity>::entity_type;
+  using size_type = size_t;
+
+  /**
+   * @brief Whether or not the lowest entity is always recycled first.
+   */
+  static constexpr bool ordered = false;
+
+  /**
+   * @brief Does nothing, exists to be interchangeable with other recyclers.
+   */
+  void swap() {}
+
+  /**
+   * @brief Does nothing, exists to be interchangeable with other recyclers.
+   */
+  void shrink_to_fit() {}
+
+  /**
+   * @brief Returns the total amount of reusable entities, always zero.
+   * 
+   * @return size_type Reusable entities
+   */
+  [[nodiscard]] size_type reusable() const { return 0; }
+
+protected:
+  /**
+   * @brief Discards the entity.
+   * 
+   * @param entity Entity to discard
+   */
+  void push(const entity_type entity)
+  {
+    (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Never obtains a reusable entity.
+   * 
+   * @param entity Left untouched
+   * @return false Always
+   */
+  bool pop(entity_type& entity)
+  {
+    (void)entity; // Suppress unused warning
+    return false;
+  }
+
+  /**
+   * @brief Discards the entities.
+   * 
+   * @param entities Entities to discard
+   * @param count Amount of entities
+   */
+  void push(const entity_type* entities, const size_type count)
+  {
+    (void)entities; // Suppress unused warning
+    (void)count; // Suppress unused warning
+  }
+
+  /**
+   * @brief Never obtains reusable entities.
+   * 
+   * @param entities Left untouched
+   * @param count Maximum amount of entities
+   * @return size_type Always zero
+   */
+  size_type pop(entity_type* entities, const size_type count)
+  {
+    (void)entities; // Suppress unused warning
+    (void)count; // Suppress unused warning
+    return 0;
+  }
+
+  /**
+   * @brief Does nothing, there are no reusable entities.
+   */
+  void clear() {}
+};
+
+/**
+ * @brief Recycling policy that always reuses the lowest released entity first.
+ * 
+ * Released entities are kept in a hierarchical bitset: every bit of a level tells if a word of the level
+ * below has any bit set. The lowest released entity is then found with one find-first-set per level.
+ * 
+ * Live entities stay packed in the lowest range, and when the highest entities are released the internal
+ * counter of the manager goes back down. The range of the shared sparse_array then follows the live population
+ * instead of the historical peak.
+ * 
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ */
+template<typename Entity>
+class lowest_recycler
+{
+public:
+  using traits_type = entity_traits<Entity>;
+  using entity_type = typename traits_type::entity_type;
+  using size_type = size_t;
+
+  /**
+   * @brief Whether or not the lowest entity is always recycled first.
+   */
+  static constexpr bool ordered = true;
+
+  /**
+   * @brief Amount of levels, enough for every index.
+   */
+  static constexpr size_type levels = (traits_type::index_bits + 5) / 6;
+
+  /**
+   * @brief Construct a new lowest recycler object
+   */
+  lowest_recycler()
+    : _reusable(0)
+  {}
+
+  lowest_recycler(const lowest_recycler&) = delete;
+  lowest_recycler(lowest_recycler&&) = delete;
+  lowest_recycler& operator=(const lowest_recycler&) = delete;
+  lowest_recycler& operator=(lowest_recycler&&) = delete;
+
+  /**
+   * @brief Does nothing, exists to be interchangeable with other recyclers.
+   */
+  void swap() {}
+
+  /**
+   * @brief Does nothing, exists to be interchangeable with other recyclers.
+   */
+  void shrink_to_fit() {}
+
+  /**
+   * @brief Returns the total amount of reusable entities.
+   * 
+   * @return size_type Reusable entities
+   */
+  [[nodiscard]] size_type reusable() const { return _reusable; }
+
+protected:
+  /**
+   * @brief Adds an entity to the reusable entities.
+   * 
+   * Only the index of the entity is kept.
+   * 
+   * @param entity Entity to add
+   */
+  void push(const entity_type entity)
+  {
+    size_type index = traits_type::index(entity);
+
+    assure(index);
+
+    for (size_type level = 0; level < levels; level++)
+    {
+      auto& word = _levels[level].word(index / bitset::word_bits);
+
+      const bool propagate = word == 0;
+
+      word |= bitset::word_type { 1 } << (index % bitset::word_bits);
+
+      // The levels above already know this word is not empty
+      if (!propagate) break;
+
+      index /= bitset::word_bits;
+    }
+
+    ++_reusable;
+  }
+
+  /**
+   * @brief Removes the lowest reusable entity.
+   * 
+   * @param entity Set to the index of the removed entity
+   * @return true If there was a reusable entity, false otherwise
+   */
+  bool pop(entity_type& entity)
+  {
+    if (_reusable == 0) return false;
+
+    size_type index = 0;
+
+    for (size_type level = levels; level-- > 0;)
+    {
+      index = index * bitset::word_bits + lowest_bit(_levels[level].word(index));
+    }
+
+    entity = static_cast<entity_type>(index);
+
+    erase(index);
+
+    return true;
+  }
+
+  /**
+   * @brief Adds many entities to the reusable entities.
+   * 
+   * @param entities Entities to add
+   * @param count Amount of entities
+   */
+  void push(const entity_type* entities, const size_type count)
+  {
+    for (size_type i = 0; i < count; i++) push(entities[i]);
+  }
+
+  /**
+   * @brief Removes many of the lowest reusable entities, in increasing order.
+   * 
+   * @param entities Set to the removed entities
+   * @param count Maximum amount of entities to remove
+   * @return size_type Amount of entities removed
+   */
+  size_type pop(entity_type* entities, const size_type count)
+  {
+    size_type amount = 0;
+
+    while (amount < count && pop(entities[amount])) ++amount;
+
+    return amount;
+  }
+
+  /**
+   * @brief Removes an index from the reusable entities if it is reusable.
+   * 
+   * @param index Index to remove
+   * @return true If the index was reusable and was removed, false otherwise
+   */
+  bool take(const size_type index)
+  {
+    if (_reusable == 0 || index >= _levels[0].words() * bitset::word_bits || !_levels[0].test(index)) return false;
+
+    erase(index);
+
+    return true;
+  }
+
+  /**
+   * @brief Removes every reusable entity.
+   */
+  void clear()
+  {
+    for (auto& level : _levels) level.clear();
+
+    _reusable = 0;
+  }
+
+private:
+  /**
+   * @brief Clears the bit of a reusable index.
+   * 
+   * @param index Index to clear
+   */
+  void erase(size_type index)
+  {
+    for (size_type level = 0; level < levels; level++)
+    {
+      auto& word = _levels[level].word(index / bitset::word_bits);
+
+      word &= ~(bitset::word_type { 1 } << (index % bitset::word_bits));
+
+      // The levels above must still know this word is not empty
+      if (word != 0) break;
 
-static_assert((ENTITY_MANAGER_STACK_SIZE & (ENTITY_MANAGER_STACK_SIZE - 1)) == 0,
-  "ENTITY_MANAGER_STACK_SIZE must be a power of two");
+      index /= bitset::word_bits;
+    }
+
+    --_reusable;
+  }
+
+  /**
+   * @brief Assures every level can contain the index.
+   * 
+   * @param index Index to assure
+   */
+  void assure(size_type index)
+  {
+    for (size_type level = 0; level < levels; level++)
+    {
+      const size_type bits = _levels[level].words() * bitset::word_bits;
+
+      // Grow exponentially to resize rarely
+      if (index >= bits) _levels[level].resize(index + 1 > bits * 2 ? index + 1 : bits * 2);
+
+      index /= bitset::word_bits;
+    }
+  }
+
+private:
+  std::array<bitset, levels> _levels;
+
+  size_type _reusable;
+};
 
-namespace xecs
-{
 /**
  * @brief Manager responsible for distributing entities.
  * 
@@ -26,59 +753,57 @@ namespace xecs
  * can allow for a maximum of 65535 entities. A 32 bit identifier is much larger and can support 4,294,967,295 entities.
  * Anything more than 32 bit is probably overkill for the any game or simulation.
  * 
- * The entity manager is just a counter with a stack to be able to recycle entities.
+ * The entity manager is just a counter with a recycler to be able to recycle entities. The recycler is a policy
+ * the manager inherits from, stack_recycler reuses the last released entities first and lowest_recycler
+ * always reuses the lowest released entity first. The memory of the manager is mostly the one of the recycler,
+ * stack_recycler holds a stack memory buffer (16kb by default), heap_recycler allocates only once entities are
+ * released and no_recycler never recycles.
+ * 
+ * When the entity has version bits (see versioned), released entities are recycled with their next version, and the
+ * manager keeps the identifier of every generated index so that stale entities can be detected with a single comparison.
  * 
- * This particular entity manager optimizes to use stack memory (could also be static memory). It contains 
- * a small stack allocated on the stack and a bigger stack allocated on the heap. The size of the stack memory stack
- * is defined by ENTITY_MANAGER_STACK_SIZE. When the size of recycled entities exceed this amount, the entity manager
- * will then go to the heap. The manager will always priorize fetching from the stack. It is possible to swap recycled values
- * accumulated in the heap memory stack into the stack memory stack
+ * Ranges of entities can be reserved so that they are never generated by the counter. A reserved range is a pool
+ * that only distributes its own entities in increasing order, so that peers that use the same ranges generate the
+ * same entities (see reserve_range).
  * 
- * @tparam Entity unsigned integer type to represent entity
+ * @tparam Entity unsigned integer type to represent entity or entity descriptor (see entity_traits)
+ * @tparam Recycler Recycling policy (optional)
  */
-template<typename Entity>
-class entity_manager
+template<typename Entity, typename Recycler = stack_recycler<Entity>>
+class entity_manager : public Recycler
 {
 public:
-  using entity_type = Entity;
+  using traits_type = entity_traits<Entity>;
+  using entity_type = typename traits_type::entity_type;
   using size_type = size_t;
-
-  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
-    "Entity type must be an unsigned integer");
+  using recycler_type = Recycler;
 
   /**
-   * @brief Fixed capacity of entities for stack memory stack.
-   * 
+   * @brief Whether or not the entities have version bits.
    */
-  static constexpr size_type stack_capacity = ENTITY_MANAGER_STACK_SIZE / sizeof(entity_type);
+  static constexpr bool versioned = traits_type::version_bits != 0;
 
   /**
-   * @brief Minimum capacity on entities for the heap memory stack.
-   * 
-   * Twice as big as stack.
+   * @brief Whether or not entities can be reserved from any thread.
    */
-  static constexpr size_type minimum_heap_capacity = stack_capacity * 2;
-
-public:
-  using stack_buffer_type = entity_type[stack_capacity];
-  using heap_buffer_type = entity_type*;
+  static constexpr bool concurrent = false;
 
   /**
    * @brief Construct a new entity manager object
    * 
    */
   entity_manager()
-    : _current(0), _stack_reusable(0), _heap_reusable(0), _heap_capacity(minimum_heap_capacity), _stack_buffer()
-  {
-    _heap_buffer = static_cast<heap_buffer_type>(std::malloc(minimum_heap_capacity * sizeof(entity_type)));
-  }
+    : _current(0), _skip(std::numeric_limits<entity_type>::max()), _slots(NULL), _slots_size(0), _slots_capacity(0),
+      _ranges(NULL), _ranges_size(0)
+  {}
 
   /**
    * @brief Destroy the entity manager object
    */
   ~entity_manager()
   {
-    free(_heap_buffer);
+    if (_slots) free(_slots);
+    if (_ranges) free(_ranges);
   }
 
   entity_manager(const entity_manager&) = delete;
@@ -96,34 +821,230 @@ public:
    */
   entity_type generate()
   {
-    if (_stack_reusable) return _stack_buffer[--_stack_reusable];
-    else if (_heap_reusable)
-      return _heap_buffer[--_heap_reusable];
+    entity_type entity;
+
+    if (recycler_type::pop(entity))
+    {
+      // The slot holds the version to recycle
+      if constexpr (versioned) entity = occupy(traits_type::index(entity));
+
+      return entity;
+    }
+    else if constexpr (versioned)
+      return generate_slot();
+    else
+      return next_index();
+  }
+
+  /**
+   * @brief Reserves a range of entities that the counter will never generate.
+   * 
+   * The range becomes a pool that distributes its entities in increasing order with generate_from. Peers
+   * that reserve the same ranges in the same order obtain the same pools, and generate the same entities as long
+   * as they generate from them in the same order. Entities of reserved ranges are never recycled.
+   * 
+   * @code{.cpp}
+   * auto predicted = manager.reserve_range(1 << 20, 1 << 20); // Client predicted entities
+   * 
+   * auto entity = manager.generate_from(predicted);
+   * @endcode
+   * 
+   * @warning Undefined behaviour if the range overlaps another reserved range or an entity that was already generated,
+   * or if it contains the highest index.
+   * 
+   * @param begin First entity of the range
+   * @param count Amount of entities in the range
+   * @return size_type The pool of the range
+   */
+  size_type reserve_range(const entity_type begin, const size_type count)
+  {
+    assert(begin >= _current && "Entities of the range were already generated");
+    // The end of the range must be representable, so the range cannot contain the highest index
+    assert(count <= static_cast<size_type>(traits_type::index_mask - begin) && "Range exceeds the entity type");
+
+    _ranges = static_cast<range*>(std::realloc(_ranges, (_ranges_size + 1) * sizeof(range)));
+    _ranges[_ranges_size++] = { begin, static_cast<entity_type>(begin + count), begin };
+
+    skip_ranges();
+
+    return _ranges_size - 1;
+  }
+
+  /**
+   * @brief Generates the next entity of a reserved range.
+   * 
+   * @warning Undefined behaviour if every entity of the range was already generated.
+   * 
+   * @param pool Pool of the range (see reserve_range)
+   * @return entity_type The entity identifier generated
+   */
+  entity_type generate_from(const size_type pool)
+  {
+    assert(pool < _ranges_size && "Invalid pool");
+
+    range& current = _ranges[pool];
+
+    assert(current.next != current.end && "Every entity of the range was generated");
+
+    const entity_type index = current.next++;
+
+    if constexpr (versioned)
+    {
+      assure_slot(index);
+      return occupy(index);
+    }
+    else
+      return index;
+  }
+
+  /**
+   * @brief Marks an entity that was not generated by this manager as in use.
+   * 
+   * Used for entities given by a peer, usually from a reserved range. Only versioned entities need to be acquired,
+   * the identifier then becomes valid.
+   * 
+   * @warning Undefined behaviour if the entity is not in a reserved range and could be generated by the counter.
+   * 
+   * @param entity Entity to acquire
+   */
+  void acquire(const entity_type entity)
+  {
+    if constexpr (versioned)
+    {
+      const auto index = traits_type::index(entity);
+
+      assure_slot(index);
+      _slots[index] = entity;
+    }
+    else
+      (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Returns the amount of reserved ranges.
+   * 
+   * @return size_type Amount of reserved ranges
+   */
+  [[nodiscard]] size_type ranges() const { return _ranges_size; }
+
+  /**
+   * @brief Generates many unique entities at once.
+   * 
+   * Recycled entities are copied out of the recycler in bulk, and the remaining entities are obtained
+   * from the internal counter in a single loop.
+   * 
+   * @param entities Set to the generated entities
+   * @param count Amount of entities to generate
+   */
+  void generate(entity_type* entities, const size_type count)
+  {
+    const size_type recycled = recycler_type::pop(entities, count);
+
+    // The slots hold the versions to recycle
+    if constexpr (versioned)
+    {
+      for (size_type i = 0; i < recycled; i++) entities[i] = occupy(traits_type::index(entities[i]));
+    }
+
+    entity_type* remaining = entities + recycled;
+    const size_type amount = count - recycled;
+
+    if (amount == 0) return;
+
+    // Reserved ranges are only checked for the entities that may reach them
+    if (static_cast<size_type>(_skip - _current) < amount)
+    {
+      for (size_type i = 0; i < amount; i++) remaining[i] = versioned ? generate_slot() : next_index();
+
+      return;
+    }
+
+    if constexpr (versioned)
+    {
+      assure_slot(static_cast<entity_type>(_current + amount - 1));
+
+      for (size_type i = 0; i < amount; i++) remaining[i] = occupy(static_cast<entity_type>(_current + i));
+    }
     else
-      return _current++;
+    {
+      for (size_type i = 0; i < amount; i++) remaining[i] = static_cast<entity_type>(_current + i);
+    }
+
+    _current = static_cast<entity_type>(_current + amount);
   }
 
+  /**
+   * @brief Generates a unique entity to be inserted later.
+   * 
+   * Same as generate. Exists to be interchangeable with concurrent_entity_manager, where it is thread-safe.
+   * 
+   * @return entity_type The entity identifier generated
+   */
+  entity_type reserve() { return generate(); }
+
   /**
    * @brief Allows an entity to be reused.
    * 
-   * This will add the entity to pools of reusable entities.
+   * This will add the entity to pools of reusable entities. Versioned entities are added with their next version.
    * 
    * @param entity Entity to release
    */
   void release(entity_type entity)
   {
-    if (_stack_reusable < stack_capacity) _stack_buffer[_stack_reusable++] = entity;
-    else
+    if constexpr (versioned)
     {
-      // Heap resizing should not happen very often
-      if (_heap_reusable == _heap_capacity)
+      entity = traits_type::next_version(entity);
+
+      // The released identifier can no longer match, and neither can the next one until it is generated
+      _slots[traits_type::index(entity)] = vacant(entity);
+    }
+
+    // Entities of reserved ranges are only distributed by their range
+    if (_ranges_size && reserved(traits_type::index(entity))) return;
+
+    recycler_type::push(entity);
+
+    // Give the highest entities back to the counter
+    if constexpr (recycler_type::ordered)
+    {
+      while (_current && recycler_type::take(_current - 1)) --_current;
+    }
+  }
+
+  /**
+   * @brief Allows many entities to be reused at once.
+   * 
+   * Entities are copied into the recycler in bulk, which resizes at most once.
+   * 
+   * @param entities Entities to release
+   * @param count Amount of entities
+   */
+  void release(const entity_type* entities, const size_type count)
+  {
+    // Entities of reserved ranges must be filtered out
+    if (_ranges_size)
+    {
+      for (size_type i = 0; i < count; i++) release(entities[i]);
+
+      return;
+    }
+
+    if constexpr (versioned)
+    {
+      for (size_type i = 0; i < count; i++)
       {
-        // Grow by a factor of 1.25
-        // This is ok since we know the heap capacity starts off as a large amount
-        _heap_capacity = (_heap_capacity * 5) / 3;
-        _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+        const auto index = traits_type::index(entities[i]);
+
+        _slots[index] = vacant(traits_type::next_version(entities[i]));
       }
-      _heap_buffer[_heap_reusable++] = entity;
+    }
+
+    // Versioned entities are recycled from their slot, so the released identifiers can be kept as is
+    recycler_type::push(entities, count);
+
+    if constexpr (recycler_type::ordered)
+    {
+      while (_current && recycler_type::take(_current - 1)) --_current;
     }
   }
 
@@ -132,101 +1053,208 @@ public:
    * 
    * Resets the internal counter and clears reusable entities.
    * 
-   * This is a very cheap O(1) operation.
+   * This is a very cheap O(1) operation. With versioned entities, the version of every index generated so far
+   * is incremented, this is O(N). Reserved ranges are kept and start over from their first entity.
    */
   void release_all()
   {
-    _stack_reusable = 0;
-    _heap_reusable = 0;
+    recycler_type::clear();
+
     _current = 0;
+
+    for (size_type i = 0; i < _ranges_size; i++) _ranges[i].next = _ranges[i].begin;
+
+    skip_ranges();
+
+    if constexpr (versioned)
+    {
+      for (size_type i = 0; i < _slots_size; i++)
+      {
+        _slots[i] = vacant(traits_type::next_version(identifier(static_cast<entity_type>(i))));
+      }
+    }
   }
 
   /**
-   * @brief moves reusable heap memory entites into stack memory as best as possible.
+   * @brief Returns whether or not the entity was generated and not yet released.
    * 
-   * This can be good to call every once in a while to insure that we use stack memory
-   * as much as possible by moving the entities accumulated in the heap.
+   * A single comparison with the identifier of the index. Stale entities are never valid, unless
+   * the version wrapped around.
+   * 
+   * @param entity Entity to check
+   * @return true If the entity is valid, false otherwise
    */
-  void swap()
+  [[nodiscard]] bool valid(const entity_type entity) const
   {
-    if (_heap_reusable && _stack_reusable != stack_capacity)
+    static_assert(versioned, "Validity can only be checked for versioned entities");
+
+    const auto index = traits_type::index(entity);
+
+    return index < _slots_size && _slots[index] == entity;
+  }
+
+  /**
+   * @brief Reveals the current value of the internal counter.
+   * 
+   * @warning This value is not guaranted to be the next value to be generated.
+   * 
+   * @return entity_type Next entity for internal counter
+   */
+  [[nodiscard]] entity_type peek() const { return _current; }
+
+private:
+  /**
+   * @brief Range of reserved entities.
+   */
+  struct range
+  {
+    entity_type begin;
+    entity_type end;
+    entity_type next;
+  };
+
+  /**
+   * @brief Increments the internal counter, jumping over the reserved ranges.
+   * 
+   * @return entity_type The index generated
+   */
+  entity_type next_index()
+  {
+    if (_current == _skip) skip_ranges();
+
+    return _current++;
+  }
+
+  /**
+   * @brief Moves the internal counter after the reserved range it is in, and finds the next reserved range.
+   */
+  void skip_ranges()
+  {
+    // Ranges can follow each other
+    for (bool skipped = true; skipped;)
     {
-      const auto stack_space = stack_capacity - _stack_reusable;
-      const auto swap_amount = _heap_reusable < stack_space ? _heap_reusable : stack_space;
+      skipped = false;
 
-      void* dst_stack = static_cast<void*>(static_cast<entity_type*>(_stack_buffer) + _stack_reusable);
-      void* src_heap = _heap_buffer + _heap_reusable - swap_amount;
+      for (size_type i = 0; i < _ranges_size; i++)
+      {
+        if (_ranges[i].begin <= _current && _current < _ranges[i].end)
+        {
+          _current = _ranges[i].end;
+          skipped = true;
+        }
+      }
+    }
 
-      std::memcpy(dst_stack, src_heap, swap_amount * sizeof(entity_type));
+    _skip = std::numeric_limits<entity_type>::max();
 
-      _stack_reusable += swap_amount;
-      _heap_reusable -= swap_amount;
+    for (size_type i = 0; i < _ranges_size; i++)
+    {
+      if (_ranges[i].begin >= _current && _ranges[i].begin < _skip) _skip = _ranges[i].begin;
     }
   }
 
   /**
-   * @brief Resizes the heap memory stack to be as small possible.
-   * 
-   * The heap memory cannot be smaller than minimum_heap_capacity.
+   * @brief Returns whether or not an index is part of a reserved range.
    * 
-   * This is good to call every once in a while to optimize memory usage.
+   * @param index Index to check
+   * @return true If the index is reserved, false otherwise
    */
-  void shrink_to_fit()
+  [[nodiscard]] bool reserved(const entity_type index) const
   {
-    if (_heap_reusable != _heap_capacity && _heap_reusable > minimum_heap_capacity)
+    for (size_type i = 0; i < _ranges_size; i++)
     {
-      _heap_capacity = _heap_reusable;
-
-      _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+      if (_ranges[i].begin <= index && index < _ranges[i].end) return true;
     }
+
+    return false;
   }
 
   /**
-   * @brief Reveals the current value of the internal counter.
+   * @brief Generates a versioned entity from the internal counter.
    * 
-   * @warning This value is not guaranted to be the next value to be generated.
+   * Indexes used before a release_all keep their version.
    * 
-   * @return entity_type Next entity for internal counter
+   * @return entity_type The entity identifier generated
    */
-  [[nodiscard]] entity_type peek() const { return _current; }
+  entity_type generate_slot()
+  {
+    const entity_type index = next_index();
+
+    assure_slot(index);
+
+    return occupy(index);
+  }
 
   /**
-   * @brief Returns the amount of reusable entities that are in stack memory.
+   * @brief Returns how the slot of an identifier that is not in use is stored.
    * 
-   * @return size_type Amount of reusable entites in stack memory
+   * Every index bit is flipped, so the slot can never be equal to an identifier of its index, while the
+   * version to generate next is kept.
+   * 
+   * @param entity Identifier to generate next for the index
+   * @return entity_type Value of the slot
    */
-  [[nodiscard]] size_type stack_reusable() const { return _stack_reusable; }
+  static constexpr entity_type vacant(const entity_type entity) { return entity ^ traits_type::index_mask; }
 
   /**
-   * @brief Returns the amount of reusable entities that are in heap memory.
+   * @brief Returns the identifier of an index, the one in use or the one to generate next.
    * 
-   * @return size_type amount of reusable entites in heap memory
+   * @param index Index of the slot
+   * @return entity_type Identifier of the index
    */
-  [[nodiscard]] size_type heap_reusable() const { return _heap_reusable; }
+  entity_type identifier(const entity_type index) const
+  {
+    const entity_type slot = _slots[index];
+
+    return traits_type::index(slot) == index ? slot : vacant(slot);
+  }
 
   /**
-   * @brief Returns the total amount of reusable entities.
+   * @brief Marks the identifier of an index as in use, so that it is valid.
    * 
-   * @return size_type Reusable entities
+   * @param index Index of the slot
+   * @return entity_type Identifier of the index
    */
-  [[nodiscard]] size_type reusable() const { return _stack_reusable + _heap_reusable; }
+  entity_type occupy(const entity_type index)
+  {
+    _slots[index] = identifier(index);
+
+    return _slots[index];
+  }
 
   /**
-   * @brief Returns the current capacity of the heap memory stack.
+   * @brief Assures that the index has a slot, new slots are vacant with the first version of their index.
    * 
-   * @return size_type Heap memory stack capacity
+   * Slots are only valid once their identifier is generated or acquired, so the slots below a reserved range are
+   * never valid.
+   * 
+   * @param index Index to assure
    */
-  [[nodiscard]] size_type heap_capacity() const { return _heap_capacity; }
+  void assure_slot(const entity_type index)
+  {
+    if (index < _slots_size) return;
+
+    if (index >= _slots_capacity)
+    {
+      const size_type grown = (_slots_capacity * 3) / 2 + 64;
+
+      _slots_capacity = index < grown ? grown : static_cast<size_type>(index) + 1;
+      _slots = static_cast<entity_type*>(std::realloc(_slots, _slots_capacity * sizeof(entity_type)));
+    }
+
+    for (; _slots_size <= index; _slots_size++) _slots[_slots_size] = vacant(static_cast<entity_type>(_slots_size));
+  }
 
 private:
   entity_type _current;
+  entity_type _skip;
 
-  size_type _stack_reusable;
-  size_type _heap_reusable;
-  size_type _heap_capacity;
+  entity_type* _slots;
+  size_type _slots_size;
+  size_type _slots_capacity;
 
-  heap_buffer_type _heap_buffer;
-  stack_buffer_type _stack_buffer;
+  range* _ranges;
+  size_type _ranges_size;
 };
 } // namespace xecs
 
@@ -0,0 +1,152 @@
+#ifndef XECS_MEMORY_HPP
+#define XECS_MEMORY_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if __linux__
+#include <sys/mman.h> // For madvise
+#endif
+
+#if _MSC_VER
+#include <xmmintrin.h> // For _mm_prefetch
+#endif
+
+namespace xecs
+{
+/**
+ * @brief Size of a huge page, in bytes.
+ */
+static constexpr size_t huge_page_size = size_t { 1 } << 21; // 2 MiB
+
+/**
+ * @brief Hints the processor to load the cache line of an address.
+ * 
+ * Never faults, the address can be anything.
+ * 
+ * @param address Address to load
+ */
+inline void prefetch(const void* address)
+{
+#if _MSC_VER
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+  __builtin_prefetch(address);
+#endif
+}
+
+/**
+ * @brief Header in front of memory obtained from huge_realloc.
+ * 
+ * Padded to a cache line so that huge allocations start on a cache line.
+ */
+struct huge_header
+{
+  void* base;
+  bool huge;
+  char padding[64 - sizeof(void*) - sizeof(bool)];
+};
+
+static_assert(sizeof(huge_header) == 64, "Huge header must be a cache line");
+
+/**
+ * @brief Releases memory obtained from huge_realloc.
+ * 
+ * @param memory Memory to release, can be NULL
+ */
+inline void huge_free(void* memory)
+{
+  if (memory) free((static_cast<huge_header*>(memory) - 1)->base);
+}
+
+/**
+ * @brief Resizes memory, backing it with huge pages when it is big enough.
+ * 
+ * Allocations of at least a huge page are aligned on huge pages and rounded up to a multiple of the huge page size,
+ * then the kernel is advised to back them with transparent huge pages. Big arrays then need far fewer TLB entries
+ * when iterated. Smaller allocations, platforms without transparent huge pages and failed aligned allocations
+ * fall back to realloc.
+ * 
+ * The start of every huge allocation is staggered by a different amount. Otherwise, arrays iterated together would
+ * all map to the same cache sets, since huge pages make their physical addresses equal modulo the huge page size.
+ * 
+ * Unlike realloc, huge allocations are always moved, so this should only be used for arrays that grow geometrically.
+ * 
+ * @warning The memory must be released with huge_free.
+ * 
+ * @param memory Memory to resize, can be NULL
+ * @param size Current size of the memory in bytes, only used to copy the memory
+ * @param new_size Size to resize to in bytes
+ * @return void* Resized memory, NULL if the new size is zero
+ */
+inline void* huge_realloc(void* memory, const size_t size, const size_t new_size)
+{
+  if (new_size == 0)
+  {
+    huge_free(memory);
+    return NULL;
+  }
+
+  huge_header* header = memory ? static_cast<huge_header*>(memory) - 1 : NULL;
+
+#if __linux__
+  if (new_size >= huge_page_size)
+  {
+    static std::atomic<size_t> rotation { 0 };
+
+    // Every stagger starts on a different page and a different cache line
+    const size_t stagger = (rotation.fetch_add(1, std::memory_order_relaxed) % 16) * (4096 + 64);
+
+    const size_t total = new_size + stagger + sizeof(huge_header);
+    const size_t rounded = (total + huge_page_size - 1) & ~(huge_page_size - 1);
+
+    void* base = std::aligned_alloc(huge_page_size, rounded);
+
+    if (base)
+    {
+      // When refused, the memory is simply backed by regular pages
+      madvise(base, rounded, MADV_HUGEPAGE);
+
+      huge_header* allocated = reinterpret_cast<huge_header*>(static_cast<char*>(base) + stagger);
+
+      allocated->base = base;
+      allocated->huge = true;
+
+      if (memory)
+      {
+        std::memcpy(allocated + 1, memory, size < new_size ? size : new_size);
+        free(header->base);
+      }
+
+      return allocated + 1;
+    }
+  }
+#endif
+
+  // Regular memory always starts with the header, so it can be resized in place
+  if (header && !header->huge)
+  {
+    header = static_cast<huge_header*>(std::realloc(header, new_size + sizeof(huge_header)));
+  }
+  else
+  {
+    huge_header* allocated = static_cast<huge_header*>(std::malloc(new_size + sizeof(huge_header)));
+
+    if (memory)
+    {
+      std::memcpy(allocated + 1, memory, size < new_size ? size : new_size);
+      free(header->base);
+    }
+
+    header = allocated;
+  }
+
+  header->base = header;
+  header->huge = false;
+
+  return header + 1;
+}
+} // namespace xecs
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef XECS_OBSERVER_HPP
+#define XECS_OBSERVER_HPP
+
+#include "archetype.hpp"
+#include "entity.hpp"
+#include "storage.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Listeners of the components of an observed archetype.
+ * 
+ * Only archetypes that are observed (see storage_traits) have listeners, the observer set of the other
+ * archetypes is empty and the registry does not notify it at all.
+ * 
+ * A listener is invoked either for every entity with the entity and its component:
+ * 
+ * @code{.cpp}
+ * [](auto entity, Position& position) {}
+ * @endcode
+ * 
+ * Or once per operation with the span of entities (a span of one for operations on a single entity):
+ * 
+ * @code{.cpp}
+ * [](const entity_type* entities, size_t count) {}
+ * @endcode
+ * 
+ * @tparam Entity unsigned integer entity identifier or entity descriptor (see entity_traits)
+ * @tparam Archetype Archetype to observe
+ * @tparam Observed Whether or not the archetype is observed
+ */
+template<typename Entity, typename Archetype, bool Observed = storage_traits<Archetype>::observed>
+class observer_set
+{
+public:
+  static constexpr bool observed = false;
+};
+
+template<typename Entity, typename... Components>
+class observer_set<Entity, archetype<Components...>, true>
+{
+public:
+  using entity_type = typename entity_traits<Entity>::entity_type;
+  using size_type = size_t;
+
+  template<typename Component>
+  using listener_type = std::function<void(entity_type, Component&)>;
+
+  using batch_listener_type = std::function<void(const entity_type*, size_type)>;
+
+  static constexpr bool observed = true;
+
+  /**
+   * @brief Adds a listener invoked after entities obtain a component.
+   * 
+   * @tparam Component Component to listen to
+   * @tparam Listener Listener type
+   * @param listener Listener invoked with every entity and its component, or with the span of entities
+   */
+  template<typename Component, typename Listener>
+  void on_construct(const Listener& listener)
+  {
+    add<Component>(_constructed, listener);
+  }
+
+  /**
+   * @brief Adds a listener invoked before entities lose a component.
+   * 
+   * @tparam Component Component to listen to
+   * @tparam Listener Listener type
+   * @param listener Listener invoked with every entity and its component, or with the span of entities
+   */
+  template<typename Component, typename Listener>
+  void on_destroy(const Listener& listener)
+  {
+    add<Component>(_destroyed, listener);
+  }
+
+  /**
+   * @brief Notifies that entities entered the archetype.
+   * 
+   * Only the listeners of the components that the entities did not have before are invoked.
+   * 
+   * @tparam Source Components the entities had before
+   * @tparam Storage Storage type of the archetype
+   * @param storage Storage of the archetype, the entities must be in it
+   * @param entities Entities that entered the archetype
+   * @param count Amount of entities
+   */
+  template<typename Source, typename Storage>
+  void entered(Storage& storage, const entity_type* entities, const size_type count)
+  {
+    (notify<Source, Components>(_constructed, storage, entities, count), ...);
+  }
+
+  /**
+   * @brief Notifies that entities are about to leave the archetype.
+   * 
+   * Only the listeners of the components that the entities will not have anymore are invoked.
+   * 
+   * @tparam Target Components the entities will have after
+   * @tparam Storage Storage type of the archetype
+   * @param storage Storage of the archetype, the entities must still be in it
+   * @param entities Entities that leave the archetype
+   * @param count Amount of entities
+   */
+  template<typename Target, typename Storage>
+  void leaving(Storage& storage, const entity_type* entities, const size_type count)
+  {
+    (notify<Target, Components>(_destroyed, storage, entities, count), ...);
+  }
+
+private:
+  /**
+   * @brief Listeners of one event for every component.
+   */
+  struct listeners
+  {
+    std::tuple<std::vector<listener_type<Components>>...> single;
+    std::array<std::vector<batch_listener_type>, sizeof...(Components)> batched;
+  };
+
+  /**
+   * @brief Adds a listener of an event.
+   * 
+   * @tparam Component Component to listen to
+   * @tparam Listener Listener type
+   * @param event Listeners of the event
+   * @param listener Listener to add
+   */
+  template<typename Component, typename Listener>
+  static void add(listeners& event, const Listener& listener)
+  {
+    static_assert(contains_v<Component, list<Components...>>, "The component does not belong to the archetype");
+
+    if constexpr (std::is_invocable_v<const Listener&, entity_type, Component&>)
+    {
+      std::get<std::vector<listener_type<Component>>>(event.single).push_back(listener);
+    }
+    else
+    {
+      static_assert(std::is_invocable_v<const Listener&, const entity_type*, size_type>,
+        "Listeners must be invocable with an entity and its component or with a span of entities");
+
+      event.batched[find_v<Component, list<Components...>>].push_back(listener);
+    }
+  }
+
+  /**
+   * @brief Invokes the listeners of an event for a component, unless the component is excluded.
+   * 
+   * @tparam Excluded Components that are not notified
+   * @tparam Component Component to notify
+   * @tparam Storage Storage type of the archetype
+   * @param event Listeners of the event
+   * @param storage Storage of the archetype
+   * @param entities Entities to notify
+   * @param count Amount of entities
+   */
+  template<typename Excluded, typename Component, typename Storage>
+  static void notify(listeners& event, Storage& storage, const entity_type* entities, const size_type count)
+  {
+    if constexpr (!contains_v<Component, Excluded>)
+    {
+      for (auto& listener : std::get<std::vector<listener_type<Component>>>(event.single))
+      {
+        for (size_type i = 0; i < count; i++) listener(entities[i], storage.template unpack<Component>(entities[i]));
+      }
+
+      for (auto& listener : event.batched[find_v<Component, list<Components...>>]) listener(entities, count);
+    }
+    else
+    {
+      (void)event; // Suppress unused warning
+      (void)storage;
+      (void)entities;
+      (void)count;
+    }
+  }
+
+private:
+  listeners _constructed;
+  listeners _destroyed;
+};
+} // namespace xecs
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef XECS_QUERY_HPP
+#define XECS_QUERY_HPP
+
+#include "archetype.hpp"
+#include "storage.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace xecs
+{
+/**
+ * @brief Persistent query whose matching entities are kept up to date incrementally.
+ * 
+ * The query holds the list of entities that have the components and satisfy the predicate. The list is built once
+ * by evaluating every entity of the view, then only the entities that change are evaluated again:
+ * 
+ * - Entities that obtain one of the components, when created or when their archetype changes, are evaluated.
+ * - Entities that lose one of the components, when destroyed or when their archetype changes, are removed.
+ * - Entities whose components are dirty (see storage_traits) are evaluated by update.
+ * 
+ * Components written without dirty bits are not evaluated again, mark them as dirty (see registry::mark_dirty).
+ * 
+ * Iterating the query looks the matching entities up in batches (see registry::for_each), so its cost is about the
+ * amount of matching entities, even if they are a small part of the view.
+ * 
+ * @code{.cpp}
+ * auto& wounded = registry.cache<Health>([](auto entity, const Health& health) { return health.value < 10; });
+ * 
+ * registry.for_each_dirty<Health>([](auto entity, Health& health) { health.value += 1; });
+ * 
+ * wounded.update();
+ * registry.clear_dirty<Health>();
+ * 
+ * wounded.for_each([](auto entity, Health& health) {});
+ * @endcode
+ * 
+ * Queries are created by the registry and live as long as it (see registry::cache).
+ * 
+ * @tparam Registry Registry type of the query
+ * @tparam Components Components of the query
+ */
+template<typename Registry, typename... Components>
+class cached_query
+{
+public:
+  using registry_type = Registry;
+  using entity_type = typename registry_type::entity_type;
+  using archetype_list_type = typename registry_type::archetype_list_type;
+  using archetype_list_view_type = prune_for_list_t<archetype_list_type, list<Components...>>;
+  using predicate_type = std::function<bool(entity_type, const Components&...)>;
+  using match_storage_type = typename registry_type::template storage_type<archetype<>>;
+  using size_type = size_t;
+
+  static_assert(sizeof...(Components) > 0, "Queries must have atleast one component");
+  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes with the components of the query");
+
+private:
+  /**
+   * @brief Returns whether or not every archetype of a list is observed.
+   * 
+   * @tparam Archetypes Archetypes to check
+   * @return true If every archetype is observed
+   */
+  template<typename... Archetypes>
+  static constexpr bool observes(list<Archetypes...>)
+  {
+    return (storage_traits<Archetypes>::observed && ...);
+  }
+
+  static_assert(observes(archetype_list_view_type {}),
+    "Every archetype with the components of the query must be observed, see storage_traits");
+
+public:
+  /**
+   * @brief Construct a new cached query object
+   * 
+   * Use registry::cache instead, the query must live as long as the registry.
+   * 
+   * @param registry Registry to query
+   * @param predicate Predicate invoked with the entity and const references to its components
+   */
+  cached_query(registry_type& registry, predicate_type predicate)
+    : _registry(&registry), _predicate(std::move(predicate))
+  {
+    (listen<Components>(), ...);
+
+    build(archetype_list_view_type {});
+  }
+
+  cached_query(const cached_query&) = delete;
+  cached_query& operator=(const cached_query&) = delete;
+
+  /**
+   * @brief Evaluates again the entities whose components of the query are dirty.
+   * 
+   * Only the components with dirty bits are checked (see storage_traits). Dirty bits are not cleared, since
+   * other queries or systems may need them, see registry::clear_dirty.
+   */
+  void update() { update(archetype_list_view_type {}); }
+
+  /**
+   * @brief Calls the given function for every matching entity.
+   * 
+   * The provided function must contain every component of the query as an argument.
+   * 
+   * @warning The function must not create or destroy entities or change their archetype.
+   * 
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke for every matching entity
+   */
+  template<typename Callable>
+  void for_each(const Callable& callable)
+  {
+    _registry->template for_each<Components...>(_matches.data(), _matches.size(), callable);
+  }
+
+  /**
+   * @brief Returns whether or not an entity matches the query.
+   * 
+   * @param entity Entity to check
+   * @return true If the entity matches, false otherwise
+   */
+  [[nodiscard]] bool contains(const entity_type entity) const { return _matches.contains(entity); }
+
+  /**
+   * @brief Returns the amount of matching entities.
+   * 
+   * @return size_type Amount of matching entities
+   */
+  [[nodiscard]] size_type size() const { return _matches.size(); }
+
+  /**
+   * @brief Returns whether or not no entity matches the query.
+   * 
+   * @return true If no entity matches, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _matches.empty(); }
+
+  /**
+   * @brief Replaces the identifier of every matching entity, the matches are not evaluated again.
+   * 
+   * Used by registry::compact_ids.
+   * 
+   * @tparam Function Function type
+   * @param function Function invoked with every matching entity, returns its new identifier
+   */
+  template<typename Function>
+  void remap(const Function& function)
+  {
+    _matches.remap([&function](const entity_type entity, size_type) { return function(entity); });
+  }
+
+private:
+  /**
+   * @brief Listens to the construction and destruction of a component.
+   * 
+   * @tparam Component Component to listen to
+   */
+  template<typename Component>
+  void listen()
+  {
+    _registry->template on_construct<Component>([this](const entity_type* entities, const size_type count)
+      { entered(entities, count); });
+
+    _registry->template on_destroy<Component>([this](const entity_type* entities, const size_type count)
+      {
+        for (size_type i = 0; i < count; i++)
+          if (_matches.contains(entities[i])) _matches.erase(entities[i]);
+      });
+  }
+
+  /**
+   * @brief Evaluates entities that obtained one of the components.
+   * 
+   * The listeners of every archetype with the component are invoked, so the entities may not have all the
+   * components of the query yet. Entities already matching were evaluated by the listener of another component.
+   * 
+   * @param entities Entities that obtained the component
+   * @param count Amount of entities
+   */
+  void entered(const entity_type* entities, const size_type count)
+  {
+    auto view = _registry->template view<Components...>();
+
+    for (size_type i = 0; i < count; i++)
+    {
+      const entity_type entity = entities[i];
+
+      if (!_matches.contains(entity) && view.contains(entity) && _predicate(entity, view.template read<Components>(entity)...))
+        _matches.insert(entity);
+    }
+  }
+
+  /**
+   * @brief Evaluates every entity of the archetypes.
+   * 
+   * Disabled entities are evaluated too, they match again once enabled.
+   * 
+   * @tparam Archetypes Archetypes of the view
+   */
+  template<typename... Archetypes>
+  void build(list<Archetypes...>)
+  {
+    ((build(std::as_const(_registry->template access<Archetypes>()))), ...);
+  }
+
+  /**
+   * @brief Evaluates every entity of a storage.
+   * 
+   * @tparam Storage Storage type
+   * @param storage Storage to evaluate
+   */
+  template<typename Storage>
+  void build(const Storage& storage)
+  {
+    const entity_type* entities = storage.data();
+
+    for (size_type i = 0; i < storage.rows(); i++)
+    {
+      // The dense array of dead rows left by deferred erases does not hold entities
+      if (storage.alive(i) && _predicate(entities[i], storage.template unpack<Components>(entities[i])...))
+        _matches.insert(entities[i]);
+    }
+  }
+
+  /**
+   * @brief Evaluates again the dirty entities of the archetypes.
+   * 
+   * @tparam Archetypes Archetypes of the view
+   */
+  template<typename... Archetypes>
+  void update(list<Archetypes...>)
+  {
+    ((update(_registry->template access<Archetypes>())), ...);
+  }
+
+  /**
+   * @brief Evaluates again the dirty entities of a storage, for every component with dirty bits.
+   * 
+   * An entity is evaluated once per dirty component, which is harmless since evaluating is idempotent.
+   * 
+   * @tparam Storage Storage type
+   * @param storage Storage to evaluate
+   */
+  template<typename Storage>
+  void update(Storage& storage)
+  {
+    ((update<Components>(storage)), ...);
+  }
+
+  /**
+   * @brief Evaluates again the entities of a storage whose component is dirty.
+   * 
+   * @tparam Component Component to check
+   * @tparam Storage Storage type
+   * @param storage Storage to evaluate
+   */
+  template<typename Component, typename Storage>
+  void update(Storage& storage)
+  {
+    if constexpr (Storage::template tracks_dirty<Component>)
+    {
+      storage.template each_dirty<Component>([this](const auto& it)
+        {
+          const entity_type entity = *it;
+
+          if (_predicate(entity, it.template unpack<Components>()...))
+          {
+            if (!_matches.contains(entity)) _matches.insert(entity);
+          }
+          else if (_matches.contains(entity))
+            _matches.erase(entity);
+        });
+    }
+    else
+      (void)storage; // Suppress unused warning
+  }
+
+private:
+  registry_type* _registry;
+  predicate_type _predicate;
+  match_storage_type _matches;
+};
+} // namespace xecs
+
+#endif
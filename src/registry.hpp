@@ -2,12 +2,17 @@
 #define XECS_REGISTRY_HPP
 
 #include "archetype.hpp"
+#include "concurrent_entity_manager.hpp"
 #include "entity_manager.hpp"
+#include "observer.hpp"
+#include "query.hpp"
 #include "storage.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -15,9 +20,13 @@
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace xecs
 {
+template<typename Registry>
+class command_buffer;
+
 /**
  * @brief Entity-component system core contaner.
  * 
@@ -34,29 +43,50 @@ namespace xecs
  * This registry leverages its knowledge of all achetypes at compile time, to reduce 
  * the complexity of many operations, who often times can be reduced to nearly no overhead.
  * 
- * @tparam Entity The unsigned integer entity type
+ * Components that are added and removed very often can be declared as side components. Side components
+ * are not part of any archetype, each one of them is stored in its own sparse set. Adding or removing a side
+ * component never moves the entity between archetype storages and does not require any extra archetype.
+ * Views that contain side components iterate the archetypes and skip the entities that dont have the side components.
+ * 
+ * The entity type can reserve upper bits for a version (see versioned). Destroyed entities are then recycled with
+ * a new version, and stale entities can be detected with the valid method in constant time.
+ * 
+ * @tparam Entity The unsigned integer entity type or entity descriptor (see entity_traits)
  * @tparam ArchetypeList The list of all archetypes to be used by this registry
+ * @tparam SideComponentList The list of components stored outside of the archetypes (optional)
+ * @tparam Manager The entity manager type, concurrent_entity_manager allows reserving entities from any thread (optional)
  */
-template<typename Entity, typename ArchetypeList>
+template<typename Entity, typename ArchetypeList, typename SideComponentList = list<>, typename Manager = entity_manager<Entity>>
 class registry;
 
-template<typename Entity, typename... Archetypes>
-class registry<Entity, list<Archetypes...>> : verify_archetype_list<list<Archetypes...>>
+template<typename Entity, typename... Archetypes, typename... SideComponents, typename Manager>
+class registry<Entity, list<Archetypes...>, list<SideComponents...>, Manager>
+  : verify_archetype_list<list<Archetypes...>>, verify_archetype_list<list<archetype<SideComponents>...>>
 {
 public:
-  using entity_type = Entity;
+  using traits_type = entity_traits<Entity>;
+  using entity_type = typename traits_type::entity_type;
   using archetype_list_type = list<Archetypes...>;
-  using registry_type = registry<entity_type, archetype_list_type>;
-  using pool_type = std::tuple<storage<entity_type, Archetypes>...>;
-  using shared_type = sparse_array<entity_type>;
-  using manager_type = entity_manager<entity_type>;
+  using side_component_list_type = list<SideComponents...>;
+  using registry_type = registry<Entity, archetype_list_type, side_component_list_type, Manager>;
+  using pool_type = std::tuple<storage<Entity, Archetypes>...>;
+  using side_pool_type = std::tuple<storage<Entity, archetype<SideComponents>>...>;
+  using shared_type = sparse_array<Entity>;
+  using manager_type = Manager;
+  using observer_pool_type = std::tuple<observer_set<Entity, Archetypes>...>;
 
-  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
-    "Entity type must be an unsigned integer");
+  template<typename Archetype>
+  using storage_type = storage<Entity, Archetype>;
 
   static_assert(sizeof...(Archetypes) > 0, "Registry must contain atleast one archetype");
 
+  static_assert(((size_v<prune_for_t<archetype_list_type, SideComponents>> == 0) && ...),
+    "Side components cannot be part of an archetype");
+
 private:
+  template<typename>
+  friend class command_buffer;
+
   /**
    * @brief A registry view.
    * 
@@ -73,11 +103,30 @@ private:
   template<typename... Components>
   class basic_view;
 
+  /**
+   * @brief Whether or not the storage of an archetype is enableable.
+   * 
+   * @tparam Archetype Archetype to check
+   */
+  template<typename Archetype>
+  struct is_enableable : std::bool_constant<storage<Entity, Archetype>::enableable>
+  {};
+
+  /**
+   * @brief Whether or not the storage of an archetype is grouped.
+   * 
+   * @tparam Archetype Archetype to check
+   */
+  template<typename Archetype>
+  struct is_grouped : std::bool_constant<storage<Entity, Archetype>::grouped>
+  {};
+
 public:
   /**
    * @brief Construct a new registry object
    */
   registry()
+    : _version(1)
   {
     setup_shared_memory();
   }
@@ -118,9 +167,66 @@ public:
 
     access<current>().insert(entity, components...);
 
+    notify_entered<current>(&entity, 1);
+
     return entity;
   }
 
+  /**
+   * @brief Reserves an entity without creating it.
+   * 
+   * With a concurrent_entity_manager, this can be called from any thread while the registry is in use. The
+   * entity can then be created later at a sync point with the emplace method.
+   * 
+   * @return entity_type The reserved entity's identifier
+   */
+  entity_type reserve() { return _manager.reserve(); }
+
+  /**
+   * @brief Creates a reserved entity and initializes it with the given components.
+   * 
+   * Same as create, but for an entity that was obtained from the reserve method.
+   * 
+   * @warning Undefined behaviour if the entity was not reserved or was already emplaced.
+   * 
+   * @tparam Components The exact component types of one of the registry archetypes
+   * @param entity The reserved entity
+   * @param components The components to initialize with
+   */
+  template<typename... Components>
+  void emplace(const entity_type entity, const Components&... components)
+  {
+    using current = find_for_t<list<Archetypes...>, Components...>;
+
+    static_assert(size_v<current> == sizeof...(Components),
+      "Registry does not contain suitable archetype for provided components");
+
+    access<current>().insert(entity, components...);
+
+    notify_entered<current>(&entity, 1);
+  }
+
+  /**
+   * @brief Creates an entity with a known identifier and initializes it with the given components.
+   * 
+   * Same as create, but the identifier is not generated. This is used to create the entities of a peer with
+   * the same identifiers, usually from a range reserved in the entity manager so that they never collide
+   * with generated entities (see entity_manager::reserve_range).
+   * 
+   * @warning Undefined behaviour if the entity already exists or could be generated by the entity manager.
+   * 
+   * @tparam Components The exact component types of one of the registry archetypes
+   * @param entity The identifier of the entity to create
+   * @param components The components to initialize with
+   */
+  template<typename... Components>
+  void create_with_id(const entity_type entity, const Components&... components)
+  {
+    if constexpr (manager_type::versioned) _manager.acquire(entity);
+
+    emplace(entity, components...);
+  }
+
   /**
    * @brief Destroys the specified entity.
    * 
@@ -147,11 +253,15 @@ public:
    * @brief Destroys all entites in the registry.
    * 
    * This is a very cheap way to destroy all entities. Much faster than destroying each one
-   * individually. You should use this if you can.
+   * individually. You should use this if you can. The destroy listeners of observed archetypes are
+   * invoked once with all their entities.
    */
   void destroy_all()
   {
+    ((notify_cleared<Archetypes>()), ...);
+
     ((access<Archetypes>().clear()), ...);
+    ((side_access<SideComponents>().clear()), ...);
 
     _manager.release_all();
   }
@@ -166,15 +276,112 @@ public:
    * to make sure your ressources are being use optimally.
    * 
    * @note You should consider using this if your application is running for a long time.
+   * 
+   * The sparse_array is shrunk down to the highest live entity. Combine with compact_ids or lowest_recycler
+   * so that the highest live entity comes down after a spike.
    */
   void optimize()
   {
     ((access<Archetypes>().shrink_to_fit()), ...);
+    ((side_access<SideComponents>().shrink_to_fit()), ...);
+
+    _shared.shrink_to_fit(reach());
 
     _manager.swap();
     _manager.shrink_to_fit();
   }
 
+  /**
+   * @brief Removes the dead rows of every storage with deferred erase (see storage_traits).
+   * 
+   * This is a single streaming pass per storage that has dead rows. Ordered storages also merge the
+   * entities created out of order. Call it once per tick at a point where
+   * nothing is being iterated. Storages with stable addresses are skipped, their dead rows are reused instead.
+   */
+  void compact()
+  {
+    ((compact_storage(access<Archetypes>())), ...);
+    ((compact_storage(side_access<SideComponents>())), ...);
+  }
+
+  /**
+   * @brief Renumbers every entity so that the entities occupy the lowest identifiers.
+   * 
+   * After a spike of entities, the counter of the entity manager and the sparse_array stay as high as the
+   * highest entity ever created. This releases all entities and generates them again in a dense low range,
+   * then rewrites the dense arrays and the sparse_array storage by storage. Components are never moved.
+   * 
+   * The callable is invoked once per entity with its old and its new identifier, so that identifiers
+   * held elsewhere can be patched. With versioned entities, the new identifiers have a new version so
+   * the old identifiers are no longer valid.
+   * 
+   * This is O(N) where N is the amount of entities, and the sparse_array can be shrunk afterwards.
+   * 
+   * @warning Every identifier held elsewhere is invalidated, and the rows of storages with stable addresses are
+   * compacted. Reserved entities that were not emplaced yet
+   * are lost, and entities of reserved ranges are renumbered out of their range. With a concurrent_entity_manager, no cache must be in use. The callable must not modify the registry.
+   * 
+   * @tparam Callable The callable type
+   * @param callable Callable invoked with the old and the new identifier of every entity
+   */
+  template<typename Callable>
+  void compact_ids(const Callable& callable)
+  {
+    // Entities are numbered by their row, so every dead row must be gone, even with stable addresses
+    ((compact_storage<true>(access<Archetypes>())), ...);
+    ((compact_storage<true>(side_access<SideComponents>())), ...);
+
+    const size_t count = (access<Archetypes>().size() + ...);
+
+    entity_type* ids = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+
+    _manager.release_all();
+
+    for (size_t i = 0; i < count; i++) ids[i] = _manager.generate();
+
+    // Side components find the new identifiers through the shared sparse_array, so they are remapped first
+    ((side_access<SideComponents>().remap([this, ids](const entity_type entity, size_t)
+       { return remapped(entity, ids); })),
+      ...);
+
+    // Same for the matching entities of the cached queries
+    for (const auto& remap : _query_remaps) remap(ids);
+
+    size_t offset = 0;
+
+    ((access<Archetypes>().remap([&callable, ids, offset](const entity_type entity, const size_t index)
+       {
+         const entity_type id = ids[offset + index];
+
+         callable(entity, id);
+
+         return id;
+       }),
+       offset += access<Archetypes>().size()),
+      ...);
+
+    free(ids);
+  }
+
+  /**
+   * @brief Returns the amount of bytes allocated by the sparse_arrays of the registry.
+   * 
+   * @return size_t Amount of bytes allocated for indexing entities
+   */
+  size_t sparse_memory() { return _shared.memory() + (side_access<SideComponents>().sparse_memory() + ... + 0); }
+
+  /**
+   * @brief Returns the amount of bytes of the sparse_arrays that optimize would give back.
+   * 
+   * This is O(N) where N is the amount of entities.
+   * 
+   * @return size_t Amount of bytes wasted for indexing entities
+   */
+  size_t wasted_sparse_memory()
+  {
+    return _shared.wasted_memory(reach()) + (side_access<SideComponents>().wasted_sparse_memory() + ... + 0);
+  }
+
   /**
    * @brief Iterates over every entity that has the specified components and calls the given function.
    * 
@@ -187,6 +394,108 @@ public:
   template<typename... Components, typename Callable>
   void for_each(const Callable& callable) { view<Components...>().for_each(callable); }
 
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function with const references.
+   * 
+   * Same thing as creating a view with the components you need and calling read_each.
+   * 
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename... Components, typename Callable>
+  void read_each(const Callable& callable) { view<Components...>().read_each(callable); }
+
+  /**
+   * @brief Iterates over a list of entities that have the specified components and calls the given function.
+   * 
+   * Same thing as creating a view with the components you need and calling for_each with the entities.
+   * 
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param entities The entities to visit
+   * @param count Amount of entities
+   * @param callable The callable to invoke for every entity
+   */
+  template<typename... Components, typename Callable>
+  void for_each(const entity_type* entities, const size_t count, const Callable& callable)
+  {
+    view<Components...>().for_each(entities, count, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity of a group that has the specified components and calls the given function.
+   * 
+   * Same thing as creating a view with the components you need and calling for_each_group.
+   * 
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param group The group to iterate
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename... Components, typename Callable>
+  void for_each_group(const size_t group, const Callable& callable) { view<Components...>().for_each_group(group, callable); }
+
+  /**
+   * @brief Iterates over the entities of the blocks that changed since a version and calls the given function.
+   * 
+   * Same thing as creating a view with the components you need and calling for_each_changed_since.
+   * 
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param version The version to compare to, usually the version of the last run of the system
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename... Components, typename Callable>
+  void for_each_changed_since(const size_t version, const Callable& callable)
+  {
+    view<Components...>().for_each_changed_since(version, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity whose component is dirty and calls the given function.
+   * 
+   * Same thing as creating a view with the dirty component and the other components you need and calling
+   * for_each_dirty.
+   * 
+   * @tparam Component The dirty component, also the first component of the view
+   * @tparam Components The other components types to form the view for
+   * @tparam Callable The callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Component, typename... Components, typename Callable>
+  void for_each_dirty(const Callable& callable) { view<Component, Components...>().template for_each_dirty<Component>(callable); }
+
+  /**
+   * @brief Marks the component of an entity as dirty.
+   * 
+   * Does nothing if the archetype of the entity has no dirty bits for the component (see storage_traits).
+   * 
+   * @warning Attempting to mark an entity that doesn't contain the component results in undefined behaviour
+   * 
+   * @tparam Component The component to mark
+   * @param entity Entity to mark
+   */
+  template<typename Component>
+  void mark_dirty(const entity_type entity) { view<Component>().template mark_dirty<Component>(entity); }
+
+  /**
+   * @brief Clears the dirty bit of a component of every entity.
+   * 
+   * @tparam Component The component to clear
+   */
+  template<typename Component>
+  void clear_dirty() { view<Component>().template clear_dirty<Component>(); }
+
+  /**
+   * @brief Moves an entity to its group after its group component was modified.
+   * 
+   * Entities of archetypes that are not grouped are ignored.
+   * 
+   * @param entity The entity to regroup
+   */
+  void regroup(const entity_type entity) { view().regroup(entity); }
+
   /**
    * @brief Will change the archetype of an entity.
    * 
@@ -199,6 +508,39 @@ public:
   template<typename... Components>
   void swap_archetype(const entity_type entity) { view().template swap_archetype<Components...>(entity); }
 
+  /**
+   * @brief Adds a component to an entity, moving it to the archetype with the added component.
+   * 
+   * The destination archetype of every possible source archetype is resolved at compile time, so
+   * unlike swap_archetype, there is no need to know or spell out the entity's archetype. The only
+   * runtime cost is finding the storage of the entity, the row is then moved directly.
+   * 
+   * @warning Attempting to add a component to an entity whose archetype has no archetype with the added
+   * component results in undefined behaviour.
+   * 
+   * @tparam Component The component type to add
+   * @param entity The entity to add the component to
+   * @param component The value of the added component
+   */
+  template<typename Component>
+  void add(const entity_type entity, const Component& component) { view().add(entity, component); }
+
+  /**
+   * @brief Removes a component from an entity, moving it to the archetype without the removed component.
+   * 
+   * The destination archetype of every possible source archetype is resolved at compile time, so
+   * unlike swap_archetype, there is no need to know or spell out the entity's archetype. The only
+   * runtime cost is finding the storage of the entity, the row is then moved directly.
+   * 
+   * @warning Attempting to remove a component from an entity whose archetype has no archetype without the removed
+   * component results in undefined behaviour.
+   * 
+   * @tparam Component The component type to remove
+   * @param entity The entity to remove the component from
+   */
+  template<typename Component>
+  void remove(const entity_type entity) { view().template remove<Component>(entity); }
+
   /**
    * @brief Returns a reference of the stored component for the specified entity and component type.
    * 
@@ -218,6 +560,52 @@ public:
   template<typename Component>
   Component& unpack(const entity_type entity) { return view<Component>().template unpack<Component>(entity); }
 
+  /**
+   * @brief Returns a const reference of the stored component for the specified entity and component type.
+   * 
+   * Same as unpack, but the component is not marked as written (see storage_traits::version_block).
+   * 
+   * @tparam Component The component type to read
+   * @param entity Entity to read component for
+   * @return const Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  const Component& read(const entity_type entity) { return view<Component>().template read<Component>(entity); }
+
+  /**
+   * @brief Enables an entity so that it is iterated again.
+   * 
+   * Only entities of archetypes that are enableable (see storage_traits) can be enabled or disabled.
+   * 
+   * @warning Attempting to enable an entity whose archetype is not enableable results in undefined behaviour.
+   * 
+   * @param entity The entity to enable
+   */
+  void enable(const entity_type entity) { view().enable(entity); }
+
+  /**
+   * @brief Disables an entity so that it is skipped by iteration.
+   * 
+   * Disabling is much cheaper than destroying the entity or changing its archetype, the entity keeps its
+   * components and stays in its storage. Only entities of archetypes that are enableable (see storage_traits)
+   * can be enabled or disabled.
+   * 
+   * @warning Attempting to disable an entity whose archetype is not enableable results in undefined behaviour.
+   * 
+   * @param entity The entity to disable
+   */
+  void disable(const entity_type entity) { view().disable(entity); }
+
+  /**
+   * @brief Returns whether or not an entity is enabled.
+   * 
+   * Entities of archetypes that are not enableable are always enabled.
+   * 
+   * @param entity The entity to check
+   * @return true If the entity is enabled, false otherwise
+   */
+  bool enabled(const entity_type entity) { return view().enabled(entity); }
+
   /**
    * @brief Returns whether or not the entity has all the specified components.
    * 
@@ -237,6 +625,22 @@ public:
   template<typename... Components>
   bool has(const entity_type entity) { return view<Components...>().contains(entity); }
 
+  /**
+   * @brief Returns whether or not the entity exists in the registry.
+   * 
+   * With versioned entities this is a single comparison, destroyed entities are never valid even after their
+   * index was recycled. Without versions this is the same as has, and a recycled entity is valid again.
+   * 
+   * @param entity The entity to check for
+   * @return true If the entity exists, false otherwise
+   */
+  bool valid(const entity_type entity)
+  {
+    if constexpr (manager_type::versioned) return _manager.valid(entity);
+    else
+      return has(entity);
+  }
+
   /**
    * @brief Returns the amount of entities contained by this registry who have the specified components if any.
    * 
@@ -286,6 +690,30 @@ public:
    */
   size_t storages() const { return _shared.shared(); }
 
+  /**
+   * @brief Returns the current version, that components written now are stamped with.
+   * 
+   * @return size_t The current version
+   */
+  size_t version() const { return _version; }
+
+  /**
+   * @brief Starts a new version.
+   * 
+   * Usually called before running every system. The system remembers the returned version and passes it to
+   * for_each_changed_since on its next run, it then sees the changes of every other system but not its own.
+   * 
+   * @code{.cpp}
+   * const auto since = last_run;
+   * last_run = registry.tick();
+   * 
+   * registry.for_each_changed_since<Position, Transform>(since, [](auto entity, const auto& position, const auto& transform) {});
+   * @endcode
+   * 
+   * @return size_t The new version
+   */
+  size_t tick() { return ++_version; }
+
   /**
    * @brief Accesses the storage for the specified archetype.
    * 
@@ -300,52 +728,378 @@ public:
    * @return auto& The storage of the specified archetype
    */
   template<typename Archetype>
-  auto& access() { return std::get<storage<entity_type, Archetype>>(_pool); }
+  auto& access() { return std::get<storage<Entity, Archetype>>(_pool); }
 
-private:
   /**
-   * @brief Set the up shared sparse_set
+   * @brief Accesses the sparse set storage for the specified side component.
    * 
-   * Called during the construction of the registry.
+   * Getting the side component's storage is done at compile-time.
    * 
-   * @note This method uses recusion to iterate over all the archetypes in the registry.
+   * @warning You should not directly access the storage unless you
+   * know what your doing.
    * 
-   * @tparam I Archetype index used during recursion, always leave it at 0
+   * @tparam Component The side component to get the storage for
+   * @return auto& The storage of the specified side component
    */
-  template<size_t I = 0>
-  void setup_shared_memory()
+  template<typename Component>
+  auto& side_access() { return std::get<storage<Entity, archetype<Component>>>(_side_pool); }
+
+  /**
+   * @brief Adds a listener invoked after entities of observed archetypes obtain a component.
+   * 
+   * Invoked when entities are created and when they change to an archetype with the component from one
+   * without it. Only the archetypes that are observed are listened to (see storage_traits).
+   * 
+   * The listener is either invoked with every entity and its component, or once per operation with the span of
+   * entities (see observer_set). Bulk operations such as migrate or command_buffer::flush deliver a single span.
+   * 
+   * @warning Listeners must not create or destroy entities or change their archetype.
+   * 
+   * @tparam Component The component to listen to
+   * @tparam Listener Listener type
+   * @param listener The listener to add
+   */
+  template<typename Component, typename Listener>
+  void on_construct(const Listener& listener)
   {
-    using current = at_t<I, archetype_list_type>;
+    static_assert((observes<Archetypes, Component> || ...), "No observed archetype has the component, see storage_traits");
 
-    if constexpr (I < size_v<archetype_list_type>)
-    {
-      access<current>().share(&_shared);
-      setup_shared_memory<I + 1>();
-    }
+    ((observe<Archetypes, Component>([&listener](auto& observers)
+       { observers.template on_construct<Component>(listener); })),
+      ...);
   }
 
-private:
-  pool_type _pool;
-  shared_type _shared;
-  manager_type _manager;
-};
-
-template<typename Entity, typename... Archetypes>
-template<typename... Components>
-class registry<Entity, list<Archetypes...>>::basic_view
-{
-public:
-  using archetype_list_view_type = prune_for_t<archetype_list_type, Components...>;
-
-  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this view");
-
-public:
   /**
-   * @brief Construct a new basic view object
+   * @brief Adds a listener invoked before entities of observed archetypes lose a component.
    * 
-   * @param registry Registry to view
+   * Invoked when entities are destroyed and when they change from an archetype with the component to one
+   * without it. Same as on_construct otherwise.
+   * 
+   * @warning Listeners must not create or destroy entities or change their archetype.
+   * 
+   * @tparam Component The component to listen to
+   * @tparam Listener Listener type
+   * @param listener The listener to add
    */
-  explicit basic_view(registry_type* registry) : _registry { registry } {}
+  template<typename Component, typename Listener>
+  void on_destroy(const Listener& listener)
+  {
+    static_assert((observes<Archetypes, Component> || ...), "No observed archetype has the component, see storage_traits");
+
+    ((observe<Archetypes, Component>([&listener](auto& observers)
+       { observers.template on_destroy<Component>(listener); })),
+      ...);
+  }
+
+  /**
+   * @brief Adds a listener invoked after entities change archetype from or to an observed archetype.
+   * 
+   * The listener is either invoked with every entity, or once per operation with the span of entities.
+   * 
+   * @warning Listeners must not create or destroy entities or change their archetype.
+   * 
+   * @tparam Listener Listener type
+   * @param listener The listener to add
+   */
+  template<typename Listener>
+  void on_archetype_change(const Listener& listener)
+  {
+    static_assert((storage_traits<Archetypes>::observed || ...), "No archetype is observed, see storage_traits");
+
+    if constexpr (std::is_invocable_v<const Listener&, entity_type>) _changed.push_back(listener);
+    else
+      _changed_batch.push_back(listener);
+  }
+
+  /**
+   * @brief Registers a query whose matching entities are kept up to date as the registry changes.
+   * 
+   * The query holds the list of entities that have the components and satisfy the predicate. The list is built
+   * once, then maintained from the construction and destruction notifications (see on_construct), so every
+   * archetype with the components must be observed. Components written afterwards are only re-evaluated
+   * by cached_query::update, for the components with dirty bits (see storage_traits).
+   * 
+   * Iterating the query then costs about the amount of matching entities, not the size of the view.
+   * 
+   * @code{.cpp}
+   * auto& wounded = registry.cache<Health>([](auto entity, const Health& health) { return health.value < 10; });
+   * 
+   * wounded.for_each([](auto entity, Health& health) {});
+   * @endcode
+   * 
+   * @note The query lives as long as the registry, its matching entities follow compact_ids.
+   * 
+   * @tparam Components The components of the query
+   * @tparam Predicate Predicate type
+   * @param predicate Predicate invoked with the entity and const references to its components
+   * @return cached_query& The registered query
+   */
+  template<typename... Components, typename Predicate>
+  auto& cache(const Predicate& predicate)
+  {
+    auto query = std::make_shared<cached_query<registry_type, Components...>>(*this, predicate);
+
+    _queries.push_back(query);
+    _query_remaps.push_back([this, matches = query.get()](const entity_type* ids)
+      { matches->remap([this, ids](const entity_type entity) { return remapped(entity, ids); }); });
+
+    return *query;
+  }
+
+  /**
+   * @brief Returns the entity manager of the registry.
+   * 
+   * Used to configure the manager, for example to reserve ranges of entities.
+   * 
+   * @warning Generating or releasing entities directly does not create or destroy them in the registry.
+   * 
+   * @return manager_type& The entity manager
+   */
+  manager_type& manager() { return _manager; }
+
+private:
+  /**
+   * @brief Set the up shared sparse_set and the version of the storages
+   * 
+   * Called during the construction of the registry.
+   * 
+   * @note This method uses recusion to iterate over all the archetypes in the registry.
+   * 
+   * @tparam I Archetype index used during recursion, always leave it at 0
+   */
+  template<size_t I = 0>
+  void setup_shared_memory()
+  {
+    using current = at_t<I, archetype_list_type>;
+
+    if constexpr (I < size_v<archetype_list_type>)
+    {
+      access<current>().share(&_shared);
+      access<current>().track(&_version);
+      setup_shared_memory<I + 1>();
+    }
+  }
+
+  /**
+   * @brief Compacts a storage if it defers erases and its addresses are not stable.
+   * 
+   * @tparam Moving Whether or not storages with stable addresses are compacted too
+   * @tparam Storage Storage type
+   * @param storage Storage to compact
+   */
+  template<bool Moving = false, typename Storage>
+  static void compact_storage(Storage& storage)
+  {
+    if constexpr (Storage::deferred_erase && (Moving || !Storage::stable_addresses)) storage.compact();
+    else
+      (void)storage; // Suppress unused warning
+  }
+
+  /**
+   * @brief Whether or not an archetype is observed and has a component.
+   * 
+   * @tparam Archetype Archetype to check
+   * @tparam Component Component to check
+   */
+  template<typename Archetype, typename Component>
+  static constexpr bool observes = storage_traits<Archetype>::observed && contains_v<Component, Archetype>;
+
+  /**
+   * @brief Calls the function with the observer set of an archetype, if it is observed and has a component.
+   * 
+   * @tparam Archetype Archetype of the observer set
+   * @tparam Component Component that the archetype must have
+   * @tparam Function Function type
+   * @param function Function invoked with the observer set
+   */
+  template<typename Archetype, typename Component, typename Function>
+  void observe(const Function& function)
+  {
+    if constexpr (observes<Archetype, Component>) function(std::get<observer_set<Entity, Archetype>>(_observers));
+    else
+      (void)function; // Suppress unused warning
+  }
+
+  /**
+   * @brief Notifies the listeners that entities entered an archetype.
+   * 
+   * Does nothing if neither archetype is observed.
+   * 
+   * @tparam Target Archetype the entities entered
+   * @tparam Source Archetype the entities left, void if they were created
+   * @param entities Entities that entered the archetype
+   * @param count Amount of entities
+   */
+  template<typename Target, typename Source = void>
+  void notify_entered(const entity_type* entities, const size_t count)
+  {
+    using previous = std::conditional_t<std::is_void_v<Source>, list<>, Source>;
+
+    if (count == 0) return;
+
+    if constexpr (storage_traits<Target>::observed)
+      std::get<observer_set<Entity, Target>>(_observers).template entered<previous>(access<Target>(), entities, count);
+
+    if constexpr (!std::is_void_v<Source>)
+      if constexpr (storage_traits<Source>::observed || storage_traits<Target>::observed)
+      {
+        for (auto& listener : _changed)
+        {
+          for (size_t i = 0; i < count; i++) listener(entities[i]);
+        }
+
+        for (auto& listener : _changed_batch) listener(entities, count);
+      }
+
+    (void)entities; // Suppress unused warning
+    (void)count;
+  }
+
+  /**
+   * @brief Notifies the listeners that entities are about to leave an archetype.
+   * 
+   * Does nothing if the archetype is not observed.
+   * 
+   * @tparam Source Archetype the entities leave
+   * @tparam Target Archetype the entities will enter, void if they are destroyed
+   * @param entities Entities that leave the archetype
+   * @param count Amount of entities
+   */
+  template<typename Source, typename Target = void>
+  void notify_leaving(const entity_type* entities, const size_t count)
+  {
+    using next = std::conditional_t<std::is_void_v<Target>, list<>, Target>;
+
+    if (count == 0) return;
+
+    if constexpr (storage_traits<Source>::observed)
+      std::get<observer_set<Entity, Source>>(_observers).template leaving<next>(access<Source>(), entities, count);
+
+    (void)entities; // Suppress unused warning
+    (void)count;
+  }
+
+  /**
+   * @brief Notifies the listeners that every entity of an archetype is about to be destroyed.
+   * 
+   * Does nothing if the archetype is not observed.
+   * 
+   * @tparam Archetype Archetype to clear
+   */
+  template<typename Archetype>
+  void notify_cleared()
+  {
+    if constexpr (storage_traits<Archetype>::observed)
+    {
+      auto& storage = access<Archetype>();
+
+      // Every row is then alive, including the disabled ones
+      if constexpr (std::decay_t<decltype(storage)>::deferred_erase) storage.compact();
+
+      if (storage.empty()) return;
+
+      std::vector<entity_type> entities;
+      entities.reserve(storage.size());
+
+      for (auto it = storage.begin(); it != storage.end(); ++it) entities.push_back(*it);
+
+      notify_leaving<Archetype>(entities.data(), entities.size());
+    }
+  }
+
+  /**
+   * @brief Erases the entity from every side component storage that contains it.
+   * 
+   * Used internally when an entity is destroyed.
+   * 
+   * @param entity The entity to erase
+   */
+  void erase_side_components(const entity_type entity)
+  {
+    ((side_access<SideComponents>().contains(entity) ? side_access<SideComponents>().erase(entity) : void()), ...);
+
+    (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Returns the highest index of the entities plus one.
+   * 
+   * Side components are not checked since their entities also belong to an archetype.
+   * 
+   * @return size_t Highest entity index plus one, zero if there are no entities
+   */
+  size_t reach()
+  {
+    size_t result = 0;
+
+    ((result = std::max(result, access<Archetypes>().reach())), ...);
+
+    return result;
+  }
+
+  /**
+   * @brief Returns the identifier an entity is renumbered to by compact_ids.
+   * 
+   * New identifiers are given storage by storage in the order of the rows, so the new identifier is
+   * found from the index of the entity and the storage that contains it.
+   * 
+   * @note This method uses recusion to iterate over all the archetypes in the registry.
+   * 
+   * @tparam I Archetype index used during recursion, always leave it at 0
+   * @param entity The entity to renumber
+   * @param ids New identifiers in the order they are given
+   * @param offset Amount of entities in the storages before the current one
+   * @return entity_type The new identifier of the entity
+   */
+  template<size_t I = 0>
+  entity_type remapped(const entity_type entity, const entity_type* ids, const size_t offset = 0)
+  {
+    using current = at_t<I, archetype_list_type>;
+
+    if constexpr (I + 1 < size_v<archetype_list_type>)
+    {
+      if (!access<current>().contains(entity)) return remapped<I + 1>(entity, ids, offset + access<current>().size());
+    }
+
+    return ids[offset + _shared[entity]];
+  }
+
+private:
+  pool_type _pool;
+  side_pool_type _side_pool;
+  shared_type _shared;
+  manager_type _manager;
+
+  size_t _version;
+
+  observer_pool_type _observers;
+  std::vector<std::function<void(entity_type)>> _changed;
+  std::vector<std::function<void(const entity_type*, size_t)>> _changed_batch;
+
+  std::vector<std::shared_ptr<void>> _queries;
+  std::vector<std::function<void(const entity_type*)>> _query_remaps;
+};
+
+template<typename Entity, typename... Archetypes, typename... SideComponents, typename Manager>
+template<typename... Components>
+class registry<Entity, list<Archetypes...>, list<SideComponents...>, Manager>::basic_view
+{
+public:
+  using side_component_list_view_type = intersection_t<list<Components...>, side_component_list_type>;
+  using archetype_component_list_view_type = difference_t<list<Components...>, side_component_list_type>;
+  using archetype_list_view_type = prune_for_list_t<archetype_list_type, archetype_component_list_view_type>;
+  using enableable_archetype_list_view_type = filter_t<is_enableable, archetype_list_view_type>;
+  using grouped_archetype_list_view_type = filter_t<is_grouped, archetype_list_view_type>;
+
+  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this view");
+
+public:
+  /**
+   * @brief Construct a new basic view object
+   * 
+   * @param registry Registry to view
+   */
+  explicit basic_view(registry_type* registry) : _registry { registry } {}
 
   /**
    * @brief Will change the archetype of an entity.
@@ -372,52 +1126,438 @@ public:
 
     r_apply<0>(entity, [this](auto& s, const entity_type e)
       {
+        using source = typename std::decay_t<decltype(s)>::archetype_type;
+
+        _registry->template notify_leaving<source, new_archetype>(&e, 1);
+
         std::tuple<SwapComponents...> temp;
         ((try_transfer<SwapComponents>(e, s, temp)), ...);
 
         s.erase(e);
 
-        _registry->template access<new_archetype>()
-          .insert(e, std::move(std::get<SwapComponents>(temp))...);
-      });
+        _registry->template access<new_archetype>()
+          .insert(e, std::move(std::get<SwapComponents>(temp))...);
+
+        _registry->template notify_entered<new_archetype, source>(&e, 1);
+      });
+  }
+
+  /**
+   * @brief Adds a component to an entity, moving it to the archetype with the added component.
+   * 
+   * Only the archetypes of the view that have a destination archetype with the added component
+   * are searched. The destination of each one of them is resolved at compile time.
+   * 
+   * Side components are simply inserted in their storage, the entity does not change archetype.
+   * 
+   * @warning Attempting to add a component to an entity that is not in one of these archetypes
+   * results in undefined behaviour.
+   * 
+   * @tparam Component The component type to add
+   * @param entity The entity to add the component to
+   * @param component The value of the added component
+   */
+  template<typename Component>
+  void add(const entity_type entity, const Component& component)
+  {
+    if constexpr (contains_v<Component, side_component_list_type>)
+    {
+      _registry->template side_access<Component>().insert(entity, component);
+    }
+    else
+    {
+      using sources = typename prune_for_add<Component, archetype_list_type, archetype_list_view_type>::type;
+
+      static_assert(size_v<sources> > 0,
+        "There is no archetype in the view that can have the component added");
+
+      r_apply<0, sources>(entity, [this, &component](auto& s, const entity_type e)
+        {
+          using source = typename std::decay_t<decltype(s)>::archetype_type;
+          using target = find_same_t<archetype_list_type, push_back_t<Component, source>>;
+
+          s.transfer(e, _registry->template access<target>(), component);
+
+          _registry->template notify_entered<target, source>(&e, 1);
+        });
+    }
+  }
+
+  /**
+   * @brief Removes a component from an entity, moving it to the archetype without the removed component.
+   * 
+   * Only the archetypes of the view that have a destination archetype without the removed component
+   * are searched. The destination of each one of them is resolved at compile time.
+   * 
+   * Side components are simply erased from their storage, the entity does not change archetype.
+   * 
+   * @warning Attempting to remove a component from an entity that is not in one of these archetypes
+   * results in undefined behaviour.
+   * 
+   * @tparam Component The component type to remove
+   * @param entity The entity to remove the component from
+   */
+  template<typename Component>
+  void remove(const entity_type entity)
+  {
+    if constexpr (contains_v<Component, side_component_list_type>)
+    {
+      _registry->template side_access<Component>().erase(entity);
+    }
+    else
+    {
+      using sources = typename prune_for_remove<Component, archetype_list_type, archetype_list_view_type>::type;
+
+      static_assert(size_v<sources> > 0,
+        "There is no archetype in the view that can have the component removed");
+
+      r_apply<0, sources>(entity, [this](auto& s, const entity_type e)
+        {
+          using source = typename std::decay_t<decltype(s)>::archetype_type;
+          using target = find_same_t<archetype_list_type, remove_t<Component, source>>;
+
+          _registry->template notify_leaving<source, target>(&e, 1);
+
+          s.transfer(e, _registry->template access<target>());
+
+          _registry->template notify_entered<target, source>(&e, 1);
+        });
+    }
+  }
+
+  /**
+   * @brief Moves every entity in the view that satisfies the predicate to another archetype.
+   * 
+   * This is the bulk version of swap_archetype. Every storage in the view is partitioned in a single pass so
+   * that the entities to migrate are at the back, the common components are then appended to the destination
+   * storage with one copy per component and the source storage is shrunk. Components that only the destination
+   * archetype has are initialized with the included components or value-initialized.
+   * 
+   * The predicate has the same arguments as the for_each callable and returns whether or not to migrate
+   * the entity. Entities that already are in the destination archetype are not tested.
+   * 
+   * @tparam TargetComponents The components of the archetype to migrate to
+   * @tparam Predicate Predicate type
+   * @tparam IncludedComponents Types of components to initialize with (optional)
+   * @param predicate The predicate to invoke for every entity
+   * @param components Components to initialize the migrated entities with
+   * @return size_t The amount of entities migrated
+   */
+  template<typename... TargetComponents, typename Predicate, typename... IncludedComponents>
+  size_t migrate_if(const Predicate& predicate, const IncludedComponents&... components)
+  {
+    using target = find_for_t<archetype_list_type, TargetComponents...>;
+
+    static_assert(size_v<target> == sizeof...(TargetComponents) && contains_same_v<archetype_list_type, target>,
+      "The archetype to migrate to does not exist.");
+    static_assert(contains_all_v<target, IncludedComponents...>,
+      "One or more included components do not belong to the archetype to migrate to");
+
+    return r_migrate_if<0, target>(predicate, components...);
+  }
+
+  /**
+   * @brief Moves the specified entities to another archetype.
+   * 
+   * This is the bulk version of swap_archetype. For every storage in the view, the entities
+   * to migrate are swapped to the back, the common components are then appended to the destination
+   * storage with one copy per component and the source storage is shrunk. Components that only the destination
+   * archetype has are initialized with the included components or value-initialized.
+   * 
+   * Entities that are not in the view or that already are in the destination archetype are ignored.
+   * 
+   * @warning Undefined behaviour if an entity is specified more than once.
+   * 
+   * @tparam TargetComponents The components of the archetype to migrate to
+   * @tparam IncludedComponents Types of components to initialize with (optional)
+   * @param entities Entities to migrate
+   * @param count Amount of entities to migrate
+   * @param components Components to initialize the migrated entities with
+   */
+  template<typename... TargetComponents, typename... IncludedComponents>
+  void migrate(const entity_type* entities, const size_t count, const IncludedComponents&... components)
+  {
+    using target = find_for_t<archetype_list_type, TargetComponents...>;
+
+    static_assert(size_v<target> == sizeof...(TargetComponents) && contains_same_v<archetype_list_type, target>,
+      "The archetype to migrate to does not exist.");
+    static_assert(contains_all_v<target, IncludedComponents...>,
+      "One or more included components do not belong to the archetype to migrate to");
+
+    if (count == 0) return;
+
+    entity_type* buffer = static_cast<entity_type*>(std::malloc(count * sizeof(entity_type)));
+
+    r_migrate<0, target>(entities, count, buffer, components...);
+
+    std::free(buffer);
+  }
+
+  /**
+   * @brief Sorts the entities of an archetype so that they are iterated in increasing order of a key.
+   * 
+   * The key function has the same arguments as the for_each callable and is invoked once per entity. The order
+   * is computed once (with a radix sort for integral keys), then every component array of the archetype is
+   * permuted in place (see storage::sort_by). Entities with the same key keep their order.
+   * 
+   * @tparam ArchetypeComponents The components of the archetype to sort
+   * @tparam Key Key function type
+   * @param key The key function to invoke for every entity
+   */
+  template<typename... ArchetypeComponents, typename Key>
+  void sort(const Key& key)
+  {
+    using target = find_for_t<archetype_list_view_type, ArchetypeComponents...>;
+
+    static_assert(size_v<target> == sizeof...(ArchetypeComponents) && contains_same_v<archetype_list_view_type, target>,
+      "The archetype to sort is not in the view.");
+    static_assert(empty_v<side_component_list_view_type>, "Views with side components cannot sort");
+
+    _registry->template access<target>().sort_by([&key](auto it)
+      { return key(*it, it.template unpack<Components>()...); });
+  }
+
+  /**
+   * @brief Erases an entity from the correct storage in the view.
+   * 
+   * Used internally by the registry to destroy entities. 
+   * 
+   * Unsafe and cannot be used externally because this method removes an entity without
+   * releasing the entity back into the entity_manager.
+   * 
+   * @warning Attempting to erase an entity that doesn't exist in the view results
+   * in undefined behaviour
+   * 
+   * @param entity The entity to erase
+   */
+  void destroy(const entity_type entity)
+  {
+    r_apply<0>(entity, [this](auto& s, const entity_type e)
+      {
+        _registry->template notify_leaving<typename std::decay_t<decltype(s)>::archetype_type>(&e, 1);
+
+        s.erase(e);
+      });
+
+    _registry->erase_side_components(entity);
+    _registry->_manager.release(entity);
+  }
+
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * 
+   * There is not much of a cost outside of the unpacking cost for iterating over multiple components. 
+   * Actually, specifing more components may even lead to better results in some cases. Go crazy...
+   * 
+   * The provided function must contain every component in the view as an argument.
+   * 
+   * @tparam Callable Callable type
+   * @param Callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each(const Callable& callable)
+  {
+    if constexpr (!empty_v<side_component_list_view_type> && sizeof...(Components) == size_v<side_component_list_view_type>)
+    {
+      // Only side components, its faster to iterate one of the side component storages directly
+      auto& storage = _registry->template side_access<at_t<0, side_component_list_view_type>>();
+
+      for (auto it = storage.begin(); it != storage.end(); ++it)
+      {
+        const entity_type entity = *it;
+
+        if (side_contains(entity, side_component_list_view_type {}))
+          callable(entity, _registry->template side_access<Components>().template unpack<Components>(entity)...);
+      }
+    }
+    else
+      r_for_each<0, Callable>(callable);
+  }
+
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function with const references.
+   * 
+   * Same as for_each, but the components are passed as const references, so they are not marked as written
+   * (see storage_traits::version_block). Systems that only read their components should iterate this way,
+   * otherwise every block looks changed to for_each_changed_since.
+   * 
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void read_each(const Callable& callable)
+  {
+    if constexpr (!empty_v<side_component_list_view_type> && sizeof...(Components) == size_v<side_component_list_view_type>)
+    {
+      auto& storage = _registry->template side_access<at_t<0, side_component_list_view_type>>();
+
+      for (auto it = storage.begin(); it != storage.end(); ++it)
+      {
+        const entity_type entity = *it;
+
+        if (side_contains(entity, side_component_list_view_type {}))
+          callable(entity, std::as_const(_registry->template side_access<Components>()).template unpack<Components>(entity)...);
+      }
+    }
+    else
+      r_read_each<0>(callable);
+  }
+
+  /**
+   * @brief Iterates over a list of entities and calls the given function.
+   * 
+   * Looking entities up one by one would stall on a cache miss for the sparse_array entry, then for the row
+   * of every entity. Instead, the lookups are pipelined: the sparse_array entry of an entity is prefetched
+   * a few entities ahead, then its row in every storage of the view, so both are loaded once the entity is
+   * reached. The cost then tracks the amount of entities rather than the size of the view.
+   * 
+   * Disabled entities are skipped, like for_each.
+   * 
+   * @warning Attempting to visit an entity that is not in the view results in undefined behaviour.
+   * 
+   * @tparam Callable Callable type
+   * @param entities The entities to visit
+   * @param count Amount of entities
+   * @param callable The callable to invoke for every entity
+   */
+  template<typename Callable>
+  void for_each(const entity_type* entities, const size_t count, const Callable& callable)
+  {
+    static_assert(empty_v<side_component_list_view_type>, "Views with side components cannot look up entities in batches");
+
+    // Entities ahead of the current one, enough to cover a cache miss per stage
+    constexpr size_t distance = 8;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (i + 2 * distance < count) _registry->_shared.prefetch(entities[i + 2 * distance]);
+      if (i + distance < count) r_prefetch<0>(entities[i + distance]);
+
+      r_apply<0>(entities[i], [&callable](auto& s, const entity_type e)
+        {
+          if (!s.enabled(e)) return;
+
+          // The callable may write any component of the view
+          s.mark_written(archetype_component_list_view_type {}, e);
+
+          auto it = s.find(e);
+
+          callable(e, it.template unpack<Components>()...);
+        });
+    }
+  }
+
+  /**
+   * @brief Iterates over every entity of a group that has the specified components and calls the given function.
+   * 
+   * Only the grouped archetypes of the view are iterated (see storage_traits), and only the rows
+   * of the group are visited in each of them. There are no checks on the group of the entities.
+   * 
+   * @tparam Callable Callable type
+   * @param group The group to iterate
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each_group(const size_t group, const Callable& callable)
+  {
+    static_assert(size_v<grouped_archetype_list_view_type> > 0, "There are no grouped archetypes in this view");
+
+    r_for_each_group<0>(group, callable);
+  }
+
+  /**
+   * @brief Iterates over the entities of the blocks that changed since a version and calls the given function.
+   * 
+   * Only the blocks of rows where one of the view components was written after the version are visited (see
+   * storage_traits::version_block), whole unchanged blocks are skipped. Archetypes without change versions are
+   * always visited. The components are passed as const references, so this does not mark them as written.
+   * 
+   * @tparam Callable Callable type
+   * @param version The version to compare to, usually the version of the last run of the system (see registry::tick)
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each_changed_since(const size_t version, const Callable& callable)
+  {
+    static_assert(empty_v<side_component_list_view_type>, "Changes of side components are not tracked");
+
+    r_for_each_changed_since<0>(version, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity whose component is dirty and calls the given function.
+   * 
+   * Only the dirty entities of the archetypes with dirty bits for the component are visited (see storage_traits),
+   * the cost is then about the amount of dirty entities. Archetypes without dirty bits for the component are
+   * always visited entirely. Dirty bits are not cleared, see clear_dirty.
+   * 
+   * @tparam Component The dirty component, must be in the view
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Component, typename Callable>
+  void for_each_dirty(const Callable& callable)
+  {
+    static_assert(contains_v<Component, archetype_component_list_view_type>, "The dirty component must be an archetype component of the view");
+    static_assert(empty_v<side_component_list_view_type>, "Side components do not have dirty bits");
+
+    r_for_each_dirty<0, Component>(callable);
   }
 
   /**
-   * @brief Erases an entity from the correct storage in the view.
+   * @brief Marks the component of an entity as dirty.
    * 
-   * Used internally by the registry to destroy entities. 
-   * 
-   * Unsafe and cannot be used externally because this method removes an entity without
-   * releasing the entity back into the entity_manager.
+   * Does nothing if the archetype of the entity has no dirty bits for the component.
    * 
-   * @warning Attempting to erase an entity that doesn't exist in the view results
-   * in undefined behaviour
+   * @warning Attempting to mark an entity that is not in the view results in undefined behaviour.
    * 
-   * @param entity The entity to erase
+   * @tparam Component The component to mark
+   * @param entity The entity to mark
    */
-  void destroy(const entity_type entity)
+  template<typename Component>
+  void mark_dirty(const entity_type entity)
   {
     r_apply<0>(entity, [](auto& s, const entity_type e)
-      { s.erase(e); });
+      {
+        if constexpr (std::decay_t<decltype(s)>::template tracks_dirty<Component>) s.template mark_dirty<Component>(e);
+        else
+          (void)e; // Suppress unused warning
+      });
+  }
 
-    _registry->_manager.release(entity);
+  /**
+   * @brief Clears the dirty bit of a component of every entity in the view.
+   * 
+   * @tparam Component The component to clear
+   */
+  template<typename Component>
+  void clear_dirty()
+  {
+    r_clear_dirty<0, Component>();
   }
 
   /**
-   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * @brief Moves an entity to its group after its group component was modified.
    * 
-   * There is not much of a cost outside of the unpacking cost for iterating over multiple components. 
-   * Actually, specifing more components may even lead to better results in some cases. Go crazy...
+   * Entities of archetypes that are not grouped are ignored.
    * 
-   * The provided function must contain every component in the view as an argument.
+   * @warning Attempting to regroup an entity that is not in the view results in undefined behaviour.
    * 
-   * @tparam Callable Callable type
-   * @param Callable The callable to invoke on every iteration
+   * @param entity The entity to regroup
    */
-  template<typename Callable>
-  void for_each(const Callable& callable)
+  void regroup(const entity_type entity)
   {
-    r_for_each<0, Callable>(callable);
+    if constexpr (size_v<grouped_archetype_list_view_type> > 0)
+    {
+      r_apply<0>(entity, [](auto& s, const entity_type e)
+        {
+          if constexpr (std::remove_reference_t<decltype(s)>::grouped) s.regroup(e);
+          else
+            (void)e; // Suppress unused warning
+        });
+    }
+    else
+      (void)entity; // Suppress unused warning
   }
 
   /**
@@ -435,10 +1575,95 @@ public:
   template<typename Component>
   Component& unpack(const entity_type entity)
   {
-    static_assert(size_v<prune_for_t<archetype_list_view_type, Component>> > 0,
+    static_assert(contains_v<Component, list<Components...>> || size_v<prune_for_t<archetype_list_view_type, Component>> > 0,
       "You cannot unpack a component type that is not included in the view");
 
-    return r_unpack<Component, 0>(entity);
+    if constexpr (contains_v<Component, side_component_list_type>)
+      return _registry->template side_access<Component>().template unpack<Component>(entity);
+    else
+      return r_unpack<Component, 0>(entity);
+  }
+
+  /**
+   * @brief Returns a const reference of the stored component for the specified entity and component type.
+   * 
+   * Same as unpack, but the component is not marked as written (see storage_traits::version_block).
+   * 
+   * @warning Attempting to read an entity that is not in the view results in undefined behaviour
+   * 
+   * @tparam Component The component type to read
+   * @param entity Entity to read component for
+   * @return const Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  const Component& read(const entity_type entity)
+  {
+    static_assert(contains_v<Component, list<Components...>> || size_v<prune_for_t<archetype_list_view_type, Component>> > 0,
+      "You cannot read a component type that is not included in the view");
+
+    if constexpr (contains_v<Component, side_component_list_type>)
+      return std::as_const(_registry->template side_access<Component>()).template unpack<Component>(entity);
+    else
+      return r_unpack<Component, 0, false>(entity);
+  }
+
+  /**
+   * @brief Enables an entity so that it is iterated again.
+   * 
+   * Only the enableable archetypes of the view are searched.
+   * 
+   * @warning Attempting to enable an entity that is not in an enableable archetype of the view results in
+   * undefined behaviour.
+   * 
+   * @param entity The entity to enable
+   */
+  void enable(const entity_type entity)
+  {
+    static_assert(size_v<enableable_archetype_list_view_type> > 0, "There are no enableable archetypes in this view");
+
+    r_apply<0, enableable_archetype_list_view_type>(entity, [](auto& s, const entity_type e)
+      { s.enable(e); });
+  }
+
+  /**
+   * @brief Disables an entity so that it is skipped by iteration.
+   * 
+   * Only the enableable archetypes of the view are searched.
+   * 
+   * @warning Attempting to disable an entity that is not in an enableable archetype of the view results in
+   * undefined behaviour.
+   * 
+   * @param entity The entity to disable
+   */
+  void disable(const entity_type entity)
+  {
+    static_assert(size_v<enableable_archetype_list_view_type> > 0, "There are no enableable archetypes in this view");
+
+    r_apply<0, enableable_archetype_list_view_type>(entity, [](auto& s, const entity_type e)
+      { s.disable(e); });
+  }
+
+  /**
+   * @brief Returns whether or not an entity is enabled.
+   * 
+   * @warning Attempting to check an entity that is not in the view results in undefined behaviour.
+   * 
+   * @param entity The entity to check
+   * @return true If the entity is enabled, false otherwise
+   */
+  bool enabled(const entity_type entity)
+  {
+    bool result = true;
+
+    if constexpr (size_v<enableable_archetype_list_view_type> > 0)
+    {
+      r_apply<0>(entity, [&result](auto& s, const entity_type e)
+        { result = s.enabled(e); });
+    }
+    else
+      (void)entity; // Suppress unused warning
+
+    return result;
   }
 
   /**
@@ -449,19 +1674,29 @@ public:
    */
   bool contains(const entity_type entity)
   {
-    return r_contains<0>(entity);
+    return r_contains<0>(entity) && side_contains(entity, side_component_list_view_type {});
   }
 
   /**
    * @brief Returns the amount of entities in the view.
    * 
-   * Sum of size of storages of all archetypes in the view.
+   * Sum of size of storages of all archetypes in the view. If the view contains side components,
+   * the entities have to be counted.
    * 
    * @return size_t The amount of entities in the view
    */
   size_t size()
   {
-    return r_size<0>();
+    if constexpr (empty_v<side_component_list_view_type>) return r_size<0>();
+    else
+    {
+      size_t count = 0;
+
+      for_each([&count](auto&&...)
+        { ++count; });
+
+      return count;
+    }
   }
 
   /**
@@ -471,7 +1706,9 @@ public:
    */
   bool empty()
   {
-    return r_empty<0>();
+    if constexpr (empty_v<side_component_list_view_type>) return r_empty<0>();
+    else
+      return size() == 0;
   }
 
 private:
@@ -498,12 +1735,158 @@ private:
 
     auto& storage = _registry->template access<current>();
 
-    for (auto it = storage.begin(); it != storage.end(); ++it)
+    // The callable may write any component of the view
+    storage.mark_written(archetype_component_list_view_type {});
+
+    // Disabled entities are skipped by the storage
+    storage.each([&](auto& it)
+      {
+        if constexpr (empty_v<side_component_list_view_type>) callable(*it, it.template unpack<Components>()...);
+        else if (side_contains(*it, side_component_list_view_type {}))
+          callable(*it, unpack_at<Components>(it)...);
+      });
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
+  }
+
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function with const references.
+   * 
+   * Same as r_for_each, but nothing is marked as written.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_read_each(const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    storage.each([&](auto& it)
+      {
+        if constexpr (empty_v<side_component_list_view_type>) callable(*it, std::as_const(it).template unpack<Components>()...);
+        else if (side_contains(*it, side_component_list_view_type {}))
+          callable(*it, std::as_const(unpack_at<Components>(it))...);
+      });
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_read_each<I + 1>(callable);
+  }
+
+  /**
+   * @brief Iterates over every entity of a group that has the specified components and calls the given function.
+   * 
+   * Same as r_for_each, but only for the grouped archetypes of the view and the rows of the group.
+   * 
+   * @tparam I Grouped archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param group The group to iterate
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_for_each_group(const size_t group, const Callable& callable)
+  {
+    using current = at_t<I, grouped_archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    storage.mark_written(archetype_component_list_view_type {});
+
+    storage.each_group(group, [&](auto& it)
+      {
+        if constexpr (empty_v<side_component_list_view_type>) callable(*it, it.template unpack<Components>()...);
+        else if (side_contains(*it, side_component_list_view_type {}))
+          callable(*it, unpack_at<Components>(it)...);
+      });
+
+    if constexpr (I + 1 < size_v<grouped_archetype_list_view_type>) r_for_each_group<I + 1>(group, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity whose component is dirty and calls the given function.
+   * 
+   * Same as r_for_each, but storages with dirty bits for the component only visit the dirty entities.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Component The dirty component
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Component, typename Callable>
+  void r_for_each_dirty(const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    if constexpr (std::decay_t<decltype(storage)>::template tracks_dirty<Component>)
+    {
+      // Only the blocks of the visited rows may be written
+      storage.template each_dirty<Component>([&storage, &callable](auto& it)
+        {
+          storage.mark_written(archetype_component_list_view_type {}, *it);
+
+          callable(*it, it.template unpack<Components>()...);
+        });
+    }
+    else
     {
-      callable(*it, it.template unpack<Components>()...);
+      storage.mark_written(archetype_component_list_view_type {});
+
+      storage.each([&callable](auto& it)
+        { callable(*it, it.template unpack<Components>()...); });
     }
 
-    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each_dirty<I + 1, Component>(callable);
+  }
+
+  /**
+   * @brief Clears the dirty bit of a component in every storage of the view that has dirty bits for it.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Component The component to clear
+   */
+  template<size_t I, typename Component>
+  void r_clear_dirty()
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    if constexpr (std::decay_t<decltype(storage)>::template tracks_dirty<Component>) storage.template clear_dirty<Component>();
+    else
+      (void)storage; // Suppress unused warning
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_clear_dirty<I + 1, Component>();
+  }
+
+  /**
+   * @brief Iterates over the entities of the blocks that changed since a version and calls the given function.
+   * 
+   * Same as r_for_each, but storages with change versions only visit the changed blocks.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param version The version to compare to
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_for_each_changed_since(const size_t version, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    const auto function = [&callable](auto& it)
+    { callable(*it, std::as_const(it).template unpack<Components>()...); };
+
+    if constexpr (std::decay_t<decltype(storage)>::change_versions) storage.template each_changed<Components...>(version, function);
+    else
+      storage.each(function);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each_changed_since<I + 1>(version, callable);
   }
 
   /**
@@ -517,24 +1900,39 @@ private:
    * in the view. If this is not the case, the behaviour of this method in undefined.
    * 
    * @tparam I Archetype index used during recursion
+   * @tparam ArchetypeList Archetypes to search (defaults to the archetypes in the view)
    * @tparam Invocable Invocable type (lambda)
    * @param entity Entity to search and apply action for
    * @param callable The callable to apply to storage and entity
    */
-  template<size_t I, typename Callable>
+  template<size_t I, typename ArchetypeList = archetype_list_view_type, typename Callable>
   void r_apply(const entity_type entity, const Callable& callable)
   {
-    using current = at_t<I, archetype_list_view_type>;
+    using current = at_t<I, ArchetypeList>;
 
     auto& storage = _registry->template access<current>();
 
     // If we assume that the entity is in atleast one of the storages in the view,
     // we can skip the verification for the last possible storage.
-    if constexpr (I == size_v<archetype_list_view_type> - 1) callable(storage, entity);
+    if constexpr (I == size_v<ArchetypeList> - 1) callable(storage, entity);
     else if (storage.contains(entity))
       callable(storage, entity);
     else
-      r_apply<I + 1, Callable>(entity, callable);
+      r_apply<I + 1, ArchetypeList>(entity, callable);
+  }
+
+  /**
+   * @brief Prefetches the row of an entity in every storage of the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @param entity Entity to prefetch
+   */
+  template<size_t I>
+  void r_prefetch(const entity_type entity)
+  {
+    _registry->template access<at_t<I, archetype_list_view_type>>().prefetch(entity);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_prefetch<I + 1>(entity);
   }
 
   /**
@@ -549,11 +1947,12 @@ private:
    * 
    * @tparam Component The component type to unpack
    * @tparam I Archetype index used during recursion
+   * @tparam Write Whether or not the component is marked as written, it is returned as const otherwise
    * @param entity Entity to unpack component for
    * @return Component& Reference to component belonging to the entity
    */
-  template<typename Component, size_t I>
-  Component& r_unpack(const entity_type entity)
+  template<typename Component, size_t I, bool Write = true>
+  std::conditional_t<Write, Component&, const Component&> r_unpack(const entity_type entity)
   {
     using current = at_t<I, archetype_list_view_type>;
 
@@ -562,11 +1961,29 @@ private:
     // If we assume that the entity is in atleast one of the storages in the view,
     // we can skip the verification for the last possible storage.
     if constexpr (I == size_v<archetype_list_view_type> - 1)
-      return storage.template unpack<Component>(entity);
+      return unpack_from<Component, Write>(storage, entity);
     else if (storage.contains(entity))
-      return storage.template unpack<Component>(entity);
+      return unpack_from<Component, Write>(storage, entity);
+    else
+      return r_unpack<Component, I + 1, Write>(entity);
+  }
+
+  /**
+   * @brief Unpacks a component from a storage, as const if it is not written.
+   * 
+   * @tparam Component The component type to unpack
+   * @tparam Write Whether or not the component is marked as written
+   * @tparam Storage Storage type
+   * @param storage Storage of the entity
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component, bool Write, typename Storage>
+  static std::conditional_t<Write, Component&, const Component&> unpack_from(Storage& storage, const entity_type entity)
+  {
+    if constexpr (Write) return storage.template unpack<Component>(entity);
     else
-      return r_unpack<Component, I + 1>(entity);
+      return std::as_const(storage).template unpack<Component>(entity);
   }
 
   /**
@@ -631,6 +2048,137 @@ private:
       return r_empty<I + 1>();
   }
 
+  /**
+   * @brief Moves every entity in the view that satisfies the predicate to another archetype.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and migrates the
+   * entities of each storage in bulk.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Target Archetype to migrate to
+   * @tparam Predicate Predicate type
+   * @tparam IncludedComponents Types of components to initialize with
+   * @param predicate The predicate to invoke for every entity
+   * @param components Components to initialize the migrated entities with
+   * @return size_t The amount of entities migrated
+   */
+  template<size_t I, typename Target, typename Predicate, typename... IncludedComponents>
+  size_t r_migrate_if(const Predicate& predicate, const IncludedComponents&... components)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    size_t migrated = 0;
+
+    if constexpr (!std::is_same_v<current, Target>)
+    {
+      auto& storage = _registry->template access<current>();
+
+      migrated = storage.partition([this, &predicate](auto it)
+        { return side_contains(*it, side_component_list_view_type {}) && predicate(*it, unpack_at<Components>(it)...); });
+
+      if constexpr (storage_traits<current>::observed || storage_traits<Target>::observed)
+      {
+        // The migrated entities are at the back
+        std::vector<entity_type> entities;
+        entities.reserve(migrated);
+
+        for (auto it = storage.begin(); entities.size() < migrated; ++it) entities.push_back(*it);
+
+        _registry->template notify_leaving<current, Target>(entities.data(), migrated);
+
+        storage.transfer_back(migrated, _registry->template access<Target>(), components...);
+
+        _registry->template notify_entered<Target, current>(entities.data(), migrated);
+      }
+      else
+        storage.transfer_back(migrated, _registry->template access<Target>(), components...);
+    }
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>)
+      return migrated + r_migrate_if<I + 1, Target>(predicate, components...);
+    else
+      return migrated;
+  }
+
+  /**
+   * @brief Moves the specified entities to another archetype.
+   * 
+   * This method uses recursion to iterate over every archetype in the view, gathers the
+   * entities contained by each storage and migrates them in bulk.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Target Archetype to migrate to
+   * @tparam IncludedComponents Types of components to initialize with
+   * @param entities Entities to migrate
+   * @param count Amount of entities to migrate
+   * @param buffer Temporary buffer that can hold count entities
+   * @param components Components to initialize the migrated entities with
+   */
+  template<size_t I, typename Target, typename... IncludedComponents>
+  void r_migrate(const entity_type* entities, const size_t count, entity_type* buffer, const IncludedComponents&... components)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    if constexpr (!std::is_same_v<current, Target>)
+    {
+      auto& storage = _registry->template access<current>();
+
+      size_t contained = 0;
+
+      for (size_t i = 0; i < count; i++)
+      {
+        if (storage.contains(entities[i]) && side_contains(entities[i], side_component_list_view_type {}))
+          buffer[contained++] = entities[i];
+      }
+
+      storage.partition(buffer, contained);
+
+      _registry->template notify_leaving<current, Target>(buffer, contained);
+
+      storage.transfer_back(contained, _registry->template access<Target>(), components...);
+
+      _registry->template notify_entered<Target, current>(buffer, contained);
+    }
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>)
+      r_migrate<I + 1, Target>(entities, count, buffer, components...);
+  }
+
+  /**
+   * @brief Returns whether or not all the specified side component storages contain the entity.
+   * 
+   * @tparam SideViewComponents Side components to check for
+   * @param entity The entity to check for
+   * @return true If all side component storages contain the entity, false otherwise
+   */
+  template<typename... SideViewComponents>
+  bool side_contains(const entity_type entity, list<SideViewComponents...>)
+  {
+    (void)entity; // Suppress unused warning
+
+    return (_registry->template side_access<SideViewComponents>().contains(entity) && ...);
+  }
+
+  /**
+   * @brief Returns a reference of the component for the entity at the iterator position.
+   * 
+   * Archetype components are unpacked from the iterator and side components are unpacked
+   * from their storage.
+   * 
+   * @tparam Component The component type to unpack
+   * @tparam Iterator The storage iterator type
+   * @param it Iterator of the entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component, typename Iterator>
+  Component& unpack_at(Iterator& it)
+  {
+    if constexpr (contains_v<Component, side_component_list_type>)
+      return _registry->template side_access<Component>().template unpack<Component>(*it);
+    else
+      return it.template unpack<Component>();
+  }
+
   /**
    * @brief Attempts to move component data into temp storage for transfer.
    * 
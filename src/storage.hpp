@@ -2,7 +2,12 @@
 #define XECS_STORAGE_HPP
 
 #include "archetype.hpp"
+#include "bitset.hpp"
+#include "entity.hpp"
+#include "memory.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
@@ -10,10 +15,53 @@
 #include <limits>
 #include <memory>
 #include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace xecs
 {
+/**
+ * @brief Default options of the sparse_array of an entity type.
+ * 
+ * Specializations of sparse_array_traits should inherit from this and only redefine the options they change.
+ */
+struct default_sparse_array_traits
+{
+  /**
+   * @brief Amount of entities per page, zero for a flat array.
+   * 
+   * A flat sparse_array is a single array as big as the highest entity ever inserted. A paged sparse_array
+   * only allocates the pages that contain entities and frees them when they are empty, this is recommended
+   * when entities are spread over a large range (for example reserved ranges). Must be a power of two.
+   */
+  static constexpr size_t page_size = 0;
+
+  /**
+   * @brief Whether or not a flat sparse_array is backed by huge pages once it is big enough (see huge_realloc).
+   */
+  static constexpr bool huge_pages = false;
+};
+
+/**
+ * @brief Compile-time options of the sparse_array of an entity type.
+ * 
+ * Specialize this for an entity type or entity descriptor to change how its entities are indexed:
+ * 
+ * @code{.cpp}
+ * template<>
+ * struct xecs::sparse_array_traits<uint32_t> : xecs::default_sparse_array_traits
+ * {
+ *   static constexpr size_t page_size = 4096;
+ * };
+ * @endcode
+ * 
+ * @tparam Entity Entity type or entity descriptor to configure
+ */
+template<typename Entity>
+struct sparse_array_traits : default_sparse_array_traits
+{};
+
 /**
  * @brief Array that sparsely stores indexes towards another array.
  * 
@@ -26,28 +74,66 @@ namespace xecs
  * multiple storages, making them more scalable and efficient. All storages that use entites generated
  * by the same entity manager can share the same sparse_array (one registry has one sparse_array).
  * 
- * Paging is not nessesary here because if implmented correctly there should only be one sparse_array
- * per entity_manager.
+ * By default the sparse_array is flat, which is the fastest when entities are densely packed. It can be paged
+ * (see sparse_array_traits): pages are allocated when an entity is first acquired and freed when no storage
+ * contains any entity of the page anymore. Pages that are not allocated all point to the same page of zeros,
+ * so accessing an entry is still two loads without any branch.
+ * 
+ * Only the index of the entities is used to access the sparse_array (see entity_traits).
  * 
- * @tparam Entity unsigned int entity identifier
+ * @tparam Entity unsigned int entity identifier or entity descriptor
  */
 template<typename Entity>
 class sparse_array final
 {
 public:
-  using entity_type = Entity;
+  using traits_type = entity_traits<Entity>;
+  using entity_type = typename traits_type::entity_type;
   using size_type = size_t;
   using array_type = entity_type*;
   using shared_count_type = uint16_t;
 
-  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
-    "Entity type must be an unsigned integer");
+  /**
+   * @brief Amount of entities per page, zero if the sparse_array is flat.
+   */
+  static constexpr size_type page_size = sparse_array_traits<Entity>::page_size;
+
+  /**
+   * @brief Whether or not the sparse_array is paged.
+   */
+  static constexpr bool paged = page_size != 0;
+
+  static_assert((page_size & (page_size - 1)) == 0, "Page size must be a power of two");
+
+private:
+  /**
+   * @brief Returns the base two logarithm of a power of two.
+   * 
+   * @param value Power of two
+   * @return size_type Logarithm of the value
+   */
+  static constexpr size_type log2(size_type value)
+  {
+    size_type result = 0;
+
+    while (value > 1)
+    {
+      value >>= 1;
+      ++result;
+    }
+
+    return result;
+  }
+
+  static constexpr size_type page_shift = log2(page_size);
+  static constexpr size_type page_mask = page_size - 1;
 
+public:
   /**
    * @brief Construct a new sparse array object
    */
   sparse_array()
-    : _array(NULL), _capacity(0), _shared(0)
+    : _array(NULL), _capacity(0), _shared(0), _pages(NULL), _counts(NULL)
   {}
 
   /**
@@ -55,7 +141,19 @@ public:
    */
   ~sparse_array()
   {
-    if (_array) free(_array);
+    if (_array) free_array();
+
+    if constexpr (paged)
+    {
+      for (size_type i = 0; i < pages(); i++)
+        if (_pages[i] != empty_page) free(_pages[i]);
+
+      if (_pages)
+      {
+        free(_pages);
+        free(_counts);
+      }
+    }
   }
 
   sparse_array(const sparse_array&) = delete;
@@ -67,33 +165,207 @@ public:
    * @brief Assures that the sparse array can contain the entity.
    * 
    * If the sparse_array cannot contain the entity, this will trigger
-   * a resize.
+   * a resize. In paged mode, the page of the entity is allocated if needed.
    * 
-   * @param page Page to assure
+   * @param entity Entity to assure
    */
   void assure(const entity_type entity)
   {
-    if (entity >= _capacity)
+    const auto index = traits_type::index(entity);
+
+    if constexpr (paged)
+    {
+      const size_type page = index >> page_shift;
+
+      if (index >= _capacity) grow_pages(page);
+
+      if (_pages[page] == empty_page)
+      {
+        _pages[page] = static_cast<array_type>(std::malloc(page_size * sizeof(entity_type)));
+      }
+    }
+    else if (index >= _capacity)
     {
-      const auto linear = entity + (1024 / sizeof(entity_type)); // 1kb
+      const auto linear = index + (1024 / sizeof(entity_type)); // 1kb
       const auto exponential = _capacity << 1; // Double capacity
 
-      _capacity = entity >= exponential ? linear : exponential;
+      const size_type previous = _capacity;
 
-      _array = static_cast<array_type>(std::realloc(_array, _capacity * sizeof(entity_type)));
+      _capacity = index >= exponential ? linear : exponential;
+
+      resize_array(previous);
+    }
+  }
+
+  /**
+   * @brief Assures that the sparse array can contain the entity, and signals that a storage contains it.
+   * 
+   * In paged mode, every page counts its entities so that it can be freed when it is empty.
+   * 
+   * @param entity Entity inserted in a storage
+   */
+  void acquire(const entity_type entity)
+  {
+    assure(entity);
+
+    if constexpr (paged) ++_counts[traits_type::index(entity) >> page_shift];
+  }
+
+  /**
+   * @brief Signals that a storage no longer contains the entity.
+   * 
+   * In paged mode, the page of the entity is freed when no storage contains any entity of the page.
+   * 
+   * @param entity Entity erased from a storage
+   */
+  void release(const entity_type entity)
+  {
+    if constexpr (paged)
+    {
+      const size_type page = traits_type::index(entity) >> page_shift;
+
+      if (--_counts[page] == 0)
+      {
+        free(_pages[page]);
+        _pages[page] = empty_page;
+      }
+    }
+    else
+      (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Reduces the capacity of the sparse_array to what is needed for the entities below the reach.
+   * 
+   * Usually called with the highest index of the entities that are stored plus one, for example after a spike
+   * of entities. The capacity never grows, and in paged mode only the page table shrinks since empty pages
+   * are already freed.
+   * 
+   * @warning Undefined behaviour if a storage contains an entity at or above the reach.
+   * 
+   * @param reach Amount of indexes that must stay reachable
+   */
+  void shrink_to_fit(const size_type reach)
+  {
+    if constexpr (paged)
+    {
+      const size_type size = (reach + page_mask) >> page_shift;
+
+      if (size >= pages()) return;
+
+      if (size == 0)
+      {
+        free(_pages);
+        free(_counts);
+
+        _pages = NULL;
+        _counts = NULL;
+      }
+      else
+      {
+        _pages = static_cast<array_type*>(std::realloc(_pages, size * sizeof(array_type)));
+        _counts = static_cast<size_type*>(std::realloc(_counts, size * sizeof(size_type)));
+      }
+
+      _capacity = size << page_shift;
+    }
+    else
+    {
+      if (reach >= _capacity) return;
+
+      const size_type previous = _capacity;
+
+      _capacity = reach;
+
+      if (_capacity == 0) free_array();
+      else
+        resize_array(previous);
+    }
+  }
+
+  /**
+   * @brief Returns the amount of bytes allocated by the sparse_array.
+   * 
+   * In paged mode this is O(N) where N is the amount of pages.
+   * 
+   * @return size_type Amount of bytes allocated
+   */
+  size_type memory() const
+  {
+    if constexpr (paged)
+      return pages() * (sizeof(array_type) + sizeof(size_type)) + allocated_pages() * page_size * sizeof(entity_type);
+    else
+      return _capacity * sizeof(entity_type);
+  }
+
+  /**
+   * @brief Returns the amount of bytes that shrinking to the reach would give back.
+   * 
+   * @param reach Amount of indexes that must stay reachable
+   * @return size_type Amount of bytes wasted
+   */
+  size_type wasted_memory(const size_type reach) const
+  {
+    if constexpr (paged)
+    {
+      const size_type size = (reach + page_mask) >> page_shift;
+
+      return size >= pages() ? 0 : (pages() - size) * (sizeof(array_type) + sizeof(size_type));
     }
+    else
+      return reach >= _capacity ? 0 : (_capacity - reach) * sizeof(entity_type);
   }
 
   /**
-   * @brief Returns the page for the page index.
+   * @brief Returns the index of the entity in the dense arrays.
    * 
-   * @param page Page index
-   * @return page_type Array of indexes
+   * @param entity Entity to access
+   * @return entity_type Index of the entity
    */
-  entity_type operator[](const entity_type entity) const { return _array[entity]; }
+  entity_type operator[](const entity_type entity) const
+  {
+    const auto index = traits_type::index(entity);
+
+    if constexpr (paged) return _pages[index >> page_shift][index & page_mask];
+    else
+      return _array[index];
+  }
 
   /*! @copydoc operator[] */
-  entity_type& operator[](const entity_type entity) { return _array[entity]; }
+  entity_type& operator[](const entity_type entity)
+  {
+    const auto index = traits_type::index(entity);
+
+    if constexpr (paged) return _pages[index >> page_shift][index & page_mask];
+    else
+      return _array[index];
+  }
+
+  /**
+   * @brief Hints the processor to load the entry of an entity, for a lookup a bit later.
+   * 
+   * Does nothing if the entity is not within the capacity.
+   * 
+   * @param entity Entity to prefetch
+   */
+  void prefetch(const entity_type entity) const
+  {
+    if (!reaches(entity)) return;
+
+    const auto index = traits_type::index(entity);
+
+    if constexpr (paged) xecs::prefetch(_pages[index >> page_shift] + (index & page_mask));
+    else
+      xecs::prefetch(_array + index);
+  }
+
+  /**
+   * @brief Returns whether or not the entity is within the capacity of the sparse_array.
+   * 
+   * @param entity Entity to check
+   * @return true If the entity can be accessed, false otherwise
+   */
+  bool reaches(const entity_type entity) const { return traits_type::index(entity) < _capacity; }
 
   /**
    * @brief Returns the capacity of the sparse_array.
@@ -105,6 +377,29 @@ public:
    */
   size_type capacity() const { return _capacity; }
 
+  /**
+   * @brief Returns the amount of entries of the page table, allocated or not.
+   * 
+   * @return size_type Amount of pages, always zero if the sparse_array is flat
+   */
+  size_type pages() const { return paged ? _capacity >> page_shift : 0; }
+
+  /**
+   * @brief Returns the amount of pages that are allocated.
+   * 
+   * This is O(N) where N is the amount of pages.
+   * 
+   * @return size_type Amount of allocated pages, always zero if the sparse_array is flat
+   */
+  size_type allocated_pages() const
+  {
+    size_type allocated = 0;
+
+    for (size_type i = 0; i < pages(); i++) allocated += _pages[i] != empty_page;
+
+    return allocated;
+  }
+
   /**
    * @brief Signals that a storage is sharing this sparse_array
    */
@@ -122,11 +417,205 @@ public:
   shared_count_type shared() const { return _shared; }
 
 private:
+  /**
+   * @brief Resizes the flat array from the previous capacity to the current capacity.
+   * 
+   * @param previous Previous capacity
+   */
+  void resize_array(const size_type previous)
+  {
+    if constexpr (sparse_array_traits<Entity>::huge_pages)
+    {
+      _array = static_cast<array_type>(huge_realloc(_array, previous * sizeof(entity_type), _capacity * sizeof(entity_type)));
+    }
+    else
+    {
+      (void)previous; // Suppress unused warning
+      _array = static_cast<array_type>(std::realloc(_array, _capacity * sizeof(entity_type)));
+    }
+  }
+
+  /**
+   * @brief Frees the flat array.
+   */
+  void free_array()
+  {
+    if constexpr (sparse_array_traits<Entity>::huge_pages) huge_free(_array);
+    else
+      free(_array);
+
+    _array = NULL;
+  }
+
+  /**
+   * @brief Grows the page table to contain the page.
+   * 
+   * @param page Page to contain
+   */
+  void grow_pages(const size_type page)
+  {
+    const size_type current = pages();
+    const size_type doubled = current << 1;
+    const size_type size = page >= doubled ? page + 1 : doubled;
+
+    _pages = static_cast<array_type*>(std::realloc(_pages, size * sizeof(array_type)));
+    _counts = static_cast<size_type*>(std::realloc(_counts, size * sizeof(size_type)));
+
+    for (size_type i = current; i < size; i++)
+    {
+      _pages[i] = empty_page;
+      _counts[i] = 0;
+    }
+
+    _capacity = size << page_shift;
+  }
+
+private:
+  /**
+   * @brief Shared by every page that is not allocated, it is never written to.
+   */
+  static inline entity_type empty_page[paged ? page_size : 1] = {};
+
   array_type _array;
   size_type _capacity;
   shared_count_type _shared;
+
+  array_type* _pages;
+  size_type* _counts;
+};
+
+/**
+ * @brief Default options of the storage of an archetype.
+ * 
+ * Specializations of storage_traits should inherit from this and only redefine the options they change.
+ */
+struct default_storage_traits
+{
+  /**
+   * @brief Whether or not entities of the archetype can be disabled.
+   * 
+   * Enableable storages maintain a bitmask of the enabled rows alongside the dense arrays. Disabled
+   * entities keep their components but are skipped during iteration, a whole word of rows at a time.
+   */
+  static constexpr bool enableable = false;
+
+  /**
+   * @brief Whether or not enabled entities are kept at the front of the storage.
+   * 
+   * Enabling or disabling an entity swaps its row across the boundary so that iteration never touches
+   * disabled rows. This is recommended when a high fraction of the entities are disabled. Implies enableable.
+   */
+  static constexpr bool compact_disabled = false;
+
+  /**
+   * @brief Amount of groups the entities are partitioned in, zero disables grouping.
+   * 
+   * Grouped storages keep the entities of every group contiguous, so a single group can be iterated
+   * without going through the rest of the storage. The group of an entity is a small integer key obtained
+   * with a static group function of the traits from the group component:
+   * 
+   * @code{.cpp}
+   * using group_component = Team;
+   * static size_t group(const Team& team) { return team.id; }
+   * @endcode
+   * 
+   * Rows are regrouped by swapping on insert and erase, this costs at most one swap per group.
+   */
+  static constexpr size_t groups = 0;
+
+  /**
+   * @brief Component that the group of an entity is obtained from.
+   */
+  using group_component = void;
+
+  /**
+   * @brief Whether or not erased entities are only marked dead until the storage is compacted.
+   * 
+   * Erasing then only destroys the components and sets a bit in a tombstone mask, no row is moved and the
+   * sparse_array is not written. Dead rows are skipped during iteration like disabled ones, so the iteration
+   * order stays stable and entities can be erased while iterating. Call compact (or registry::compact) at a
+   * chosen point to remove the dead rows in a single streaming pass. Implies enableable, cannot be grouped
+   * or compact disabled.
+   */
+  static constexpr bool deferred_erase = false;
+
+  /**
+   * @brief Whether or not the address of a component never changes while its entity stays in the storage.
+   * 
+   * The component arrays are split in pages of a fixed amount of rows that are never moved, growing only
+   * allocates new pages. Erases are deferred and dead rows are reused by the next inserts, so no other row is
+   * moved either. Pointers to components can then be kept across inserts and erases instead of unpacking every
+   * time. Rows are only moved by explicit calls that reorder the storage (compact, partition, remap) or when
+   * the entity changes archetype. Implies deferred erase, cannot use huge pages.
+   */
+  static constexpr bool stable_addresses = false;
+
+  /**
+   * @brief Whether or not the rows are kept in order of entity, so that the iteration order only depends on the entities.
+   * 
+   * Entities are iterated in decreasing order of their index whatever the order they were inserted and erased in,
+   * this is needed by deterministic simulations (lockstep, replays). Erases are deferred so they keep the order.
+   * Inserted entities are appended, and merged in order by the next iteration or compaction. Implies deferred
+   * erase, cannot be sorted or have stable addresses.
+   */
+  static constexpr bool ordered = false;
+
+  /**
+   * @brief Whether or not the registry notifies listeners of the entities entering and leaving the archetype.
+   * 
+   * Listeners are added with registry::on_construct, registry::on_destroy and registry::on_archetype_change.
+   * Archetypes that are not observed pay nothing, the notifications are removed at compile time.
+   */
+  static constexpr bool observed = false;
+
+  /**
+   * @brief Amount of rows that share a change version, zero disables change versions.
+   * 
+   * Every block of rows keeps, for every component, the version of the registry (see registry::tick) when it
+   * was last written. Mutable iteration and unpacking stamp the blocks they reach, and so do the inserts and
+   * the operations that move rows. Systems can then skip whole blocks that did not change since they last ran
+   * (see registry::for_each_changed_since).
+   */
+  static constexpr size_t version_block = 0;
+
+  /**
+   * @brief Components that keep a dirty bit for every entity.
+   * 
+   * The bit is set by mark_dirty, by mutable unpacking and when the component is constructed, and stays with the
+   * entity when rows are moved or when the entity changes archetype. Iterating the dirty entities scans the bits a
+   * word at a time and skips the words without any set bit, so it costs about the amount of dirty entities.
+   * Writes through iteration are not tracked, they must be marked explicitly.
+   */
+  using dirty_components = list<>;
+
+  /**
+   * @brief Whether or not the dense arrays are backed by huge pages once they are big enough.
+   * 
+   * Recommended for storages of millions of entities, iteration then needs far fewer TLB entries. Every
+   * dense array of at least 2 MiB is rounded up to a multiple of 2 MiB (see huge_realloc).
+   */
+  static constexpr bool huge_pages = false;
 };
 
+/**
+ * @brief Compile-time options of the storage of an archetype.
+ * 
+ * Specialize this for an archetype to change how it is stored:
+ * 
+ * @code{.cpp}
+ * template<>
+ * struct xecs::storage_traits<xecs::archetype<Position>> : xecs::default_storage_traits
+ * {
+ *   static constexpr bool enableable = true;
+ * };
+ * @endcode
+ * 
+ * @tparam Archetype Archetype to configure
+ */
+template<typename Archetype>
+struct storage_traits : default_storage_traits
+{};
+
 /**
  * @brief Collection of entites of an archetype and its components.
  * 
@@ -152,7 +641,7 @@ private:
  * 
  * @warning Order is never guaranted.
  * 
- * @tparam Entity unsigned integer entity identifier to store
+ * @tparam Entity unsigned integer entity identifier to store or entity descriptor (see entity_traits)
  * @tparam Archetype list of components to store
  */
 template<typename Entity, typename Archetype>
@@ -162,288 +651,2157 @@ template<typename Entity, typename... Components>
 class storage<Entity, archetype<Components...>> final
 {
 public:
-  using entity_type = Entity;
+  using entity_type = typename entity_traits<Entity>::entity_type;
   using size_type = size_t;
+  using archetype_type = archetype<Components...>;
+  using traits_type = storage_traits<archetype_type>;
 
   template<typename Component>
   static constexpr bool contains_component = contains_v<Component, list<Components...>>;
 
+  static constexpr bool compact_disabled = traits_type::compact_disabled;
+  static constexpr bool stable_addresses = traits_type::stable_addresses;
+  static constexpr bool ordered = traits_type::ordered;
+  static constexpr bool deferred_erase = traits_type::deferred_erase || stable_addresses || ordered;
+  static constexpr bool enableable = traits_type::enableable || compact_disabled || deferred_erase;
+  static constexpr size_t groups = traits_type::groups;
+  static constexpr bool grouped = groups != 0;
+  static constexpr bool huge_pages = traits_type::huge_pages;
+  static constexpr bool observed = traits_type::observed;
+  static constexpr size_t version_block = traits_type::version_block;
+  static constexpr bool change_versions = version_block != 0;
+
+  using dirty_list_type = typename traits_type::dirty_components;
+
+  template<typename Component>
+  static constexpr bool tracks_dirty = contains_v<Component, dirty_list_type>;
+
 private:
   using dense_type = entity_type*;
   using page_type = entity_type*;
   using sparse_type = sparse_array<Entity>*;
-  using component_pool_type = std::tuple<Components*...>;
 
-  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
-    "Entity type must be an unsigned integer");
+  /**
+   * @brief Dense array of a component, a table of pages with stable addresses.
+   */
+  template<typename Component>
+  using column_type = std::conditional_t<stable_addresses, Component**, Component*>;
 
-public:
-  class iterator;
+  using component_pool_type = std::tuple<column_type<Components>...>;
+  using group_array_type = std::array<size_type, groups + 1>;
+  using dirty_array_type = std::array<summary_bitset, size_v<dirty_list_type>>;
+
+  static_assert(!grouped || contains_component<typename traits_type::group_component>,
+    "The group component does not belong to the archetype");
+
+  static_assert(!(grouped && compact_disabled), "Grouped storages cannot use compact disabled");
+
+  static_assert(!(deferred_erase && (grouped || compact_disabled)),
+    "Storages with deferred erase cannot be grouped or compact disabled");
+
+  static_assert(!(stable_addresses && huge_pages), "Storages with stable addresses cannot use huge pages");
+
+  static_assert(!(ordered && stable_addresses), "Ordered storages cannot have stable addresses");
+
+  static_assert(empty_v<difference_t<dirty_list_type, list<Components...>>>, "One or more dirty components do not belong to the archetype");
+
+  /**
+   * @brief Amount of rows of every page of the dense arrays with stable addresses.
+   */
+  static constexpr size_type column_page_size = 1024;
+
+  /**
+   * @brief Version of the storages that are not bound to a registry.
+   */
+  static constexpr size_type initial_version = 1;
+
+public:
+  class iterator;
+
+  /**
+   * @brief Construct a new storage object
+   */
+  storage()
+    : _dense(NULL), _size(0), _capacity(0), _groups {}, _disabled(0), _dead(0), _free(0), _sorted(0), _arranged(true),
+      _versions(NULL), _clock(&initial_version)
+  {
+    // Uses new, but normally when using shared sparse arrays it will be allocated on the stack
+    _sparse = new sparse_array<Entity>();
+
+    // Allocate nothing by default
+    ((access<Components>() = NULL), ...);
+  }
+
+  /**
+   * @brief Destroy the storage object
+   */
+  ~storage()
+  {
+    // We only manage our sparse_array memory if its not shared
+    if (_sparse->shared()) _sparse->unshare();
+    else
+      delete _sparse;
+
+    // We assume that if dense is NULL, the other arrays are NULL since
+    // they grow together.
+    if (_dense)
+    {
+      free_array(_dense);
+      (deallocate<Components>(), ...);
+    }
+
+    if (_versions) free(_versions);
+  }
+
+  storage(const storage&) = delete;
+  storage(storage&&) = delete;
+  storage& operator=(const storage&) = delete;
+  storage& operator=(storage&&) = delete;
+
+  /**
+   * @brief Inserts a entity and all its components at once.
+   * 
+   * Entities are always inserted in the back of the array, however they are not
+   * guarented to stay there, and can be moved around by other operations.
+   * 
+   * You can directly add the components with this method. However, components will be copied. 
+   * This is not nessesary and can be done later very efficiently using the unpack method. 
+   * Also, the order of the components dont matter, as long as they are all unique and part of the archetype.
+   * 
+   * This operation is usually O(1) and is pretty cheap. Some insert operations may be slower
+   * if any internal array need a resize.
+   * 
+   * In grouped storages, the entity is put in the first group if the group component is not included. Call
+   * regroup once the group component is assigned.
+   * 
+   * With stable addresses, the entity is put in the last dead row if there is one.
+   * 
+   * @warning Undefined behaviour if the entity already exists. If you dont know
+   * if the entity exists, call the contains method first.
+   * 
+   * @tparam IncludedComponents Types of components to insert with (optional).
+   * @param entity Entity to insert
+   * @param components Components to insert alongside entity
+   */
+  template<typename... IncludedComponents>
+  void insert(const entity_type entity, const IncludedComponents&... components)
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+    static_assert(unique_types_v<IncludedComponents...>,
+      "Included components are not unique");
+
+    if constexpr (stable_addresses)
+      if (_free) return revive(entity, components...);
+
+    if (_size == _capacity) grow();
+    _sparse->acquire(entity);
+
+    _dense[_size] = entity;
+
+    // Call the constructors if needed
+    (construct<Components>(_size), ...);
+
+    ((at<IncludedComponents>(_size) = components), ...);
+
+    stamp(_size, _size + 1);
+
+    for (auto& dirty : _dirty) dirty.set(_size);
+
+    (*_sparse)[entity] = static_cast<entity_type>(_size++);
+
+    // The rows stay sorted as long as the entities are inserted in increasing order
+    if constexpr (ordered)
+      if (_sorted == _size - 1 && (_sorted == 0 || index_of(_dense[_sorted - 1]) < index_of(entity))) ++_sorted;
+
+    if constexpr (enableable)
+    {
+      _enabled.set(_size - 1);
+
+      // The new entity is enabled, it must be moved in front of the disabled ones
+      if constexpr (compact_disabled)
+        if (_arranged && _disabled) swap_rows(_size - 1, _size - 1 - _disabled);
+    }
+
+    if constexpr (grouped)
+    {
+      // The new entity is at the end of the last group
+      ++_groups[groups];
+
+      if (_arranged)
+      {
+        // Without its group component, the entity is put in the first group until it is regrouped
+        size_type group = 0;
+
+        if constexpr (contains_v<typename traits_type::group_component, list<IncludedComponents...>>) group = group_of(_size - 1);
+
+        move_to_group(_size - 1, groups - 1, group);
+      }
+    }
+  }
+
+  /**
+   * @brief Erases an entity from the storage.
+   * 
+   * Erasing entities is essentially just poping an entity from the back of the array and moving
+   * it to the location of the entity to erase.
+   * 
+   * This is a very cheap O(1) operation.
+   * 
+   * With deferred erase, the row of the entity is only marked dead and no other row is moved (see compact).
+   * 
+   * @warning Undefined behaviour if the entity does not exist. If you dont know
+   * if the entity exists, call the contains method first.
+   * 
+   * @param entity Entity to erase
+   */
+  void erase(const entity_type entity)
+  {
+    remove_at((*_sparse)[entity]);
+  }
+
+  /**
+   * @brief Removes the dead rows left by deferred erases.
+   * 
+   * The live rows after the first dead one are moved down in a single streaming pass, so their order is kept.
+   * Does nothing if there are no dead rows. With stable addresses, this is the only erase that moves rows.
+   * 
+   * Ordered storages then merge the inserted entities in order.
+   * 
+   * @warning Must not be called while iterating the storage.
+   */
+  void compact()
+  {
+    static_assert(deferred_erase, "The archetype does not defer erases, see storage_traits");
+
+    if (_dead) remove_dead();
+
+    if constexpr (ordered)
+      if (_sorted != _size) merge();
+  }
+
+  /**
+   * @brief Moves an entity and its components directly into the storage of another archetype.
+   * 
+   * Components common to both archetypes are moved row to row without going through any temporary,
+   * components that only the destination has are default constructed and then assigned the included
+   * components if any.
+   * 
+   * This is as cheap as an insert followed by an erase.
+   * 
+   * @warning Undefined behaviour if the entity does not exist in this storage or if it already
+   * exists in the destination storage.
+   * 
+   * @tparam Archetype Archetype of the destination storage
+   * @tparam IncludedComponents Types of components to initialize in the destination (optional)
+   * @param entity Entity to transfer
+   * @param destination Storage to transfer the entity to
+   * @param components Components to assign in the destination after the transfer
+   */
+  template<typename Archetype, typename... IncludedComponents>
+  void transfer(const entity_type entity, storage<Entity, Archetype>& destination,
+    const IncludedComponents&... components)
+  {
+    // The sparse_array may be shared with the destination, so we must obtain our index before inserting
+    const auto index = (*_sparse)[entity];
+
+    destination.insert(entity);
+
+    const auto destination_index = (*destination._sparse)[entity];
+
+    ((destination.template move_from<Components>(destination_index, at<Components>(index))), ...);
+    ((destination.template at<IncludedComponents>(destination_index) = components), ...);
+
+    // Components that were already there keep their dirty bit
+    ((destination.template inherit_dirty<Components>(destination_index, *this, index)), ...);
+
+    if constexpr (enableable && storage<Entity, Archetype>::enableable)
+    {
+      if (!_enabled.test(index)) destination.disable(entity);
+    }
+
+    // The group component may have only been assigned after the insert
+    if constexpr (storage<Entity, Archetype>::grouped) destination.regroup(entity);
+
+    remove_at(index);
+  }
+
+  /**
+   * @brief Returns whether or not an entity is present in the storage.
+   * 
+   * This operation is a very cheap O(1) operation.
+   * 
+   * @param entity Entity to check
+   * @return true If entity is present in storage, false otherwise
+   */
+  bool contains(const entity_type entity) const
+  {
+    size_type index;
+
+    // We must access the dense array here because our sparse arrays may be shared, therefor we need
+    // to make sure entity index is valid.
+    // Stale versions of the entity are not contained since the whole identifier is compared
+    const bool found = _sparse->reaches(entity) && (index = (*_sparse)[entity]) < _size && _dense[index] == entity;
+
+    // Dead rows may keep their entity, but its sparse_array entry may now belong to another storage
+    if constexpr (deferred_erase) return found && !_tombstones.test(index);
+    else
+      return found;
+  }
+
+  /**
+   * @brief Enables an entity so that it is iterated again.
+   * 
+   * Does nothing if the entity is already enabled.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to enable
+   */
+  void enable(const entity_type entity)
+  {
+    static_assert(enableable, "The archetype is not enableable, see storage_traits");
+
+    auto index = static_cast<size_type>((*_sparse)[entity]);
+
+    if (_enabled.test(index)) return;
+
+    // Swap with the first disabled entity to keep the enabled entities at the front
+    if constexpr (compact_disabled)
+    {
+      if (_arranged)
+      {
+        swap_rows(index, _size - _disabled);
+        index = _size - _disabled;
+      }
+    }
+
+    _enabled.set(index);
+    --_disabled;
+  }
+
+  /**
+   * @brief Disables an entity so that it is skipped during iteration.
+   * 
+   * The entity keeps its components and can still be unpacked. Does nothing if the entity is already disabled.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to disable
+   */
+  void disable(const entity_type entity)
+  {
+    static_assert(enableable, "The archetype is not enableable, see storage_traits");
+
+    auto index = static_cast<size_type>((*_sparse)[entity]);
+
+    if (!_enabled.test(index)) return;
+
+    // Swap with the last enabled entity to keep the enabled entities at the front
+    if constexpr (compact_disabled)
+    {
+      if (_arranged)
+      {
+        swap_rows(index, _size - _disabled - 1);
+        index = _size - _disabled - 1;
+      }
+    }
+
+    _enabled.reset(index);
+    ++_disabled;
+  }
+
+  /**
+   * @brief Returns whether or not an entity is enabled.
+   * 
+   * Entities of storages that are not enableable are always enabled.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to check
+   * @return true If the entity is enabled, false otherwise
+   */
+  [[nodiscard]] bool enabled(const entity_type entity) const
+  {
+    if constexpr (enableable) return _enabled.test((*_sparse)[entity]);
+    else
+    {
+      (void)entity; // Suppress unused warning
+      return true;
+    }
+  }
+
+  /**
+   * @brief Calls the function with an iterator at every enabled entity.
+   * 
+   * Entities are visited in the same order as iterating from begin to end. When some entities are disabled
+   * the enabled mask is scanned a word at a time, full words are iterated without any checks and empty
+   * words are skipped. In compact mode only the front of the storage is iterated. Ordered storages are compacted
+   * first if entities were inserted out of order.
+   * 
+   * @warning The function must not insert or erase entities in this storage, unless erases are deferred.
+   * 
+   * @tparam Function Function type
+   * @param function Function invoked with a reference to an iterator
+   */
+  template<typename Function>
+  void each(const Function& function)
+  {
+    if constexpr (compact_disabled)
+    {
+      if (!_arranged) arrange();
+
+      for (size_type i = _size - _disabled; i-- > 0;)
+      {
+        iterator it { this, i };
+        function(it);
+      }
+    }
+    else if constexpr (enableable)
+    {
+      if constexpr (ordered)
+        if (_sorted != _size) compact();
+
+      // With deferred erase, rows may die during the iteration so the mask is always checked
+      if (!deferred_erase && _disabled == 0)
+      {
+        for (auto it = begin(); it != end(); ++it) function(it);
+      }
+      else
+      {
+        for (size_type w = (_size + bitset::word_bits - 1) / bitset::word_bits; w-- > 0;)
+        {
+          const size_type offset = w * bitset::word_bits;
+
+          auto word = _enabled.word(w);
+
+          // Rows over the size may hold stale bits
+          if (_size - offset < bitset::word_bits) word &= (bitset::word_type { 1 } << (_size - offset)) - 1;
+
+          if (!deferred_erase && word == ~bitset::word_type { 0 })
+          {
+            for (size_type i = offset + bitset::word_bits; i-- > offset;)
+            {
+              iterator it { this, i };
+              function(it);
+            }
+          }
+          else
+          {
+            while (word)
+            {
+              const size_type bit = highest_bit(word);
+
+              iterator it { this, offset + bit };
+              function(it);
+
+              word &= ~(bitset::word_type { 1 } << bit);
+
+              // Rows of the word erased by the function are skipped
+              if constexpr (deferred_erase) word &= _enabled.word(w);
+            }
+          }
+        }
+      }
+    }
+    else
+    {
+      for (auto it = begin(); it != end(); ++it) function(it);
+    }
+  }
+
+  /**
+   * @brief Calls the function with an iterator at every enabled entity of a group.
+   * 
+   * Only the rows of the group are visited.
+   * 
+   * @warning The function must not insert or erase entities in this storage, or modify the group component.
+   * 
+   * @tparam Function Function type
+   * @param group Group to iterate
+   * @param function Function invoked with a reference to an iterator
+   */
+  template<typename Function>
+  void each_group(const size_type group, const Function& function)
+  {
+    static_assert(grouped, "The archetype is not grouped, see storage_traits");
+
+    assert(group < groups && "Invalid group");
+
+    if (!_arranged) arrange();
+
+    for (size_type i = _groups[group + 1]; i-- > _groups[group];)
+    {
+      if constexpr (enableable)
+        if (!_enabled.test(i)) continue;
+
+      iterator it { this, i };
+      function(it);
+    }
+  }
+
+  /**
+   * @brief Moves an entity to its group after its group component was modified.
+   * 
+   * Does nothing if the entity is already in the right group.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to regroup
+   */
+  void regroup(const entity_type entity)
+  {
+    static_assert(grouped, "The archetype is not grouped, see storage_traits");
+
+    if (!_arranged) return; // Will be regrouped when arranged
+
+    const size_type index = (*_sparse)[entity];
+
+    // Groups are sorted so the current group can be found with a binary search
+    const size_type current = static_cast<size_type>(
+      std::upper_bound(_groups.begin(), _groups.end(), index) - _groups.begin() - 1);
+
+    move_to_group(index, current, group_of(index));
+  }
+
+  /**
+   * @brief Returns the amount of entities in a group, including the disabled ones.
+   * 
+   * @param group Group to count
+   * @return size_type Amount of entities in the group
+   */
+  [[nodiscard]] size_type group_size(const size_type group)
+  {
+    static_assert(grouped, "The archetype is not grouped, see storage_traits");
+
+    if (!_arranged) arrange();
+
+    return _groups[group + 1] - _groups[group];
+  }
+
+  /**
+   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * 
+   * This operation simply optains the index of the entity and access the dense array that holds
+   * the component of requested type.
+   * 
+   * Very cheap operation, however unpacking from the iterator doesn't require recalculating the index
+   * every time, so try to prioritize that (even if its a very cheap to find the index).
+   * 
+   * @tparam Component Type of component to unpack
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  Component& unpack(const entity_type entity)
+  {
+    static_assert(contains_v<Component, list<Components...>>,
+      "The component your trying to unpack does not belong to the archetype");
+
+    const size_type index = (*_sparse)[entity];
+
+    // The component may be written through the reference
+    if constexpr (change_versions) _versions[version_at(index / version_block, find_v<Component, list<Components...>>)] = *_clock;
+    if constexpr (tracks_dirty<Component>) std::get<find_v<Component, dirty_list_type>>(_dirty).set(index);
+
+    return at<Component>(index);
+  }
+
+  /**
+   * @brief Returns a const reference of the stored component for the specified entity and component type.
+   * 
+   * Same as unpack, but the change version of the component is not stamped.
+   * 
+   * @tparam Component Type of component to unpack
+   * @param entity Entity to unpack component for
+   * @return const Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  const Component& unpack(const entity_type entity) const
+  {
+    static_assert(contains_v<Component, list<Components...>>,
+      "The component your trying to unpack does not belong to the archetype");
+
+    return const_cast<storage*>(this)->template at<Component>((*_sparse)[entity]);
+  }
+
+  /**
+   * @brief Resizes every internal dense array to be as small as possible.
+   * 
+   * This is good to call every once in a while to optimize memory usage.
+   * 
+   * @note This only resizes the sparse_array if it is not shared, shared sparse_arrays
+   * are resized by their owner (see registry::optimize).
+   */
+  void shrink_to_fit()
+  {
+    // Stable storages only free the pages after the last row
+    if constexpr (deferred_erase && !stable_addresses) compact();
+
+    if (!_sparse->shared()) _sparse->shrink_to_fit(reach());
+
+    if (paged_capacity(_size) != _capacity)
+    {
+      const size_type previous = _capacity;
+
+      _capacity = paged_capacity(_size);
+
+      _dense = resize_array(_dense, previous);
+      (reallocate<Components>(previous), ...);
+
+      if constexpr (enableable) _enabled.resize(_capacity);
+      if constexpr (deferred_erase) _tombstones.resize(_capacity);
+      if constexpr (change_versions) resize_versions(previous);
+      for (auto& dirty : _dirty) dirty.resize(_capacity);
+    }
+  }
+
+  /**
+   * @brief Makes sure the storage can hold at least the specified amount of entities without resizing.
+   * 
+   * This can be used before inserting many entities at once to resize only once.
+   * 
+   * @param capacity Minimum capacity of entities
+   */
+  void reserve(const size_type capacity)
+  {
+    if (capacity > _capacity)
+    {
+      const size_type previous = _capacity;
+
+      _capacity = paged_capacity(capacity);
+
+      _dense = resize_array(_dense, previous);
+      (reallocate<Components>(previous), ...);
+
+      if constexpr (enableable) _enabled.resize(_capacity);
+      if constexpr (deferred_erase) _tombstones.resize(_capacity);
+      if constexpr (change_versions) resize_versions(previous);
+      for (auto& dirty : _dirty) dirty.resize(_capacity);
+    }
+  }
+
+  /**
+   * @brief Moves every entity that satisfies the predicate to the back of the storage.
+   * 
+   * The predicate is invoked with an iterator at the entity to test. Entities are moved by swapping them with
+   * entities from the back that dont satisfy the predicate, so this is a single pass over the storage.
+   * 
+   * Ordered storages keep the order on both sides, every row is then moved at most once.
+   * 
+   * @tparam Predicate Predicate type
+   * @param predicate Predicate invoked with an iterator for every entity
+   * @return size_type Amount of entities that satisfied the predicate (now at the back)
+   */
+  template<typename Predicate>
+  size_type partition(const Predicate& predicate)
+  {
+    if constexpr (deferred_erase) compact();
+
+    if constexpr (ordered) return ordered_partition([&predicate, this](const size_type i)
+      { return predicate(iterator { this, i }); });
+
+    _arranged = false;
+
+    size_type first = 0;
+    size_type last = _size;
+
+    while (true)
+    {
+      while (first != last && !predicate(iterator { this, first })) ++first;
+
+      do
+      {
+        if (first == last) return _size - first;
+      } while (predicate(iterator { this, --last }));
+
+      swap_rows(first++, last);
+    }
+  }
+
+  /**
+   * @brief Moves the specified entities to the back of the storage.
+   * 
+   * Only the rows of the specified entities and as many rows from the back are moved. Ordered storages keep
+   * the order on both sides.
+   * 
+   * @warning Undefined behaviour if any of the entities does not exist in the storage or
+   * if any entity is specified more than once.
+   * 
+   * @param entities Entities to move to the back
+   * @param count Amount of entities
+   * @return size_type Amount of entities moved to the back
+   */
+  size_type partition(const entity_type* entities, const size_type count)
+  {
+    if constexpr (deferred_erase) compact();
+
+    if constexpr (ordered)
+    {
+      bitset marked;
+      marked.resize(_size);
+
+      for (size_type i = 0; i < count; i++) marked.set((*_sparse)[entities[i]]);
+
+      return ordered_partition([&marked](const size_type i)
+        { return marked.test(i); });
+    }
+
+    _arranged = false;
+
+    size_type back = _size;
+
+    for (size_type i = 0; i < count; i++)
+    {
+      swap_rows((*_sparse)[entities[i]], --back);
+    }
+
+    return count;
+  }
+
+  /**
+   * @brief Sorts the entities so that they are iterated in the order of the comparison.
+   * 
+   * The comparison is invoked with iterators at the two entities to compare and returns whether or not the first
+   * one goes before the second. The order of the rows is computed once, then every dense array is permuted
+   * in place and the sparse_array is fixed in a single pass. Entities that are equivalent keep their order.
+   * 
+   * @warning Moves rows, even with stable addresses.
+   * 
+   * @tparam Compare Comparison type
+   * @param compare Comparison invoked with two iterators
+   */
+  template<typename Compare>
+  void sort(const Compare& compare)
+  {
+    static_assert(!grouped && !compact_disabled && !ordered, "Grouped, compact disabled and ordered storages cannot be sorted");
+
+    if constexpr (deferred_erase) compact();
+
+    if (_size < 2) return;
+
+    size_type* order = static_cast<size_type*>(std::malloc(_size * sizeof(size_type)));
+
+    // Rows are iterated from the back
+    for (size_type i = 0; i < _size; i++) order[i] = _size - 1 - i;
+
+    std::stable_sort(order, order + _size, [this, &compare](const size_type lhs, const size_type rhs)
+      { return compare(iterator { this, lhs }, iterator { this, rhs }); });
+
+    // The first row in order is iterated first, so it goes at the back
+    std::reverse(order, order + _size);
+
+    permute(order);
+
+    std::free(order);
+  }
+
+  /**
+   * @brief Sorts the entities so that they are iterated in increasing order of a key.
+   * 
+   * The key function is invoked once per entity with an iterator at the entity. Integral keys are sorted with a
+   * radix sort a byte at a time, bytes that are the same for every key are skipped. Other keys are sorted
+   * with their less than operator. Then, same as sort, every dense array is permuted in place.
+   * 
+   * @warning Moves rows, even with stable addresses.
+   * 
+   * @tparam Key Key function type
+   * @param key Key function invoked with an iterator for every entity
+   */
+  template<typename Key>
+  void sort_by(const Key& key)
+  {
+    static_assert(!grouped && !compact_disabled && !ordered, "Grouped, compact disabled and ordered storages cannot be sorted");
+
+    using key_type = std::decay_t<decltype(key(std::declval<iterator>()))>;
+
+    if constexpr (deferred_erase) compact();
+
+    if (_size < 2) return;
+
+    size_type* order = static_cast<size_type*>(std::malloc(_size * sizeof(size_type)));
+
+    if constexpr (std::is_integral_v<key_type> && !std::is_same_v<key_type, bool>)
+    {
+      radix_order(key, order);
+    }
+    else
+    {
+      std::vector<key_type> keys;
+      keys.reserve(_size);
+
+      // Rows are iterated from the back
+      for (size_type i = 0; i < _size; i++)
+      {
+        order[i] = i;
+        keys.push_back(key(iterator { this, _size - 1 - i }));
+      }
+
+      std::stable_sort(order, order + _size, [&keys](const size_type lhs, const size_type rhs)
+        { return keys[lhs] < keys[rhs]; });
+
+      for (size_type i = 0; i < _size; i++) order[i] = _size - 1 - order[i];
+    }
+
+    // The first row in order is iterated first, so it goes at the back
+    std::reverse(order, order + _size);
+
+    permute(order);
+
+    std::free(order);
+  }
+
+  /**
+   * @brief Moves the entities at the back of the storage to the back of another storage.
+   * 
+   * This is the bulk version of transfer. The destination is resized at most once, every component
+   * common to both archetypes is moved with a single copy of the range and components that only the
+   * destination has are initialized in a single loop, with the included value or value-initialized.
+   * The entities are then removed from this storage by shrinking it.
+   * 
+   * This is usually used after partition. Disabled entities stay disabled if the destination is enableable.
+   * 
+   * @tparam Archetype Archetype of the destination storage
+   * @tparam IncludedComponents Types of components to initialize in the destination (optional)
+   * @param count Amount of entities to transfer from the back
+   * @param destination Storage to transfer the entities to
+   * @param components Components to initialize the transfered entities with in the destination
+   */
+  template<typename Archetype, typename... IncludedComponents>
+  void transfer_back(const size_type count, storage<Entity, Archetype>& destination,
+    const IncludedComponents&... components)
+  {
+    static_assert(unique_types_v<IncludedComponents...>,
+      "Included components are not unique");
+
+    if (count == 0) return;
+
+    const size_type first = _size - count;
+
+    destination.receive(*this, first, count, std::tuple<const IncludedComponents&...> { components... });
+
+    erase_back(count);
+  }
+
+  /**
+   * @brief Erases the entities at the back of the storage.
+   * 
+   * This is the bulk version of erase, usually used after partition. The storage is simply shrunk, the other
+   * rows are not moved.
+   * 
+   * @warning The rows at the back must not be dead rows left by deferred erases (see partition).
+   * 
+   * @param count Amount of entities to erase from the back
+   */
+  void erase_back(const size_type count)
+  {
+    const size_type first = _size - count;
+
+    for (size_type i = first; i < _size; i++)
+    {
+      if constexpr (enableable)
+        if (!_enabled.test(i)) --_disabled;
+
+      (destroy<Components>(i), ...);
+
+      _sparse->release(_dense[i]);
+    }
+
+    _size = first;
+
+    if constexpr (ordered)
+      if (_sorted > first) _sorted = first;
+
+    if constexpr (grouped) _groups[groups] = first;
+  }
+
+  /**
+   * @brief Replaces the identifier of every entity.
+   * 
+   * The function is invoked with every entity and its index, and returns the new identifier of the entity.
+   * Only the dense array and the sparse_array are rewritten, the rows and their components are not moved.
+   * 
+   * @warning The new identifiers must be unique. The sparse_array entries of the old identifiers are left
+   * untouched, so the function must not rely on this storage to find other entities.
+   * 
+   * @tparam Function Function type
+   * @param function Function invoked with every entity and its index
+   */
+  template<typename Function>
+  void remap(const Function& function)
+  {
+    if constexpr (deferred_erase) compact();
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      const entity_type entity = function(_dense[i], i);
+
+      _sparse->acquire(entity);
+      _sparse->release(_dense[i]);
+
+      _dense[i] = entity;
+      (*_sparse)[entity] = static_cast<entity_type>(i);
+    }
+
+    // The rows hold other entities
+    stamp(0, _size);
+
+    // The new identifiers may be in another order, they are merged by the next iteration
+    if constexpr (ordered)
+    {
+      _sorted = _size != 0;
+
+      while (_sorted < _size && index_of(_dense[_sorted - 1]) < index_of(_dense[_sorted])) ++_sorted;
+    }
+  }
+
+  /**
+   * @brief Marks the component of an entity as dirty.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @tparam Component Component to mark, must be one of the dirty components (see storage_traits)
+   * @param entity Entity to mark
+   */
+  template<typename Component>
+  void mark_dirty(const entity_type entity)
+  {
+    static_assert(tracks_dirty<Component>, "The component has no dirty bits, see storage_traits");
+
+    std::get<find_v<Component, dirty_list_type>>(_dirty).set((*_sparse)[entity]);
+  }
+
+  /**
+   * @brief Returns whether or not the component of an entity is dirty.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @tparam Component Component to check, must be one of the dirty components (see storage_traits)
+   * @param entity Entity to check
+   * @return true If the component is dirty, false otherwise
+   */
+  template<typename Component>
+  [[nodiscard]] bool dirty(const entity_type entity) const
+  {
+    static_assert(tracks_dirty<Component>, "The component has no dirty bits, see storage_traits");
+
+    return std::get<find_v<Component, dirty_list_type>>(_dirty).test((*_sparse)[entity]);
+  }
+
+  /**
+   * @brief Clears the dirty bit of the component of every entity.
+   * 
+   * Only the words that had dirty bits are written.
+   * 
+   * @tparam Component Component to clear, must be one of the dirty components (see storage_traits)
+   */
+  template<typename Component>
+  void clear_dirty()
+  {
+    static_assert(tracks_dirty<Component>, "The component has no dirty bits, see storage_traits");
+
+    std::get<find_v<Component, dirty_list_type>>(_dirty).clear();
+  }
+
+  /**
+   * @brief Calls the function with an iterator at every enabled entity whose component is dirty.
+   * 
+   * The dirty bits are scanned a word at a time and words without any dirty bit are skipped with their summary,
+   * so this costs about the amount of dirty entities. Entities are visited in the same order as each.
+   * 
+   * @warning The function must not insert or erase entities in this storage, unless erases are deferred.
+   * 
+   * @tparam Component Component to check, must be one of the dirty components (see storage_traits)
+   * @tparam Function Function type
+   * @param function Function invoked with a reference to an iterator
+   */
+  template<typename Component, typename Function>
+  void each_dirty(const Function& function)
+  {
+    static_assert(tracks_dirty<Component>, "The component has no dirty bits, see storage_traits");
+
+    if constexpr (ordered)
+      if (_sorted != _size) compact();
+
+    std::get<find_v<Component, dirty_list_type>>(_dirty).each([this, &function](const size_type w, auto word)
+      {
+        const size_type offset = w * bitset::word_bits;
+
+        // Rows over the size may hold stale bits
+        if (offset >= _size) return;
+        if (_size - offset < bitset::word_bits) word &= (bitset::word_type { 1 } << (_size - offset)) - 1;
+
+        if constexpr (enableable) word &= _enabled.word(w);
+
+        while (word)
+        {
+          const size_type bit = highest_bit(word);
+
+          iterator it { this, offset + bit };
+          function(it);
+
+          word &= ~(bitset::word_type { 1 } << bit);
+
+          // Rows of the word erased by the function are skipped
+          if constexpr (deferred_erase) word &= _enabled.word(w);
+        }
+      });
+  }
+
+  /**
+   * @brief Calls the function with an iterator at every enabled entity of the blocks that changed since a version.
+   * 
+   * Same as each, but only the blocks where one of the watched components was written after the version are
+   * visited (see storage_traits::version_block). Every enabled entity of those blocks is visited, the ones that
+   * did not change included.
+   * 
+   * @warning The function must not insert or erase entities in this storage, unless erases are deferred.
+   * 
+   * @tparam Watched Components to check the change versions of
+   * @tparam Function Function type
+   * @param version Version to compare to, blocks written at this version are skipped
+   * @param function Function invoked with a reference to an iterator
+   */
+  template<typename... Watched, typename Function>
+  void each_changed(const size_type version, const Function& function)
+  {
+    static_assert(change_versions, "The archetype has no change versions, see storage_traits");
+    static_assert(contains_all_v<list<Components...>, Watched...>, "One or more watched components do not belong to the archetype");
+
+    if constexpr (compact_disabled)
+      if (!_arranged) arrange();
+
+    if constexpr (ordered)
+      if (_sorted != _size) compact();
+
+    size_type end = _size;
+
+    if constexpr (compact_disabled) end -= _disabled;
+
+    for (size_type block = (end + version_block - 1) / version_block; block-- > 0;)
+    {
+      if (((_versions[version_at(block, find_v<Watched, list<Components...>>)] <= version) && ...)) continue;
+
+      const size_type first = block * version_block;
+
+      for (size_type i = first + version_block < end ? first + version_block : end; i-- > first;)
+      {
+        if constexpr (enableable)
+          if (!_enabled.test(i)) continue;
+
+        iterator it { this, i };
+        function(it);
+      }
+    }
+  }
+
+  /**
+   * @brief Stamps the change version of components in every block, for writes through iterators.
+   * 
+   * Iterators never stamp the versions themselves. Does nothing without change versions.
+   * 
+   * @tparam Written Components that may have been written
+   */
+  template<typename... Written>
+  void mark_written(list<Written...>)
+  {
+    if constexpr (change_versions)
+    {
+      const size_type blocks = (_size + version_block - 1) / version_block;
+
+      for (size_type block = 0; block < blocks; block++)
+      {
+        ((_versions[version_at(block, find_v<Written, list<Components...>>)] = *_clock), ...);
+      }
+    }
+  }
+
+  /**
+   * @brief Stamps the change version of components in the block of an entity, for writes through iterators.
+   * 
+   * Does nothing without change versions.
+   * 
+   * @tparam Written Components that may have been written
+   * @param entity Entity that may have been written
+   */
+  template<typename... Written>
+  void mark_written(list<Written...>, const entity_type entity)
+  {
+    if constexpr (change_versions)
+    {
+      const size_type block = (*_sparse)[entity] / version_block;
+
+      ((_versions[version_at(block, find_v<Written, list<Components...>>)] = *_clock), ...);
+    }
+    else
+      (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Returns the version at which the component of an entity was last written.
+   * 
+   * This is the version of the whole block of the entity, so writes to other entities of the block count.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @tparam Component Component to check
+   * @param entity Entity to check
+   * @return size_type Last version the block of the entity was written at
+   */
+  template<typename Component>
+  [[nodiscard]] size_type version(const entity_type entity) const
+  {
+    static_assert(change_versions, "The archetype has no change versions, see storage_traits");
+
+    return _versions[version_at((*_sparse)[entity] / version_block, find_v<Component, list<Components...>>)];
+  }
+
+  /**
+   * @brief Binds the clock that the change versions are stamped with.
+   * 
+   * The registry binds its own version to every storage. Unbound storages always stamp the same version.
+   * 
+   * @param clock Current version, must outlive the storage
+   */
+  void track(const size_type* clock)
+  {
+    _clock = clock;
+  }
+
+  /**
+   * @brief Binds the shared sparse_array to this storage.
+   * 
+   * Sharing sparse_arrays between storages that operate on entities distributed by the
+   * same entity_manager is recommended for performance and memory usage.
+   * 
+   * @warning Attemping to share a sparse array while already containing entities
+   * will no nothing.
+   * 
+   * @param sparse The sparse_array to share with this storage
+   */
+  void share(sparse_type sparse)
+  {
+    if (_size != 0) return;
+
+    if (_sparse->shared()) _sparse->unshare();
+    else
+      // If the sparse_array is not shared that means we current have the default sparse_array
+      // allocated at initialization and we must delete it.
+      delete _sparse;
+
+    _sparse = sparse;
+    sparse->share();
+  }
+
+  /**
+   * @brief clears the entire storage
+   * 
+   * As cheap of an operation as you can get (sets size to zero). With a paged sparse_array,
+   * every entity is released from its page.
+   */
+  void clear()
+  {
+    // Pages of the sparse_array count their entities, dead entities were already released
+    if constexpr (sparse_array<Entity>::paged)
+      for (size_type i = 0; i < _size; i++)
+      {
+        if constexpr (deferred_erase)
+          if (_tombstones.test(i)) continue;
+
+        _sparse->release(_dense[i]);
+      }
+
+    if constexpr (deferred_erase) _tombstones.clear();
+
+    for (auto& dirty : _dirty) dirty.clear();
+
+    _size = 0;
+    _free = 0;
+    _sorted = 0;
+    _disabled = 0;
+    _dead = 0;
+    _arranged = true;
+    _groups.fill(0);
+  }
+
+  /**
+   * @brief Returns an iterator of the first entity of the dense array.
+   * 
+   * If the storage is empty the begining with be equal to the end.
+   * 
+   * @return iterator Dense array iterator begining
+   */
+  iterator begin() { return { this, _size - 1 }; }
+
+  /**
+   * @brief Returns an iterator at the last entity of the dense array.
+   * 
+   * If the storage is empty the begining with be equal to the end.
+   * 
+   * @return iterator Dense array iterator end
+   */
+  iterator end() { return { this, static_cast<size_type>(-1) }; }
+
+  /**
+   * @brief Returns an iterator at an entity.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to find
+   * @return iterator Iterator at the entity
+   */
+  iterator find(const entity_type entity) { return { this, (*_sparse)[entity] }; }
+
+  /**
+   * @brief Hints the processor to load the row of an entity, for a lookup a bit later.
+   * 
+   * The sparse_array entry of the entity should already be loaded (see sparse_array::prefetch). The entity and its
+   * components are prefetched if its entry is within the rows, even if the entity is actually in another storage
+   * sharing the sparse_array.
+   * 
+   * @param entity Entity to prefetch
+   */
+  void prefetch(const entity_type entity)
+  {
+    if (!_sparse->reaches(entity)) return;
+
+    const size_type index = (*_sparse)[entity];
+
+    if (index >= _size) return;
+
+    xecs::prefetch(_dense + index);
+    (xecs::prefetch(&at<Components>(index)), ...);
+  }
+
+  /**
+   * @brief Returns the dense array of entities.
+   * 
+   * Dead rows left by deferred erases are included (see rows and alive).
+   * 
+   * @return const entity_type* Entities of the storage
+   */
+  [[nodiscard]] const entity_type* data() const { return _dense; }
+
+  /**
+   * @brief Returns the amount of entites current held by the storage.
+   * 
+   * Dead rows left by deferred erases are not counted (see rows).
+   * 
+   * @return size_type Amount of entities currently in storage
+   */
+  [[nodiscard]] size_type size() const { return _size - _dead; }
+
+  /**
+   * @brief Returns the amount of rows of the dense arrays, including the dead rows left by deferred erases.
+   * 
+   * Iterating from begin to end visits this many rows.
+   * 
+   * @return size_type Amount of rows
+   */
+  [[nodiscard]] size_type rows() const { return _size; }
+
+  /**
+   * @brief Returns whether or not a row holds a live entity.
+   * 
+   * Dead rows left by deferred erases may hold anything in the dense array, with stable addresses even the link
+   * to the next free row, so their value must never be read as an entity.
+   * 
+   * @param index Index of the row, must be less than rows
+   * @return true If the row holds a live entity, false if it is dead
+   */
+  [[nodiscard]] bool alive(const size_type index) const
+  {
+    if constexpr (deferred_erase) return !_tombstones.test(index);
+    else
+    {
+      (void)index; // Suppress unused warning
+      return true;
+    }
+  }
+
+  /**
+   * @brief Returns the highest index of the entities in the storage plus one.
+   * 
+   * This is the amount of indexes the sparse_array must reach for this storage. It is O(N).
+   * 
+   * @return size_type Highest entity index plus one, zero if the storage is empty
+   */
+  [[nodiscard]] size_type reach() const
+  {
+    size_type result = 0;
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      if constexpr (deferred_erase)
+        if (_tombstones.test(i)) continue;
+
+      const size_type index = static_cast<size_type>(entity_traits<Entity>::index(_dense[i])) + 1;
+
+      if (index > result) result = index;
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Returns the amount of bytes allocated by the sparse_array of the storage.
+   * 
+   * @return size_type Amount of bytes allocated, for the whole sparse_array if it is shared
+   */
+  [[nodiscard]] size_type sparse_memory() const { return _sparse->memory(); }
+
+  /**
+   * @brief Returns the amount of bytes of the sparse_array that are not needed by this storage.
+   * 
+   * This is O(N) where N is the amount of entities.
+   * 
+   * @return size_type Amount of bytes wasted, only accurate if the sparse_array is not shared
+   */
+  [[nodiscard]] size_type wasted_sparse_memory() const { return _sparse->wasted_memory(reach()); }
+
+  /**
+   * @brief Returns the current entity capacity of the storage.
+   * 
+   * If this is equal to the size, the next insert operation if no entites
+   * are removed will result in a resize of all internal dense arrays.
+   * 
+   * @return size_type Current capacity of entities in storage
+   */
+  [[nodiscard]] size_type capacity() const { return _capacity; }
+
+  /**
+   * @brief Returns whether or not the storage is empty.
+   * 
+   * The storage is empty when there are not entities currently being
+   * stored in it.
+   * 
+   * @return true If the storage is empty, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _size == _dead; }
+
+private:
+  template<typename, typename>
+  friend class storage;
+
+  /**
+   * @brief Erases the entity at the specified index, or marks it dead with deferred erase.
+   * 
+   * Dead rows are disabled so that they are skipped during iteration. The components are destroyed right away
+   * and the entity is released from the sparse_array, but its entry is left untouched.
+   * 
+   * @param index Index of the entity to erase
+   */
+  void remove_at(const size_type index)
+  {
+    if constexpr (deferred_erase)
+    {
+      if (_enabled.test(index))
+      {
+        _enabled.reset(index);
+        ++_disabled;
+      }
+
+      _tombstones.set(index);
+      ++_dead;
+
+      for (auto& dirty : _dirty) dirty.reset(index);
+
+      // Call the destructors if needed
+      (destroy<Components>(index), ...);
+
+      _sparse->release(_dense[index]);
+
+      // The entity of a dead row is no longer needed, it links the dead rows to reuse
+      if constexpr (stable_addresses)
+      {
+        _dense[index] = static_cast<entity_type>(_free);
+        _free = index + 1;
+      }
+    }
+    else
+      erase_at(index);
+  }
+
+  /**
+   * @brief Removes the dead rows in a single streaming pass, see compact.
+   */
+  void remove_dead()
+  {
+    size_type write = 0;
+
+    // Rows before the first dead one stay in place
+    while (_tombstones.word(write / bitset::word_bits) == 0) write += bitset::word_bits;
+
+    write += lowest_bit(_tombstones.word(write / bitset::word_bits));
+
+    const size_type first_dead = write;
+
+    // Amount of dead rows in the sorted rows
+    size_type sorted_dead = write < _sorted;
+
+    for (size_type read = write + 1; read < _size; read++)
+    {
+      if (_tombstones.test(read))
+      {
+        sorted_dead += read < _sorted;
+        continue;
+      }
+
+      const auto entity = _dense[read];
+
+      _dense[write] = entity;
+      (*_sparse)[entity] = static_cast<entity_type>(write);
+
+      ((at<Components>(write) = std::move(at<Components>(read))), ...);
+
+      _enabled.assign(write, _enabled.test(read));
+
+      for (auto& dirty : _dirty) dirty.assign(write, dirty.test(read));
+
+      ++write;
+    }
+
+    _tombstones.clear();
+    _free = 0;
+
+    stamp(first_dead, write);
+
+    _size = write;
+    _sorted -= sorted_dead;
+    _disabled -= _dead;
+    _dead = 0;
+  }
+
+  /**
+   * @brief Moves the rows that satisfy a predicate to the back, keeping the order on both sides.
+   * 
+   * Used by the partitions of ordered storages. The rows are permuted once.
+   * 
+   * @tparam Predicate Predicate type
+   * @param predicate Predicate invoked with the index of every row
+   * @return size_type Amount of rows that satisfied the predicate (now at the back)
+   */
+  template<typename Predicate>
+  size_type ordered_partition(const Predicate& predicate)
+  {
+    size_type* order = static_cast<size_type*>(std::malloc(_size * sizeof(size_type)));
+
+    size_type front = 0;
+    size_type back = _size;
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      if (predicate(i)) order[--back] = i;
+      else
+        order[front++] = i;
+    }
+
+    std::reverse(order + back, order + _size);
+
+    permute(order);
+
+    std::free(order);
+
+    // Only the rows that stay in front are sorted
+    _sorted = back;
+
+    return _size - back;
+  }
+
+  /**
+   * @brief Merges the rows inserted after the sorted ones in order of entity.
+   * 
+   * The inserted rows are sorted, then merged with the sorted rows and the storage is permuted once. Rows
+   * before the first inserted entity are not moved.
+   * 
+   * @warning There must not be any dead rows.
+   */
+  void merge()
+  {
+    size_type* order = static_cast<size_type*>(std::malloc(_size * sizeof(size_type)));
+
+    for (size_type i = 0; i < _size; i++) order[i] = i;
+
+    const auto compare = [this](const size_type lhs, const size_type rhs)
+    { return index_of(_dense[lhs]) < index_of(_dense[rhs]); };
+
+    std::sort(order + _sorted, order + _size, compare);
+    std::inplace_merge(order, order + _sorted, order + _size, compare);
+
+    permute(order);
+
+    std::free(order);
+
+    _sorted = _size;
+  }
+
+  /**
+   * @brief Returns the index of an entity, used to order the rows of ordered storages.
+   * 
+   * @param entity Entity identifier
+   * @return entity_type Index of the entity
+   */
+  static entity_type index_of(const entity_type entity) { return entity_traits<Entity>::index(entity); }
+
+  /**
+   * @brief Inserts an entity in the last dead row.
+   * 
+   * Used by insert with stable addresses, no other row is moved and the storage never grows.
+   * 
+   * @tparam IncludedComponents Types of components to insert with
+   * @param entity Entity to insert
+   * @param components Components to insert alongside entity
+   */
+  template<typename... IncludedComponents>
+  void revive(const entity_type entity, const IncludedComponents&... components)
+  {
+    const size_type index = _free - 1;
+
+    _free = static_cast<size_type>(_dense[index]);
+
+    _sparse->acquire(entity);
+
+    _dense[index] = entity;
+
+    (construct<Components>(index), ...);
+
+    ((at<IncludedComponents>(index) = components), ...);
+
+    stamp(index, index + 1);
+
+    for (auto& dirty : _dirty) dirty.set(index);
+
+    (*_sparse)[entity] = static_cast<entity_type>(index);
+
+    _tombstones.reset(index);
+    --_dead;
+
+    _enabled.set(index);
+    --_disabled;
+  }
+
+  /**
+   * @brief Erases the entity at the specified index of the dense arrays.
+   * 
+   * Pops the entity at the back of the array and moves it to the erased location. The sparse_array
+   * entry of the erased entity is left untouched, so this is safe to call after the entity was
+   * inserted in another storage sharing the same sparse_array.
+   * 
+   * @param index Index of the entity to erase
+   */
+  void erase_at(size_type index)
+  {
+    if constexpr (grouped)
+    {
+      // Move the entity after the last group, then it is erased from the back
+      if (_arranged)
+      {
+        const size_type current = static_cast<size_type>(
+          std::upper_bound(_groups.begin(), _groups.end(), index) - _groups.begin() - 1);
+
+        move_to_group(index, current, groups);
+        index = _size - 1;
+      }
+      else
+        --_groups[groups];
+    }
+
+    if constexpr (enableable)
+    {
+      if (!_enabled.test(index)) --_disabled;
+      else if constexpr (compact_disabled)
+      {
+        // Move the hole to the last enabled row, it is then filled by the first disabled row
+        if (_arranged && _disabled)
+        {
+          swap_rows(index, _size - _disabled - 1);
+          index = _size - _disabled - 1;
+        }
+      }
+    }
+
+    // Call the destructors if needed
+    (destroy<Components>(index), ...);
+
+    _sparse->release(_dense[index]);
+
+    if (index != --_size)
+    {
+      const auto back_entity = _dense[_size];
+
+      (*_sparse)[back_entity] = static_cast<entity_type>(index);
+      _dense[index] = back_entity;
+
+      // Moves the component data to the new location
+      ((at<Components>(index) = std::move(at<Components>(_size))), ...);
+
+      stamp(index, index + 1);
+
+      for (auto& dirty : _dirty) dirty.assign(index, dirty.test(_size));
+
+      if constexpr (enableable) _enabled.assign(index, _enabled.test(_size));
+    }
+  }
+
+  /**
+   * @brief Swaps two rows of the storage, including the entities and all their components.
+   * 
+   * @param first Index of first row to swap
+   * @param second Index of the second row to swap
+   */
+  void swap_rows(const size_type first, const size_type second)
+  {
+    if (first == second) return;
+
+    const auto first_entity = _dense[first];
+    const auto second_entity = _dense[second];
+
+    _dense[first] = second_entity;
+    _dense[second] = first_entity;
+
+    (*_sparse)[first_entity] = static_cast<entity_type>(second);
+    (*_sparse)[second_entity] = static_cast<entity_type>(first);
+
+    using std::swap;
+    (swap(at<Components>(first), at<Components>(second)), ...);
+
+    stamp(first, first + 1);
+    stamp(second, second + 1);
+
+    for (auto& dirty : _dirty)
+    {
+      const bool first_dirty = dirty.test(first);
+
+      dirty.assign(first, dirty.test(second));
+      dirty.assign(second, first_dirty);
+    }
+
+    if constexpr (enableable)
+    {
+      const bool first_enabled = _enabled.test(first);
+
+      _enabled.assign(first, _enabled.test(second));
+      _enabled.assign(second, first_enabled);
+    }
+  }
+
+  /**
+   * @brief Moves a row from a group to another by swapping it with one row of every group in between.
+   * 
+   * Moving to the group after the last one moves the row to the back of the storage.
+   * 
+   * @param index Index of the row
+   * @param from Current group of the row
+   * @param to Group to move the row to
+   */
+  void move_to_group(size_type index, size_type from, const size_type to)
+  {
+    // Swap with the last row of the group, then give the row to the next group
+    for (; from < to; ++from)
+    {
+      swap_rows(index, _groups[from + 1] - 1);
+      index = --_groups[from + 1];
+    }
+
+    // Swap with the first row of the group, then give the row to the previous group
+    for (; from > to; --from)
+    {
+      swap_rows(index, _groups[from]);
+      index = _groups[from]++;
+    }
+  }
+
+  /**
+   * @brief Computes the group of a row from its group component.
+   * 
+   * @param index Index of the row
+   * @return size_type Group of the row
+   */
+  size_type group_of(const size_type index)
+  {
+    using group_component = typename traits_type::group_component;
+
+    const size_type group = static_cast<size_type>(traits_type::group(at<group_component>(index)));
+
+    assert(group < groups && "Invalid group");
+
+    return group;
+  }
+
+  /**
+   * @brief Computes the rows in increasing order of an integral key with a least significant digit radix sort.
+   * 
+   * Keys are paired with their row so that every pass streams through a single array.
+   * 
+   * @tparam Key Key function type
+   * @param key Key function invoked with an iterator for every entity
+   * @param order Array of size rows where the rows are written in order
+   */
+  template<typename Key>
+  void radix_order(const Key& key, size_type* const order)
+  {
+    using key_type = std::decay_t<decltype(key(std::declval<iterator>()))>;
+    using unsigned_type = std::make_unsigned_t<key_type>;
+
+    struct keyed
+    {
+      unsigned_type key;
+      size_type row;
+    };
+
+    keyed* items = static_cast<keyed*>(std::malloc(_size * sizeof(keyed)));
+    keyed* buffer = static_cast<keyed*>(std::malloc(_size * sizeof(keyed)));
+
+    // Flipping the sign bit orders signed keys like unsigned ones
+    constexpr unsigned_type flip = std::is_signed_v<key_type> ? unsigned_type(unsigned_type { 1 } << (sizeof(key_type) * 8 - 1)) : 0;
+
+    // Rows are iterated from the back
+    for (size_type i = 0; i < _size; i++)
+    {
+      const size_type row = _size - 1 - i;
+
+      items[i] = { static_cast<unsigned_type>(static_cast<unsigned_type>(key(iterator { this, row })) ^ flip), row };
+    }
+
+    for (size_type shift = 0; shift < sizeof(key_type) * 8; shift += 8)
+    {
+      size_type offsets[257] = {};
+
+      for (size_type i = 0; i < _size; i++) ++offsets[((items[i].key >> shift) & 0xFF) + 1];
+
+      // Every key has the same byte, the pass would not change anything
+      if (offsets[((items[0].key >> shift) & 0xFF) + 1] == _size) continue;
+
+      for (size_type i = 0; i < 256; i++) offsets[i + 1] += offsets[i];
+
+      for (size_type i = 0; i < _size; i++) buffer[offsets[(items[i].key >> shift) & 0xFF]++] = items[i];
+
+      std::swap(items, buffer);
+    }
+
+    for (size_type i = 0; i < _size; i++) order[i] = items[i].row;
+
+    std::free(items);
+    std::free(buffer);
+  }
+
+  /**
+   * @brief Moves every row to its position in a permutation.
+   * 
+   * Rows are moved by following the cycles of the permutation, every row is moved once with one temporary
+   * per cycle and rows already in place are not moved. The sparse_array is then fixed in a single pass.
+   * 
+   * @param order Row moved to every index, overwritten
+   */
+  void permute(size_type* const order)
+  {
+    for (size_type start = 0; start < _size; start++)
+    {
+      if (order[start] == start) continue;
+
+      const entity_type entity = _dense[start];
+
+      bool enabled = true;
+
+      if constexpr (enableable) enabled = _enabled.test(start);
+
+      std::array<bool, size_v<dirty_list_type>> dirty_bits;
+
+      for (size_type d = 0; d < dirty_bits.size(); d++) dirty_bits[d] = _dirty[d].test(start);
+
+      std::tuple<Components...> temp { std::move(at<Components>(start))... };
+
+      size_type current = start;
+
+      while (order[current] != start)
+      {
+        const size_type next = order[current];
+
+        _dense[current] = _dense[next];
+        ((at<Components>(current) = std::move(at<Components>(next))), ...);
+
+        if constexpr (enableable) _enabled.assign(current, _enabled.test(next));
+
+        for (auto& dirty : _dirty) dirty.assign(current, dirty.test(next));
+
+        stamp(current, current + 1);
+
+        order[current] = current;
+        current = next;
+      }
+
+      _dense[current] = entity;
+      ((at<Components>(current) = std::move(std::get<Components>(temp))), ...);
+
+      stamp(current, current + 1);
+
+      if constexpr (enableable) _enabled.assign(current, enabled);
+
+      for (size_type d = 0; d < dirty_bits.size(); d++) _dirty[d].assign(current, dirty_bits[d]);
+
+      order[current] = current;
+    }
+
+    for (size_type i = 0; i < _size; i++) (*_sparse)[_dense[i]] = static_cast<entity_type>(i);
+  }
 
   /**
-   * @brief Construct a new storage object
+   * @brief Restores the ordering of the rows after operations that move rows around.
+   * 
+   * In compact mode, moves every disabled entity after the enabled ones. For grouped storages,
+   * sorts the rows by group in place.
    */
-  storage()
-    : _dense(NULL), _size(0), _capacity(0)
+  void arrange()
   {
-    // Uses new, but normally when using shared sparse arrays it will be allocated on the stack
-    _sparse = new sparse_array<entity_type>();
+    if constexpr (grouped) arrange_groups();
+    else if constexpr (compact_disabled)
+      arrange_disabled();
 
-    // Allocate nothing by default
-    ((access<Components>() = NULL), ...);
+    _arranged = true;
   }
 
   /**
-   * @brief Destroy the storage object
+   * @brief Sorts the rows by group in place.
+   * 
+   * Counts the entities of every group, then swaps every row directly into its group.
    */
-  ~storage()
+  void arrange_groups()
   {
-    // We only manage our sparse_array memory if its not shared
-    if (_sparse->shared()) _sparse->unshare();
-    else
-      delete _sparse;
+    _groups.fill(0);
 
-    // We assume that if dense is NULL, the other arrays are NULL since
-    // they grow together.
-    if (_dense)
+    for (size_type i = 0; i < _size; i++) ++_groups[group_of(i) + 1];
+    for (size_type i = 0; i < groups; i++) _groups[i + 1] += _groups[i];
+
+    group_array_type next = _groups;
+
+    for (size_type group = 0; group < groups; group++)
     {
-      free(_dense);
-      (deallocate<Components>(), ...);
+      while (next[group] < _groups[group + 1])
+      {
+        const size_type target = group_of(next[group]);
+
+        if (target == group) ++next[group];
+        else
+          swap_rows(next[group], next[target]++);
+      }
     }
   }
 
-  storage(const storage&) = delete;
-  storage(storage&&) = delete;
-  storage& operator=(const storage&) = delete;
-  storage& operator=(storage&&) = delete;
-
   /**
-   * @brief Inserts a entity and all its components at once.
-   * 
-   * Entities are always inserted in the back of the array, however they are not
-   * guarented to stay there, and can be moved around by other operations.
-   * 
-   * You can directly add the components with this method. However, components will be copied. 
-   * This is not nessesary and can be done later very efficiently using the unpack method. 
-   * Also, the order of the components dont matter, as long as they are all unique and part of the archetype.
-   * 
-   * This operation is usually O(1) and is pretty cheap. Some insert operations may be slower
-   * if any internal array need a resize.
-   * 
-   * @warning Undefined behaviour if the entity already exists. If you dont know
-   * if the entity exists, call the contains method first.
-   * 
-   * @tparam IncludedComponents Types of components to insert with (optional).
-   * @param entity Entity to insert
-   * @param components Components to insert alongside entity
+   * @brief Moves every disabled entity after the enabled ones.
    */
-  template<typename... IncludedComponents>
-  void insert(const entity_type entity, const IncludedComponents&... components)
+  void arrange_disabled()
   {
-    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
-      "One or more included components do not belong to the archetype");
-    static_assert(unique_types_v<IncludedComponents...>,
-      "Included components are not unique");
-
-    if (_size == _capacity) grow();
-    _sparse->assure(entity);
-
-    _dense[_size] = entity;
+    size_type first = 0;
+    size_type last = _size;
 
-    // Call the constructors if needed
-    (construct<Components>(_size), ...);
+    while (true)
+    {
+      while (first != last && _enabled.test(first)) ++first;
 
-    ((access<IncludedComponents>()[_size] = components), ...);
+      do
+      {
+        if (first == last) return;
+      } while (!_enabled.test(--last));
 
-    (*_sparse)[entity] = static_cast<entity_type>(_size++);
+      swap_rows(first++, last);
+    }
   }
 
   /**
-   * @brief Erases an entity from the storage.
-   * 
-   * Erasing entities is essentially just poping an entity from the back of the array and moving
-   * it to the location of the entity to erase.
-   * 
-   * This is a very cheap O(1) operation.
+   * @brief Appends a range of entities from another storage to the back of this storage.
    * 
-   * @warning Undefined behaviour if the entity does not exist. If you dont know
-   * if the entity exists, call the contains method first.
+   * Used by transfer_back. The source entities are left as moved-from.
    * 
-   * @param entity Entity to erase
+   * @tparam Archetype Archetype of the source storage
+   * @tparam Tuple Tuple of included components type
+   * @param source Storage to append the entities from
+   * @param first Index of the first entity to append in the source
+   * @param count Amount of entities to append
+   * @param included Tuple of components to initialize with
    */
-  void erase(const entity_type entity)
+  template<typename Archetype, typename Tuple>
+  void receive(storage<Entity, Archetype>& source, const size_type first, const size_type count, const Tuple& included)
   {
-    const auto back_entity = _dense[--_size];
-    const auto index = (*_sparse)[entity];
+    reserve(_size + count);
 
-    (*_sparse)[back_entity] = index;
-    _dense[index] = back_entity;
+    for (size_type i = 0; i < count; i++)
+    {
+      const auto entity = source._dense[first + i];
 
-    // Call the destructors if needed
-    (destroy<Components>(index), ...);
+      _sparse->acquire(entity);
+
+      _dense[_size + i] = entity;
+      (*_sparse)[entity] = static_cast<entity_type>(_size + i);
+
+      if constexpr (enableable)
+      {
+        bool row_enabled = true;
+
+        if constexpr (storage<Entity, Archetype>::enableable) row_enabled = source._enabled.test(first + i);
 
-    // Moves the component data to the new location
-    ((access<Components>()[index] = std::move(access<Components>()[_size])), ...);
+        _enabled.assign(_size + i, row_enabled);
+
+        if (!row_enabled) ++_disabled;
+      }
+    }
+
+    // Appended entities may be enabled and after disabled ones
+    if constexpr (compact_disabled)
+      if (_disabled) _arranged = false;
+
+    // Appended entities must be regrouped
+    if constexpr (grouped)
+    {
+      _groups[groups] += count;
+      _arranged = false;
+    }
+
+    (receive_component<Components>(source, first, count, included), ...);
+
+    stamp(_size, _size + count);
+
+    for (size_type i = 0; i < count; i++)
+    {
+      for (auto& dirty : _dirty) dirty.set(_size + i);
+
+      ((inherit_dirty<Components>(_size + i, source, first + i)), ...);
+    }
+
+    _size += count;
   }
 
   /**
-   * @brief Returns whether or not an entity is present in the storage.
+   * @brief Appends a range of a component from another storage to the back of this storage.
    * 
-   * This operation is a very cheap O(1) operation.
+   * Uses a single memcpy for trivially copyable components present in both storages, unless one of them
+   * has stable addresses.
    * 
-   * @param entity Entity to check
-   * @return true If entity is present in storage, false otherwise
+   * @tparam Component Type of the component to append
+   * @tparam Archetype Archetype of the source storage
+   * @tparam Tuple Tuple of included components type
+   * @param source Storage to append the components from
+   * @param first Index of the first component to append in the source
+   * @param count Amount of components to append
+   * @param included Tuple of components to initialize with
    */
-  bool contains(const entity_type entity) const
+  template<typename Component, typename Archetype, typename Tuple>
+  void receive_component(storage<Entity, Archetype>& source, const size_type first, const size_type count, const Tuple& included)
   {
-    size_type index;
+    constexpr bool common = storage<Entity, Archetype>::template contains_component<Component>;
+    constexpr bool contiguous = !stable_addresses && !storage<Entity, Archetype>::stable_addresses;
 
-    // We must access the dense array here because our sparse arrays may be shared, therefor we need
-    // to make sure entity index is valid.
-    return entity < _sparse->capacity() && (index = (*_sparse)[entity]) < _size && _dense[index] == entity;
+    if constexpr (common && contiguous && std::is_trivially_copyable_v<Component>)
+    {
+      std::memcpy(static_cast<void*>(access<Component>() + _size), source.template access<Component>() + first, count * sizeof(Component));
+    }
+    else if constexpr (common)
+    {
+      for (size_type i = 0; i < count; i++)
+      {
+        construct<Component>(_size + i);
+        at<Component>(_size + i) = std::move(source.template at<Component>(first + i));
+      }
+    }
+    else
+    {
+      for (size_type i = 0; i < count; i++)
+      {
+        construct<Component>(_size + i);
+
+        if constexpr (contains_v<const Component&, Tuple>) at<Component>(_size + i) = std::get<const Component&>(included);
+        else if constexpr (std::is_trivially_constructible_v<Component>)
+          at<Component>(_size + i) = Component {};
+      }
+    }
   }
 
   /**
-   * @brief Returns a reference of the stored component for the specified entity and component type.
-   * 
-   * This operation simply optains the index of the entity and access the dense array that holds
-   * the component of requested type.
+   * @brief Moves a component coming from another storage into the specified index.
    * 
-   * Very cheap operation, however unpacking from the iterator doesn't require recalculating the index
-   * every time, so try to prioritize that (even if its a very cheap to find the index).
+   * Does nothing if the component is not part of the archetype.
    * 
-   * @tparam Component Type of component to unpack
-   * @param entity Entity to unpack component for
-   * @return Component& Reference to component belonging to the entity
+   * @tparam Component Type of the component to move
+   * @param index Index to move the component to
+   * @param component Component to move
    */
   template<typename Component>
-  Component& unpack(const entity_type entity)
+  void move_from(const size_type index, Component& component)
   {
-    static_assert(contains_v<Component, list<Components...>>,
-      "The component your trying to unpack does not belong to the archetype");
-
-    return access<Component>()[(*_sparse)[entity]];
+    if constexpr (contains_component<Component>)
+    {
+      at<Component>(index) = std::move(component);
+    }
+    else
+    {
+      (void)index; // Suppress unused warning
+      (void)component;
+    }
   }
 
   /**
-   * @brief Resizes every internal dense array to be as small as possible.
+   * @brief Gives a row the dirty bit of a component in a row of another storage.
    * 
-   * This is good to call every once in a while to optimize memory usage.
+   * Does nothing unless both storages keep dirty bits for the component.
    * 
-   * @note This does not resize the sparse_array
+   * @tparam Component Component of the dirty bit
+   * @tparam Archetype Archetype of the source storage
+   * @param index Index of the row in this storage
+   * @param source Storage to take the dirty bit from
+   * @param source_index Index of the row in the source storage
    */
-  void shrink_to_fit()
+  template<typename Component, typename Archetype>
+  void inherit_dirty(const size_type index, storage<Entity, Archetype>& source, const size_type source_index)
   {
-    if (_size != _capacity)
+    if constexpr (tracks_dirty<Component> && storage<Entity, Archetype>::template tracks_dirty<Component>)
     {
-      _capacity = _size;
-
-      _dense = static_cast<dense_type>(std::realloc(_dense, _capacity * sizeof(entity_type)));
-      (reallocate<Components>(), ...);
+      std::get<find_v<Component, dirty_list_type>>(_dirty).assign(index,
+        std::get<find_v<Component, typename storage<Entity, Archetype>::dirty_list_type>>(source._dirty).test(source_index));
+    }
+    else
+    {
+      (void)index; // Suppress unused warning
+      (void)source;
+      (void)source_index;
     }
   }
 
   /**
-   * @brief Binds the shared sparse_array to this storage.
-   * 
-   * Sharing sparse_arrays between storages that operate on entities distributed by the
-   * same entity_manager is recommended for performance and memory usage.
+   * @brief Stamps every component of a range of rows with the current version.
    * 
-   * @warning Attemping to share a sparse array while already containing entities
-   * will no nothing.
+   * Does nothing without change versions.
    * 
-   * @param sparse The sparse_array to share with this storage
+   * @param first Index of the first row
+   * @param last Index after the last row
    */
-  void share(sparse_type sparse)
+  void stamp(const size_type first, const size_type last)
   {
-    if (_size != 0) return;
+    if constexpr (change_versions)
+    {
+      if (first >= last) return;
 
-    if (_sparse->shared()) _sparse->unshare();
+      for (size_type block = first / version_block; block <= (last - 1) / version_block; block++)
+      {
+        for (size_type i = 0; i < sizeof...(Components); i++) _versions[version_at(block, i)] = *_clock;
+      }
+    }
     else
-      // If the sparse_array is not shared that means we current have the default sparse_array
-      // allocated at initialization and we must delete it.
-      delete _sparse;
-
-    _sparse = sparse;
-    sparse->share();
+    {
+      (void)first; // Suppress unused warning
+      (void)last;
+    }
   }
 
   /**
-   * @brief clears the entire storage
+   * @brief Returns the position of the change version of a component in a block.
    * 
-   * As cheap of an operation as you can get (sets size to zero).
+   * The versions of all the components of a block are next to each other.
+   * 
+   * @param block Block of rows
+   * @param component Index of the component in the archetype
+   * @return size_type Position in the versions array
    */
-  void clear() { _size = 0; }
+  static constexpr size_type version_at(const size_type block, const size_type component)
+  {
+    return block * sizeof...(Components) + component;
+  }
 
   /**
-   * @brief Returns an iterator of the first entity of the dense array.
+   * @brief Resizes the change versions to the blocks of the current capacity.
    * 
-   * If the storage is empty the begining with be equal to the end.
+   * The versions of new blocks are zero, the rows are stamped when inserted.
    * 
-   * @return iterator Dense array iterator begining
+   * @param previous Capacity before the resize
    */
-  iterator begin() { return { this, _size - 1 }; }
+  void resize_versions(const size_type previous)
+  {
+    const size_type blocks = (previous + version_block - 1) / version_block;
+    const size_type new_blocks = (_capacity + version_block - 1) / version_block;
+
+    _versions = static_cast<size_type*>(std::realloc(_versions, version_at(new_blocks, 0) * sizeof(size_type)));
+
+    if (new_blocks > blocks) std::memset(_versions + version_at(blocks, 0), 0, version_at(new_blocks - blocks, 0) * sizeof(size_type));
+  }
 
   /**
-   * @brief Returns an iterator at the last entity of the dense array.
+   * @brief Grows the sparse set allocated space.
    * 
-   * If the storage is empty the begining with be equal to the end.
+   * This grows the dense entity array and all the dense component arrays.
    * 
-   * @return iterator Dense array iterator end
+   * Growth is exponential with a small linear amount.
    */
-  iterator end() { return { this, static_cast<size_type>(-1) }; }
+  void grow()
+  {
+    const size_type previous = _capacity;
 
-  /**
-   * @brief Returns the amount of entites current held by the storage.
-   * 
-   * @return size_type Amount of entities currently in storage
-   */
-  [[nodiscard]] size_type size() const { return _size; }
+    // This is essentially _capacity * 1.5 + 8
+    // Note: Must try to find optimal growth rate for better reallocation
+    _capacity = paged_capacity((_capacity * 3) / 2 + 8);
+
+    // Grow all arrays together
+    _dense = resize_array(_dense, previous);
+    (reallocate<Components>(previous), ...);
+
+    if constexpr (enableable) _enabled.resize(_capacity);
+    if constexpr (deferred_erase) _tombstones.resize(_capacity);
+    if constexpr (change_versions) resize_versions(previous);
+    for (auto& dirty : _dirty) dirty.resize(_capacity);
+  }
 
   /**
-   * @brief Returns the current entity capacity of the storage.
+   * @brief Rounds a capacity up to a whole amount of pages if the storage has stable addresses.
    * 
-   * If this is equal to the size, the next insert operation if no entites
-   * are removed will result in a resize of all internal dense arrays.
-   * 
-   * @return size_type Current capacity of entities in storage
+   * @param capacity Capacity to round
+   * @return size_type Capacity that the dense arrays can have
    */
-  [[nodiscard]] size_type capacity() const { return _capacity; }
+  static constexpr size_type paged_capacity(const size_type capacity)
+  {
+    if constexpr (stable_addresses) return (capacity + column_page_size - 1) & ~(column_page_size - 1);
+    else
+      return capacity;
+  }
 
   /**
-   * @brief Returns whether or not the storage is empty.
+   * @brief Resizes an array from the previous capacity to the current capacity.
    * 
-   * The storage is empty when there are not entities currently being
-   * stored in it.
+   * Uses realloc under the hood, or huge_realloc if the storage is backed by huge pages.
    * 
-   * @return true If the storage is empty, false otherwise
+   * @tparam Type Type of the elements of the array
+   * @param array Array to resize, can be NULL
+   * @param previous Capacity before the resize
+   * @return Type* Resized array
    */
-  [[nodiscard]] bool empty() const { return _size == 0; }
+  template<typename Type>
+  Type* resize_array(Type* array, const size_type previous) const
+  {
+    if constexpr (huge_pages)
+    {
+      return static_cast<Type*>(huge_realloc(array, previous * sizeof(Type), _capacity * sizeof(Type)));
+    }
+    else
+    {
+      (void)previous; // Suppress unused warning
+      return static_cast<Type*>(std::realloc(array, _capacity * sizeof(Type)));
+    }
+  }
 
-private:
   /**
-   * @brief Grows the sparse set allocated space.
-   * 
-   * This grows the dense entity array and all the dense component arrays.
+   * @brief Frees an array allocated with resize_array.
    * 
-   * Growth is exponential with a small linear amount.
+   * @param array Array to free
    */
-  void grow()
+  static void free_array(void* array)
   {
-    // This is essentially _capacity * 1.5 + 8
-    // Note: Must try to find optimal growth rate for better reallocation
-    _capacity = (_capacity * 3) / 2 + 8;
-
-    // Grow all arrays together
-    _dense = static_cast<dense_type>(std::realloc(_dense, _capacity * sizeof(entity_type)));
-    (reallocate<Components>(), ...);
+    if constexpr (huge_pages) huge_free(array);
+    else
+      free(array);
   }
 
   /**
    * @brief Deallocates the dense array for the specified component type.
    * 
    * Uses free under the hood. If the destructor is not trivial, it will call it 
-   * explicitly.
+   * explicitly on every live row.
    * 
    * @tparam Component The component type of the dense array to deallocate.
    */
@@ -454,11 +2812,20 @@ private:
     {
       for (size_t i = 0; i < _size; i++)
       {
-        access<Component>()[i].~Component();
+        // The components of dead rows were already destroyed
+        if constexpr (deferred_erase)
+          if (_tombstones.test(i)) continue;
+
+        at<Component>(i).~Component();
       }
     }
 
-    free(access<Component>());
+    if constexpr (stable_addresses)
+    {
+      for (size_type i = 0; i < _capacity / column_page_size; i++) free(access<Component>()[i]);
+    }
+
+    free_array(access<Component>());
   }
 
   /**
@@ -470,22 +2837,49 @@ private:
    * @note If the array is NULL, behaviour will be the same as malloc.
    * 
    * @tparam Component The component type of the dense array to resize.
+   * @param previous Capacity before the resize
    */
   template<typename Component>
-  void reallocate()
+  void reallocate(const size_type previous)
   {
-    if(std::is_trivially_copyable_v<Component> || std::is_trivially_move_assignable_v<Component>)
+    if constexpr (stable_addresses)
+    {
+      // Only the table of pages is resized, the pages themselves never move
+      const size_type before = previous / column_page_size;
+      const size_type after = _capacity / column_page_size;
+
+      for (size_type i = after; i < before; i++) free(access<Component>()[i]);
+
+      if (after == 0)
+      {
+        free(access<Component>());
+        access<Component>() = NULL;
+        return;
+      }
+
+      access<Component>() = static_cast<Component**>(std::realloc(access<Component>(), after * sizeof(Component*)));
+
+      for (size_type i = before; i < after; i++)
+      {
+        access<Component>()[i] = static_cast<Component*>(std::malloc(column_page_size * sizeof(Component)));
+      }
+    }
+    else if(std::is_trivially_copyable_v<Component> || std::is_trivially_move_assignable_v<Component>)
     {
-      access<Component>() = static_cast<Component*>(std::realloc(access<Component>(), _capacity * sizeof(Component)));
+      access<Component>() = resize_array(access<Component>(), previous);
     }
     else
     {
       Component* old_array = access<Component>();
 
-      Component* new_array = static_cast<Component*>(std::malloc(_capacity * sizeof(Component)));
+      Component* new_array = resize_array(static_cast<Component*>(NULL), 0);
 
       for(size_t i = 0; i < _size; i++)
       {
+        // The components of dead rows were already destroyed
+        if constexpr (deferred_erase)
+          if (_tombstones.test(i)) continue;
+
         if constexpr (!std::is_trivially_constructible_v<Component>)
         {
           new (new_array + i) Component(); 
@@ -496,7 +2890,7 @@ private:
         old_array[i].~Component();
       }
 
-      free(old_array);
+      free_array(old_array);
 
       access<Component>() = new_array;
     }
@@ -515,7 +2909,7 @@ private:
   {
     if constexpr (!std::is_trivially_constructible_v<Component>)
     {
-      new (access<Component>() + index) Component(); // Default constructor
+      new (&at<Component>(index)) Component(); // Default constructor
     }
     else
       (void)index; // Suppress unused warning
@@ -534,7 +2928,7 @@ private:
   {
     if constexpr (!std::is_trivially_destructible_v<Component>)
     {
-      access<Component>()[index].~Component();
+      at<Component>(index).~Component();
     }
     else
       (void)index; // Suppress unused warning
@@ -546,15 +2940,30 @@ private:
    * @note Uses the tuple std::get method.
    * 
    * @tparam Component Type of component to access dense array for.
-   * @return Component*& Dense array of component
+   * @return column_type<Component>& Dense array of component, or its table of pages with stable addresses
    */
   template<typename Component>
-  Component*& access()
+  column_type<Component>& access()
   {
     static_assert(contains_v<Component, list<Components...>>,
       "The component type your trying to access does not belong to the archetype");
 
-    return std::get<Component*>(_pool);
+    return std::get<column_type<Component>>(_pool);
+  }
+
+  /**
+   * @brief Accesses the component of the specified type at a row.
+   * 
+   * @tparam Component Type of component to access
+   * @param index Index of the row
+   * @return Component& Component at the row
+   */
+  template<typename Component>
+  Component& at(const size_type index)
+  {
+    if constexpr (stable_addresses) return access<Component>()[index / column_page_size][index % column_page_size];
+    else
+      return access<Component>()[index];
   }
 
 private:
@@ -564,6 +2973,23 @@ private:
 
   size_type _size;
   size_type _capacity;
+
+  group_array_type _groups;
+
+  bitset _enabled;
+  size_type _disabled;
+
+  bitset _tombstones;
+  size_type _dead;
+  size_type _free;
+  size_type _sorted;
+
+  bool _arranged;
+
+  size_type* _versions;
+  const size_type* _clock;
+
+  dirty_array_type _dirty;
 };
 
 template<typename Entity, typename... Components>
@@ -620,7 +3046,7 @@ public:
   template<typename Component>
   [[nodiscard]] const Component& unpack() const
   {
-    return _ptr->access<Component>()[_pos];
+    return _ptr->template at<Component>(_pos);
   }
 
   /*! @copydoc unpack */
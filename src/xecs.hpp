@@ -1,4 +1,11 @@
 #include "archetype.hpp"
+#include "bitset.hpp"
+#include "command_buffer.hpp"
+#include "concurrent_entity_manager.hpp"
+#include "entity.hpp"
 #include "entity_manager.hpp"
+#include "memory.hpp"
+#include "observer.hpp"
+#include "query.hpp"
 #include "registry.hpp"
 #include "storage.hpp"
\ No newline at end of file
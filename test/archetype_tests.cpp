@@ -118,4 +118,40 @@ static_assert(std::is_same_v<list<int>, find_for_t<list<list<float>, list<int>>,
 static_assert(std::is_same_v<list<int>, find_for_t<list<list<int, float>, list<int>>, int>>);
 static_assert(std::is_same_v<list<int, float>, find_for_t<list<list<int, float>, list<int>>, int, float>>);
 static_assert(std::is_same_v<list<int, float>, find_for_t<list<list<int, float>, list<int>>, float, int>>);
+
+static_assert(std::is_same_v<list<>, remove_t<int, list<>>>);
+static_assert(std::is_same_v<list<>, remove_t<int, list<int>>>);
+static_assert(std::is_same_v<list<float>, remove_t<int, list<float>>>);
+static_assert(std::is_same_v<list<float, bool>, remove_t<int, list<float, int, bool>>>);
+
+static_assert(contains_same_v<list<list<>>, list<>> == true);
+static_assert(contains_same_v<list<list<int>>, list<>> == false);
+static_assert(contains_same_v<list<list<int>, list<float, int>>, list<int, float>> == true);
+static_assert(contains_same_v<list<list<int>, list<float, int>>, list<int, bool>> == false);
+
+static_assert(std::is_same_v<list<float, int>, find_same_t<list<list<int>, list<float, int>>, list<int, float>>>);
+
+static_assert(std::is_same_v<list<>, prune_for_add_t<int, list<list<int>>>>);
+static_assert(std::is_same_v<list<list<>>, prune_for_add_t<int, list<list<>, list<int>>>>);
+static_assert(std::is_same_v<list<list<float>>, prune_for_add_t<int, list<list<float>, list<bool>, list<int, float>>>>);
+static_assert(std::is_same_v<list<list<float>, list<bool>>, prune_for_add_t<int, list<list<float>, list<bool>, list<int, float>, list<bool, int>>>>);
+
+static_assert(std::is_same_v<list<>, prune_for_remove_t<int, list<list<int>>>>);
+static_assert(std::is_same_v<list<list<int>>, prune_for_remove_t<int, list<list<>, list<int>>>>);
+static_assert(std::is_same_v<list<list<int, float>>, prune_for_remove_t<int, list<list<float>, list<bool>, list<int, float>>>>);
+static_assert(std::is_same_v<list<list<int, float>>, prune_for_remove_t<int, list<list<float>, list<int, float>, list<bool, int>>>>);
+
+static_assert(std::is_same_v<list<>, filter_t<std::is_integral, list<>>>);
+static_assert(std::is_same_v<list<int, bool>, filter_t<std::is_integral, list<int, float, bool>>>);
+static_assert(std::is_same_v<list<float>, filter_t<std::is_floating_point, list<int, float, bool>>>);
+
+static_assert(std::is_same_v<list<>, difference_t<list<>, list<int>>>);
+static_assert(std::is_same_v<list<float>, difference_t<list<int, float>, list<int>>>);
+static_assert(std::is_same_v<list<int, float>, difference_t<list<int, float>, list<bool>>>);
+
+static_assert(std::is_same_v<list<>, intersection_t<list<>, list<int>>>);
+static_assert(std::is_same_v<list<int>, intersection_t<list<int, float>, list<int>>>);
+static_assert(std::is_same_v<list<>, intersection_t<list<int, float>, list<bool>>>);
+
+static_assert(std::is_same_v<list<list<int, float>>, prune_for_list_t<list<list<int>, list<int, float>>, list<float>>>);
 } // namespace xecs
\ No newline at end of file
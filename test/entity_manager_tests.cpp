@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <concurrent_entity_manager.hpp>
 #include <entity_manager.hpp>
 #include <gtest/gtest.h>
+#include <thread>
 #include <vector>
 
 using namespace xecs;
 
+static_assert(entity_traits<unsigned int>::index(42u) == 42u);
+static_assert(entity_traits<versioned<uint32_t, 12>>::index_bits == 20);
+static_assert(entity_traits<versioned<uint32_t, 12>>::index((3u << 20) | 7u) == 7u);
+static_assert(entity_traits<versioned<uint32_t, 12>>::version((3u << 20) | 7u) == 3u);
+static_assert(entity_traits<versioned<uint32_t, 12>>::next_version((3u << 20) | 7u) == ((4u << 20) | 7u));
+static_assert(entity_traits<versioned<uint8_t, 2>>::next_version(uint8_t { 0xFF }) == uint8_t { 0x3F });
+
 TEST(EntityManager, Peek_AfterInitialization_Zero)
 {
   using entity_type = unsigned int;
@@ -532,4 +542,503 @@ TEST(EntityManager, ShrinkToFit_MemoryOverhead)
   manager.shrink_to_fit();
 
   ASSERT_EQ(manager.heap_capacity(), manager.minimum_heap_capacity + 1);
-}
\ No newline at end of file
+}
+
+TEST(EntityManager, Release_Versioned_NextVersionGenerated)
+{
+  using entity_type = versioned<uint32_t, 12>;
+  using entity_manager_type = entity_manager<entity_type>;
+  using traits_type = entity_traits<entity_type>;
+
+  entity_manager_type manager;
+
+  auto first = manager.generate();
+  auto second = manager.generate();
+
+  ASSERT_TRUE(manager.valid(first));
+  ASSERT_TRUE(manager.valid(second));
+
+  manager.release(first);
+
+  ASSERT_FALSE(manager.valid(first));
+  ASSERT_TRUE(manager.valid(second));
+
+  auto recycled = manager.generate();
+
+  ASSERT_EQ(traits_type::index(recycled), traits_type::index(first));
+  ASSERT_EQ(traits_type::version(recycled), 1);
+  ASSERT_TRUE(manager.valid(recycled));
+  ASSERT_FALSE(manager.valid(first));
+}
+
+TEST(EntityManager, ReleaseAll_Versioned_StaleInvalid)
+{
+  using entity_type = versioned<uint32_t, 12>;
+  using entity_manager_type = entity_manager<entity_type>;
+  using traits_type = entity_traits<entity_type>;
+
+  entity_manager_type manager;
+
+  std::vector<uint32_t> entities;
+
+  for (size_t i = 0; i < 1000; i++) entities.push_back(manager.generate());
+
+  manager.release_all();
+
+  for (auto entity : entities) ASSERT_FALSE(manager.valid(entity));
+
+  auto entity = manager.generate();
+
+  ASSERT_EQ(traits_type::index(entity), 0);
+  ASSERT_EQ(traits_type::version(entity), 1);
+  ASSERT_TRUE(manager.valid(entity));
+}
+
+TEST(ConcurrentEntityManager, Generate_MultipleThreads_Unique)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = concurrent_entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  const size_t thread_count = 4;
+  const size_t amount = 10000;
+
+  std::vector<std::vector<entity_type>> generated(thread_count);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < thread_count; t++)
+  {
+    threads.emplace_back([&manager, &generated, t, amount]()
+      {
+        auto cache = manager.local();
+
+        for (size_t i = 0; i < amount; i++)
+        {
+          generated[t].push_back(cache.generate());
+
+          // Release half of them to churn through the global pool
+          if (i % 2 == 0) cache.release(generated[t].back()), generated[t].pop_back();
+        }
+      });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  std::vector<entity_type> all;
+
+  for (auto& entities : generated) all.insert(all.end(), entities.begin(), entities.end());
+
+  std::sort(all.begin(), all.end());
+
+  ASSERT_EQ(all.size(), thread_count * amount / 2);
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
+TEST(ConcurrentEntityManager, Release_OtherThread_Recycled)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = concurrent_entity_manager<entity_type, 16>;
+
+  entity_manager_type manager;
+
+  std::vector<entity_type> entities;
+
+  for (size_t i = 0; i < 100; i++) entities.push_back(manager.generate());
+
+  std::thread worker([&manager, &entities]()
+    {
+      auto cache = manager.local();
+
+      for (auto entity : entities) cache.release(entity);
+    });
+
+  worker.join();
+
+  // Fresh entities are obtained a batch at a time
+  auto peek = manager.peek();
+
+  ASSERT_EQ(peek, 112);
+
+  // The released entities come back from the global pool
+  for (size_t i = 0; i < peek; i++)
+  {
+    ASSERT_LT(manager.generate(), peek);
+  }
+
+  ASSERT_EQ(manager.peek(), peek);
+}
+
+TEST(ConcurrentEntityManager, Reserve_MultipleThreads_Unique)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = concurrent_entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  std::vector<entity_type> first(1000);
+  std::vector<entity_type> second(1000);
+
+  std::thread worker([&manager, &first]()
+    {
+      for (auto& entity : first) entity = manager.reserve();
+    });
+
+  for (auto& entity : second) entity = manager.reserve();
+
+  worker.join();
+
+  first.insert(first.end(), second.begin(), second.end());
+
+  std::sort(first.begin(), first.end());
+
+  ASSERT_TRUE(std::adjacent_find(first.begin(), first.end()) == first.end());
+  ASSERT_EQ(manager.peek(), 2000);
+}
+
+TEST(EntityManager, Generate_LowestRecycler_LowestFirst)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, lowest_recycler<entity_type>>;
+
+  entity_manager_type manager;
+
+  size_t amount = 100000;
+
+  for (size_t i = 0; i < amount; i++) manager.generate();
+
+  for (size_t i = 1; i < amount - 1; i += 7) manager.release(static_cast<entity_type>(i));
+
+  ASSERT_EQ(manager.reusable(), (amount - 2 + 6) / 7);
+
+  for (size_t i = 1; i < amount - 1; i += 7)
+  {
+    ASSERT_EQ(manager.generate(), i);
+  }
+
+  ASSERT_EQ(manager.reusable(), 0);
+  ASSERT_EQ(manager.generate(), amount);
+}
+
+TEST(EntityManager, Release_LowestRecyclerHighest_CounterDecreased)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, lowest_recycler<entity_type>>;
+
+  entity_manager_type manager;
+
+  for (size_t i = 0; i < 5000; i++) manager.generate();
+
+  // Released from the top, but not in order
+  for (entity_type i = 4000; i < 5000; i += 2) manager.release(i);
+
+  ASSERT_EQ(manager.peek(), 5000);
+
+  for (entity_type i = 4001; i < 5000; i += 2) manager.release(i);
+
+  ASSERT_EQ(manager.peek(), 4000);
+  ASSERT_EQ(manager.reusable(), 0);
+
+  manager.release(10);
+
+  ASSERT_EQ(manager.peek(), 4000);
+  ASSERT_EQ(manager.generate(), 10);
+  ASSERT_EQ(manager.generate(), 4000);
+}
+
+TEST(EntityManager, Release_LowestRecyclerVersioned_NextVersionGenerated)
+{
+  using entity_type = versioned<uint32_t, 8>;
+  using entity_manager_type = entity_manager<entity_type, lowest_recycler<entity_type>>;
+  using traits_type = entity_traits<entity_type>;
+
+  entity_manager_type manager;
+
+  auto first = manager.generate();
+  auto second = manager.generate();
+
+  manager.release(second);
+  manager.release(first);
+
+  ASSERT_EQ(manager.peek(), 0);
+
+  auto recycled = manager.generate();
+
+  ASSERT_EQ(traits_type::index(recycled), 0);
+  ASSERT_EQ(traits_type::version(recycled), 1);
+  ASSERT_FALSE(manager.valid(first));
+  ASSERT_TRUE(manager.valid(recycled));
+}
+
+TEST(EntityManager, Release_HeapRecycler_LazilyAllocated)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, heap_recycler<entity_type>>;
+
+  static_assert(sizeof(entity_manager_type) < 128);
+
+  entity_manager_type manager;
+
+  for (size_t i = 0; i < 1000; i++) manager.generate();
+
+  ASSERT_EQ(manager.heap_capacity(), 0);
+
+  for (entity_type i = 0; i < 1000; i++) manager.release(i);
+
+  ASSERT_EQ(manager.reusable(), 1000);
+  ASSERT_GE(manager.heap_capacity(), 1000);
+
+  for (entity_type i = 1000; i-- > 0;)
+  {
+    ASSERT_EQ(manager.generate(), i);
+  }
+
+  manager.shrink_to_fit();
+
+  ASSERT_EQ(manager.heap_capacity(), 0);
+  ASSERT_EQ(manager.generate(), 1000);
+}
+
+TEST(EntityManager, Release_SmallStackRecycler_OverflowsToHeap)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, stack_recycler<entity_type, 32>>;
+
+  static_assert(entity_manager_type::stack_capacity == 32);
+  static_assert(sizeof(entity_manager_type) < 256);
+
+  entity_manager_type manager;
+
+  for (size_t i = 0; i < 100; i++) manager.generate();
+
+  for (entity_type i = 0; i < 100; i++) manager.release(i);
+
+  ASSERT_EQ(manager.stack_reusable(), 32);
+  ASSERT_EQ(manager.heap_reusable(), 68);
+
+  for (entity_type i = 32; i-- > 0;)
+  {
+    ASSERT_EQ(manager.generate(), i);
+  }
+
+  ASSERT_EQ(manager.generate(), 99);
+}
+
+TEST(EntityManager, Release_NoRecycler_NeverReused)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using entity_manager_type = entity_manager<entity_type, no_recycler<entity_type>>;
+
+  entity_manager_type manager;
+
+  auto entity = manager.generate();
+
+  manager.release(entity);
+
+  ASSERT_EQ(manager.reusable(), 0);
+  ASSERT_FALSE(manager.valid(entity));
+  ASSERT_EQ(manager.generate(), 1);
+}
+
+TEST(EntityManager, GenerateFrom_ReservedRanges_Skipped)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  manager.generate();
+
+  auto first = manager.reserve_range(10, 5);
+  auto second = manager.reserve_range(15, 10);
+
+  ASSERT_EQ(manager.ranges(), 2);
+
+  for (entity_type i = 1; i < 10; i++)
+  {
+    ASSERT_EQ(manager.generate(), i);
+  }
+
+  ASSERT_EQ(manager.generate(), 25);
+  ASSERT_EQ(manager.generate_from(second), 15);
+  ASSERT_EQ(manager.generate_from(first), 10);
+  ASSERT_EQ(manager.generate_from(first), 11);
+
+  // Entities of reserved ranges are not recycled
+  manager.release(11);
+
+  ASSERT_EQ(manager.reusable(), 0);
+  ASSERT_EQ(manager.generate(), 26);
+
+  manager.release_all();
+
+  ASSERT_EQ(manager.generate_from(first), 10);
+}
+
+TEST(EntityManager, Acquire_VersionedReserved_Valid)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using traits_type = entity_traits<entity_type>;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  auto pool = manager.reserve_range(1000, 1000);
+
+  auto generated = manager.generate_from(pool);
+
+  ASSERT_EQ(generated, 1000);
+  ASSERT_TRUE(manager.valid(generated));
+
+  // Entity received from a peer with another version
+  const unsigned int received = traits_type::next_version(1500);
+
+  ASSERT_FALSE(manager.valid(received));
+
+  manager.acquire(received);
+
+  ASSERT_TRUE(manager.valid(received));
+
+  manager.release(received);
+
+  ASSERT_FALSE(manager.valid(received));
+  ASSERT_EQ(manager.generate(), 0);
+}
+
+TEST(EntityManager, GenerateFrom_BelowReservedRange_NeverGeneratedInvalid)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using traits_type = entity_traits<entity_type>;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  auto pool = manager.reserve_range(1 << 20, 10);
+
+  auto generated = manager.generate_from(pool);
+
+  ASSERT_TRUE(manager.valid(generated));
+  ASSERT_FALSE(manager.valid(0));
+  ASSERT_FALSE(manager.valid(5));
+  ASSERT_FALSE(manager.valid(1 << 19));
+  ASSERT_FALSE(manager.valid((1 << 20) + 1));
+
+  // Released slots stay vacant until their next version is generated
+  manager.release(generated);
+
+  ASSERT_FALSE(manager.valid(generated));
+  ASSERT_FALSE(manager.valid(traits_type::next_version(generated)));
+
+  auto next = manager.generate_from(pool);
+
+  ASSERT_EQ(next, (1 << 20) + 1);
+  ASSERT_TRUE(manager.valid(next));
+
+  auto entity = manager.generate();
+
+  ASSERT_EQ(entity, 0);
+  ASSERT_TRUE(manager.valid(entity));
+  ASSERT_FALSE(manager.valid(1));
+}
+
+TEST(EntityManager, GenerateBatch_RecycledThenCounter_Unique)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  size_t amount = manager.stack_capacity * 3;
+
+  std::vector<entity_type> entities(amount);
+
+  manager.generate(entities.data(), amount);
+
+  for (size_t i = 0; i < amount; i++)
+  {
+    ASSERT_EQ(entities[i], i);
+  }
+
+  // Overflows the stack memory stack into the heap memory stack
+  manager.release(entities.data(), amount);
+
+  ASSERT_EQ(manager.stack_reusable(), manager.stack_capacity);
+  ASSERT_EQ(manager.heap_reusable(), amount - manager.stack_capacity);
+
+  std::vector<entity_type> generated(amount + 10);
+
+  manager.generate(generated.data(), generated.size());
+
+  ASSERT_EQ(manager.reusable(), 0);
+  ASSERT_EQ(manager.peek(), amount + 10);
+
+  std::sort(generated.begin(), generated.end());
+
+  for (size_t i = 0; i < generated.size(); i++)
+  {
+    ASSERT_EQ(generated[i], i);
+  }
+}
+
+TEST(EntityManager, ReleaseBatch_Versioned_NextVersionGenerated)
+{
+  using entity_type = versioned<uint32_t, 12>;
+  using traits_type = entity_traits<entity_type>;
+  using entity_manager_type = entity_manager<entity_type, heap_recycler<entity_type>>;
+
+  entity_manager_type manager;
+
+  uint32_t entities[100];
+
+  manager.generate(entities, 100);
+  manager.release(entities, 50);
+
+  for (size_t i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(manager.valid(entities[i]), i >= 50);
+  }
+
+  uint32_t generated[60];
+
+  manager.generate(generated, 60);
+
+  for (size_t i = 0; i < 50; i++)
+  {
+    ASSERT_EQ(traits_type::version(generated[i]), 1);
+    ASSERT_TRUE(manager.valid(generated[i]));
+  }
+
+  for (size_t i = 50; i < 60; i++)
+  {
+    ASSERT_EQ(generated[i], 50 + i);
+  }
+}
+
+TEST(EntityManager, GenerateBatch_LowestRecyclerAcrossRange_Skipped)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, lowest_recycler<entity_type>>;
+
+  entity_manager_type manager;
+
+  manager.reserve_range(20, 10);
+
+  entity_type entities[30];
+
+  manager.generate(entities, 30);
+
+  ASSERT_EQ(entities[19], 19);
+  ASSERT_EQ(entities[20], 30);
+  ASSERT_EQ(entities[29], 39);
+
+  manager.release(entities + 5, 10);
+
+  entity_type generated[5];
+
+  manager.generate(generated, 5);
+
+  for (entity_type i = 0; i < 5; i++)
+  {
+    ASSERT_EQ(generated[i], 5 + i);
+  }
+}
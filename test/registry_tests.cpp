@@ -1,8 +1,170 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <command_buffer.hpp>
+#include <query.hpp>
 #include <registry.hpp>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace xecs;
 
+struct Enableable
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Enableable>> : default_storage_traits
+{
+  static constexpr bool enableable = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Enableable, float>> : default_storage_traits
+{
+  static constexpr bool compact_disabled = true;
+};
+
+struct Tombstoned
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Tombstoned>> : default_storage_traits
+{
+  static constexpr bool deferred_erase = true;
+};
+
+struct Anchored
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Anchored>> : default_storage_traits
+{
+  static constexpr bool stable_addresses = true;
+};
+
+struct Lockstep
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Lockstep>> : default_storage_traits
+{
+  static constexpr bool ordered = true;
+};
+
+struct Observed
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Observed>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Observed, float>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+};
+
+struct Transform
+{
+  float x;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Transform>> : default_storage_traits
+{
+  static constexpr size_t version_block = 128;
+};
+
+struct Moved
+{
+  int x;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Moved>> : default_storage_traits
+{
+  using dirty_components = list<Moved>;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Moved, float>> : default_storage_traits
+{
+  using dirty_components = list<Moved>;
+};
+
+struct Sampled
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Sampled>> : default_storage_traits
+{
+  static constexpr size_t version_block = 64;
+
+  using dirty_components = list<Sampled>;
+};
+
+struct Health
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Health>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+
+  using dirty_components = list<Health>;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Health, float>> : default_storage_traits
+{
+  static constexpr bool observed = true;
+
+  using dirty_components = list<Health>;
+};
+
+struct Pinned
+{
+  int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Pinned>> : default_storage_traits
+{
+  static constexpr bool stable_addresses = true;
+  static constexpr bool observed = true;
+};
+
+struct Team
+{
+  size_t id;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Team, int>> : default_storage_traits
+{
+  static constexpr size_t groups = 3;
+
+  using group_component = Team;
+
+  static size_t group(const Team& team) { return team.id; }
+};
+
 TEST(Registry, Storages_OneArchetype_OneStorages)
 {
   using entity_type = unsigned int;
@@ -615,3 +777,1481 @@ TEST(Registry, ForEach_MultipleTwoArchetypes_CorrectIterations)
 
   ASSERT_EQ(amount / 2, floatview);
 }
+
+TEST(Registry, Add_SingleComponent_Moved)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(5);
+
+  registry.add(entity, 0.5f);
+
+  ASSERT_EQ(registry.size(), 1);
+  ASSERT_EQ((registry.size<int, float>()), 1);
+  ASSERT_EQ(registry.unpack<int>(entity), 5);
+  ASSERT_EQ(registry.unpack<float>(entity), 0.5f);
+}
+
+TEST(Registry, Add_MultipleSources_CorrectTargets)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<double>>::
+        add<archetype<float, int>>::
+          add<archetype<double, float>>::
+            build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity1 = registry.create(5);
+  auto entity2 = registry.create(2.0);
+  auto entity3 = registry.create(6);
+
+  registry.add(entity2, 0.25f);
+  registry.add(entity1, 0.5f);
+
+  ASSERT_EQ(registry.size(), 3);
+  ASSERT_EQ((registry.size<int, float>()), 1);
+  ASSERT_EQ((registry.size<double, float>()), 1);
+  ASSERT_EQ(registry.unpack<int>(entity1), 5);
+  ASSERT_EQ(registry.unpack<float>(entity1), 0.5f);
+  ASSERT_EQ(registry.unpack<double>(entity2), 2.0);
+  ASSERT_EQ(registry.unpack<float>(entity2), 0.25f);
+  ASSERT_EQ(registry.unpack<int>(entity3), 6);
+}
+
+TEST(Registry, Remove_SingleComponent_Moved)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity1 = registry.create(5, 0.5f);
+  auto entity2 = registry.create(6, 0.25f);
+
+  registry.remove<float>(entity1);
+
+  ASSERT_EQ(registry.size(), 2);
+  ASSERT_EQ((registry.size<int, float>()), 1);
+  ASSERT_EQ(registry.unpack<int>(entity1), 5);
+  ASSERT_EQ(registry.unpack<int>(entity2), 6);
+  ASSERT_EQ(registry.unpack<float>(entity2), 0.25f);
+  ASSERT_FALSE(registry.has<float>(entity1));
+}
+
+TEST(Registry, Remove_LastComponent_EmptyArchetype)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<>>::
+      add<archetype<std::string>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(std::string { "Test" });
+
+  registry.remove<std::string>(entity);
+
+  ASSERT_EQ(registry.size(), 1);
+  ASSERT_EQ(registry.size<std::string>(), 0);
+
+  registry.add(entity, std::string { "Test1" });
+
+  ASSERT_EQ(registry.size<std::string>(), 1);
+  ASSERT_EQ(registry.unpack<std::string>(entity), "Test1");
+}
+
+TEST(Registry, MigrateIf_Half_Moved)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  int amount = 1000;
+
+  for (int i = 0; i < amount; i++)
+  {
+    registry.create(i);
+  }
+
+  auto migrated = registry.view<int>().migrate_if<int, float>([](auto, auto i)
+    { return i % 2 == 0; },
+    0.5f);
+
+  ASSERT_EQ(migrated, amount / 2);
+  ASSERT_EQ(registry.size(), amount);
+  ASSERT_EQ(registry.size<float>(), amount / 2);
+
+  registry.for_each<int, float>([](auto entity, auto i, auto f)
+    {
+      ASSERT_EQ(i % 2, 0);
+      ASSERT_EQ(static_cast<int>(entity), i);
+      ASSERT_EQ(f, 0.5f);
+    });
+
+  registry.for_each<int>([&registry](auto entity, auto i)
+    {
+      ASSERT_EQ(static_cast<int>(entity), i);
+      ASSERT_EQ(registry.has<float>(entity), i % 2 == 0);
+    });
+}
+
+TEST(Registry, Sort_ViewKey_ForEachInOrder)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  int amount = 1000;
+
+  for (int i = 0; i < amount; i++)
+  {
+    registry.create(amount - i, static_cast<float>(i % 7));
+  }
+
+  registry.view<float>().sort<int, float>([](auto, auto f)
+    { return f; });
+
+  float previous = 0.0f;
+
+  registry.for_each<int, float>([&previous](auto entity, auto i, auto f)
+    {
+      ASSERT_EQ(static_cast<int>(entity), 1000 - i);
+      ASSERT_GE(f, previous);
+      previous = f;
+    });
+
+  ASSERT_EQ(previous, 6.0f);
+}
+
+TEST(Registry, Migrate_Entities_Moved)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, double>>::
+        add<archetype<int, float>>::
+          build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100; i++)
+  {
+    if (i % 3 == 0) entities.push_back(registry.create(i, 1.0));
+    else
+      entities.push_back(registry.create(i));
+  }
+
+  std::vector<entity_type> to_migrate(entities.begin(), entities.begin() + 30);
+
+  registry.view<int>().migrate<int, float>(to_migrate.data(), to_migrate.size());
+
+  ASSERT_EQ(registry.size(), 100);
+  ASSERT_EQ(registry.size<float>(), 30);
+  ASSERT_EQ(registry.size<double>(), 34 - 10);
+
+  for (auto entity : to_migrate)
+  {
+    ASSERT_TRUE(registry.has<float>(entity));
+    ASSERT_EQ(registry.unpack<int>(entity), static_cast<int>(entity));
+    ASSERT_EQ(registry.unpack<float>(entity), 0.0f);
+  }
+
+  for (auto it = entities.begin() + 30; it != entities.end(); ++it)
+  {
+    ASSERT_FALSE(registry.has<float>(*it));
+    ASSERT_EQ(registry.unpack<int>(*it), static_cast<int>(*it));
+  }
+}
+
+TEST(RegistrySideComponents, Add_SideComponent_SameArchetype)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+  using side_components = list<float>;
+
+  registry<entity_type, registered_archetypes, side_components> registry;
+
+  auto entity1 = registry.create(5);
+  auto entity2 = registry.create(6);
+
+  registry.add(entity1, 0.5f);
+
+  ASSERT_EQ(registry.size(), 2);
+  ASSERT_EQ(registry.size<int>(), 2);
+  ASSERT_EQ(registry.size<float>(), 1);
+  ASSERT_EQ((registry.size<int, float>()), 1);
+  ASSERT_TRUE(registry.has<float>(entity1));
+  ASSERT_FALSE(registry.has<float>(entity2));
+  ASSERT_EQ(registry.unpack<int>(entity1), 5);
+  ASSERT_EQ(registry.unpack<float>(entity1), 0.5f);
+
+  registry.remove<float>(entity1);
+
+  ASSERT_EQ(registry.size<float>(), 0);
+  ASSERT_FALSE(registry.has<float>(entity1));
+  ASSERT_EQ(registry.unpack<int>(entity1), 5);
+}
+
+TEST(RegistrySideComponents, ForEach_Intersection_CorrectIterations)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, double>>::
+        build;
+  using side_components = list<float, bool>;
+
+  registry<entity_type, registered_archetypes, side_components> registry;
+
+  int amount = 1000;
+
+  for (int i = 0; i < amount; i++)
+  {
+    auto entity = i % 2 == 0 ? registry.create(i) : registry.create(i, 1.0);
+
+    if (i % 3 == 0) registry.add(entity, static_cast<float>(i));
+    if (i % 5 == 0) registry.add(entity, true);
+  }
+
+  size_t count = 0;
+
+  registry.for_each<float, int>([&count](auto entity, auto f, auto i)
+    {
+      ASSERT_EQ(static_cast<int>(entity), i);
+      ASSERT_EQ(static_cast<float>(i), f);
+      ASSERT_EQ(i % 3, 0);
+      count++;
+    });
+
+  ASSERT_EQ(count, 334);
+
+  count = 0;
+
+  registry.for_each<double, bool, float>([&count](auto entity, auto, auto, auto)
+    {
+      ASSERT_EQ(entity % 2, 1);
+      ASSERT_EQ(entity % 15, 0);
+      count++;
+    });
+
+  ASSERT_EQ(count, 33);
+  ASSERT_EQ((registry.size<double, bool, float>()), 33);
+  ASSERT_EQ((registry.size<bool, float>()), 67);
+}
+
+TEST(RegistrySideComponents, Destroy_SideComponentErased)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+  using side_components = list<float>;
+
+  registry<entity_type, registered_archetypes, side_components> registry;
+
+  auto entity = registry.create(5);
+
+  registry.add(entity, 0.5f);
+  registry.destroy(entity);
+
+  ASSERT_TRUE(registry.empty());
+  ASSERT_TRUE(registry.empty<float>());
+
+  auto recycled = registry.create(6);
+
+  ASSERT_EQ(recycled, entity);
+  ASSERT_FALSE(registry.has<float>(recycled));
+}
+
+TEST(Registry, ForEach_Disabled_Skipped)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Enableable>>::
+      add<archetype<Enableable, float>>::
+        add<archetype<Enableable, double>>::
+          build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  int amount = 300;
+
+  for (int i = 0; i < amount; i++)
+  {
+    entity_type entity;
+
+    if (i % 3 == 0) entity = registry.create(Enableable { i });
+    else if (i % 3 == 1)
+      entity = registry.create(Enableable { i }, 0.5f);
+    else
+      entity = registry.create(Enableable { i }, 0.5);
+
+    if (i % 2 == 0 && i % 3 != 2) registry.disable(entity);
+  }
+
+  ASSERT_EQ(registry.size(), amount);
+
+  size_t count = 0;
+
+  registry.for_each<Enableable>([&count, &registry](auto entity, auto enableable)
+    {
+      ASSERT_EQ(static_cast<int>(entity), enableable.value);
+      ASSERT_TRUE(registry.enabled(entity));
+      count++;
+    });
+
+  ASSERT_EQ(count, 200);
+
+  ASSERT_FALSE(registry.enabled(0));
+  ASSERT_TRUE(registry.enabled(2));
+
+  // Transfering between enableable archetypes keeps the entity disabled
+  registry.add(0, 1.0f);
+
+  ASSERT_FALSE(registry.enabled(0));
+
+  registry.enable(0);
+
+  ASSERT_TRUE(registry.enabled(0));
+  ASSERT_EQ(registry.size<float>(), 101);
+}
+
+TEST(Registry, ForEachGroup_TwoArchetypes_OnlyGroup)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Team>>::
+      add<archetype<Team, int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  int amount = 300;
+
+  for (int i = 0; i < amount; i++)
+  {
+    if (i % 2 == 0) registry.create(Team { 0 });
+    else
+      registry.create(Team { static_cast<size_t>(i % 3) }, i);
+  }
+
+  size_t count = 0;
+
+  registry.for_each_group<Team>(1, [&count](auto entity, auto team)
+    {
+      ASSERT_EQ(team.id, 1);
+      ASSERT_EQ(entity % 2, 1);
+      count++;
+    });
+
+  ASSERT_EQ(count, 50);
+
+  registry.unpack<Team>(1).id = 2;
+  registry.regroup(1);
+  registry.regroup(0);
+
+  count = 0;
+
+  registry.for_each_group<Team, int>(2, [&count](auto, auto team, auto i)
+    {
+      ASSERT_EQ(team.id, 2);
+      ASSERT_TRUE(i % 3 == 2 || i == 1);
+      count++;
+    });
+
+  ASSERT_EQ(count, 51);
+}
+
+TEST(Registry, Valid_VersionedDestroyed_False)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(1);
+
+  ASSERT_TRUE(registry.valid(entity));
+
+  registry.destroy(entity);
+
+  ASSERT_FALSE(registry.valid(entity));
+
+  auto recycled = registry.create(2, 0.5f);
+
+  ASSERT_NE(recycled, entity);
+  ASSERT_FALSE(registry.valid(entity));
+  ASSERT_FALSE(registry.has(entity));
+  ASSERT_TRUE(registry.valid(recycled));
+  ASSERT_TRUE(registry.has<float>(recycled));
+  ASSERT_EQ(registry.unpack<int>(recycled), 2);
+}
+
+TEST(Registry, Emplace_ReservedOnThreads_Created)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes, list<>, concurrent_entity_manager<entity_type>> registry;
+
+  registry.create(-1);
+
+  std::vector<entity_type> reserved[2];
+  std::vector<std::thread> threads;
+
+  for (auto& entities : reserved)
+  {
+    threads.emplace_back([&registry, &entities]()
+      {
+        for (size_t i = 0; i < 500; i++) entities.push_back(registry.reserve());
+      });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  // Sync point
+  for (auto& entities : reserved)
+  {
+    for (auto entity : entities) registry.emplace(entity, static_cast<int>(entity));
+  }
+
+  ASSERT_EQ(registry.size(), 1001);
+
+  registry.for_each<int>([](auto entity, auto value)
+    {
+      if (value != -1)
+      {
+        ASSERT_EQ(static_cast<int>(entity), value);
+      }
+    });
+}
+
+TEST(Registry, CompactIds_AfterSpike_LowestIdentifiers)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+  using side_components = list<bool>;
+
+  registry<entity_type, registered_archetypes, side_components> registry;
+
+  std::vector<unsigned int> entities;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    entities.push_back(i % 2 ? registry.create(i) : registry.create(i, 0.5f));
+  }
+
+  // Keep every tenth entity
+  for (int i = 0; i < 1000; i++)
+  {
+    if (i % 10) registry.destroy(entities[i]);
+    else if (i % 20)
+      registry.add(entities[i], true);
+  }
+
+  std::vector<std::pair<unsigned int, unsigned int>> remaps;
+
+  registry.compact_ids([&remaps](auto old_entity, auto new_entity)
+    { remaps.emplace_back(old_entity, new_entity); });
+
+  ASSERT_EQ(remaps.size(), 100);
+  ASSERT_EQ(registry.size(), 100);
+  ASSERT_EQ(registry.size<bool>(), 50);
+
+  for (auto [old_entity, new_entity] : remaps)
+  {
+    const int value = static_cast<int>(std::find(entities.begin(), entities.end(), old_entity) - entities.begin());
+
+    ASSERT_LT(entity_traits<entity_type>::index(new_entity), 100);
+    ASSERT_FALSE(registry.valid(old_entity));
+    ASSERT_TRUE(registry.valid(new_entity));
+    ASSERT_EQ(registry.unpack<int>(new_entity), value);
+    ASSERT_EQ(registry.has<float>(new_entity), value % 2 == 0);
+    ASSERT_EQ(registry.has<bool>(new_entity), value % 20 != 0);
+  }
+
+  auto created = registry.create(-1);
+
+  ASSERT_EQ(entity_traits<entity_type>::index(created), 100);
+}
+
+TEST(Registry, CompactIds_StableArchetypeWithSideComponents_SideComponentsFollow)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Anchored>>::
+      build;
+  using side_components = list<bool>;
+
+  registry<entity_type, registered_archetypes, side_components> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 10; i++) entities.push_back(registry.create(Anchored { i }));
+
+  // Leaves dead rows in front of the survivors
+  for (int i = 0; i < 9; i++)
+  {
+    if (i != 7) registry.destroy(entities[i]);
+  }
+
+  registry.add(entities[7], true);
+
+  std::vector<std::pair<entity_type, entity_type>> remaps;
+
+  registry.compact_ids([&remaps](auto old_entity, auto new_entity)
+    { remaps.emplace_back(old_entity, new_entity); });
+
+  ASSERT_EQ(remaps.size(), 2);
+  ASSERT_EQ(registry.size<bool>(), 1);
+
+  for (auto [old_entity, new_entity] : remaps)
+  {
+    ASSERT_LT(new_entity, 2);
+    ASSERT_EQ(registry.unpack<Anchored>(new_entity).value, static_cast<int>(old_entity));
+    ASSERT_EQ(registry.has<bool>(new_entity), old_entity == entities[7]);
+  }
+}
+
+TEST(Registry, CreateWithId_ReservedRange_SameIdentifiers)
+{
+  using entity_type = versioned<unsigned int, 8>;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes> server;
+  registry<entity_type, registered_archetypes> client;
+
+  auto server_pool = server.manager().reserve_range(1 << 16, 1 << 8);
+  client.manager().reserve_range(1 << 16, 1 << 8);
+
+  auto local = client.create(-1);
+
+  for (int i = 0; i < 10; i++)
+  {
+    auto entity = server.manager().generate_from(server_pool);
+
+    server.create_with_id(entity, i);
+    client.create_with_id(entity, i);
+  }
+
+  ASSERT_EQ(client.size(), 11);
+  ASSERT_TRUE(client.valid(local));
+  ASSERT_EQ(client.unpack<int>(local), -1);
+
+  server.for_each<int>([&client](auto entity, auto value)
+    {
+      ASSERT_TRUE(client.valid(entity));
+      ASSERT_EQ(client.unpack<int>(entity), value);
+    });
+}
+
+TEST(Registry, Optimize_AfterSpike_SparseShrunk)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+  using side_components = list<bool>;
+
+  registry<entity_type, registered_archetypes, side_components, entity_manager<entity_type, lowest_recycler<entity_type>>> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100000; i++)
+  {
+    entities.push_back(i % 2 ? registry.create(i) : registry.create(i, 0.5f));
+
+    registry.add(entities.back(), true);
+  }
+
+  const size_t peak = registry.sparse_memory();
+
+  for (size_t i = 100; i < entities.size(); i++) registry.destroy(entities[i]);
+
+  ASSERT_EQ(registry.sparse_memory(), peak);
+  ASSERT_GT(registry.wasted_sparse_memory(), 0);
+
+  registry.optimize();
+
+  ASSERT_EQ(registry.wasted_sparse_memory(), 0);
+  ASSERT_LE(registry.sparse_memory(), 100 * sizeof(entity_type) * 2);
+
+  for (int i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(registry.unpack<int>(entities[i]), i);
+    ASSERT_TRUE(registry.has<bool>(entities[i]));
+  }
+
+  // The sparse_array grows back as needed
+  auto created = registry.create(-1);
+
+  ASSERT_EQ(created, 100);
+  ASSERT_EQ(registry.unpack<int>(created), -1);
+}
+
+TEST(Registry, Destroy_DeferredDuringForEach_CompactedLater)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Tombstoned>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 100; i++)
+  {
+    registry.create(Tombstoned { i });
+  }
+
+  size_t visited = 0;
+
+  registry.for_each<Tombstoned>([&](auto entity, auto& tombstoned)
+    {
+      ++visited;
+
+      if (tombstoned.value % 2 == 0) registry.destroy(entity);
+    });
+
+  ASSERT_EQ(visited, 100);
+  ASSERT_EQ(registry.size(), 50);
+  ASSERT_EQ(registry.access<archetype<Tombstoned>>().rows(), 100);
+
+  registry.compact();
+
+  ASSERT_EQ(registry.access<archetype<Tombstoned>>().rows(), 50);
+
+  registry.for_each<Tombstoned>([&registry](auto entity, auto& tombstoned)
+    {
+      ASSERT_EQ(tombstoned.value % 2, 1);
+      ASSERT_EQ(registry.unpack<Tombstoned>(entity).value, tombstoned.value);
+    });
+}
+
+TEST(Registry, ForEach_OrderedChangedInDifferentOrders_SameOrder)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Lockstep>>::
+      build;
+
+  registry<entity_type, registered_archetypes> first;
+  registry<entity_type, registered_archetypes> second;
+
+  for (int i = 0; i < 100; i++)
+  {
+    first.create(Lockstep { i });
+    second.create(Lockstep { i });
+  }
+
+  for (entity_type i = 0; i < 100; i += 2) first.destroy(i);
+  for (entity_type i = 100; i > 0; i -= 2) second.destroy(i - 2);
+
+  std::vector<entity_type> reserved;
+
+  for (int i = 0; i < 10; i++)
+  {
+    reserved.push_back(first.reserve());
+    second.reserve();
+  }
+
+  // Emplaced in different orders
+  for (auto entity : reserved) first.emplace(entity, Lockstep { -1 });
+  for (auto it = reserved.rbegin(); it != reserved.rend(); ++it) second.emplace(*it, Lockstep { -1 });
+
+  std::vector<entity_type> first_order;
+  std::vector<entity_type> second_order;
+
+  first.for_each<Lockstep>([&](auto entity, auto&)
+    { first_order.push_back(entity); });
+
+  second.for_each<Lockstep>([&](auto entity, auto&)
+    { second_order.push_back(entity); });
+
+  ASSERT_EQ(first_order.size(), 60);
+  ASSERT_EQ(first_order, second_order);
+  ASSERT_TRUE(std::is_sorted(first_order.rbegin(), first_order.rend()));
+}
+
+TEST(Registry, OnConstruct_AddRemoveDestroy_OnlyChangedComponentsNotified)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Observed>>::
+      add<archetype<Observed, float>>::
+        add<archetype<int>>::
+          build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  int observed_constructed = 0;
+  int observed_destroyed = 0;
+  int float_constructed = 0;
+  int float_destroyed = 0;
+  int changed = 0;
+
+  registry.on_construct<Observed>([&](auto, Observed& observed)
+    { observed_constructed += observed.value; });
+  registry.on_destroy<Observed>([&](auto, Observed& observed)
+    { observed_destroyed += observed.value; });
+  registry.on_construct<float>([&](auto, float&)
+    { ++float_constructed; });
+  registry.on_destroy<float>([&](auto, float&)
+    { ++float_destroyed; });
+  registry.on_archetype_change([&](auto)
+    { ++changed; });
+
+  auto entity = registry.create(Observed { 1 });
+  registry.create(2);
+
+  ASSERT_EQ(observed_constructed, 1);
+
+  registry.add(entity, 0.5f);
+
+  // Only the component that was added is constructed
+  ASSERT_EQ(observed_constructed, 1);
+  ASSERT_EQ(float_constructed, 1);
+  ASSERT_EQ(changed, 1);
+
+  registry.remove<float>(entity);
+
+  ASSERT_EQ(observed_destroyed, 0);
+  ASSERT_EQ(float_destroyed, 1);
+  ASSERT_EQ(changed, 2);
+
+  registry.destroy(entity);
+
+  ASSERT_EQ(observed_destroyed, 1);
+  ASSERT_EQ(changed, 2);
+}
+
+TEST(Registry, OnConstruct_BatchListeners_SingleSpanPerOperation)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Observed>>::
+      add<archetype<Observed, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<size_t> constructed;
+  std::vector<size_t> destroyed;
+  std::vector<size_t> changed;
+
+  registry.on_construct<float>([&](const entity_type*, size_t count)
+    { constructed.push_back(count); });
+  registry.on_destroy<Observed>([&](const entity_type*, size_t count)
+    { destroyed.push_back(count); });
+  registry.on_archetype_change([&](const entity_type*, size_t count)
+    { changed.push_back(count); });
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100; i++) entities.push_back(registry.create(Observed { i }));
+
+  registry.view<Observed>().migrate<Observed, float>(entities.data(), 30);
+
+  ASSERT_EQ(constructed, std::vector<size_t> { 30 });
+  ASSERT_EQ(changed, std::vector<size_t> { 30 });
+
+  registry.view<Observed>().migrate_if<Observed, float>([](auto, auto& observed)
+    { return observed.value % 2 == 0; });
+
+  // Entities already in the target are not migrated again
+  ASSERT_EQ(constructed, (std::vector<size_t> { 30, 35 }));
+
+  command_buffer commands { registry };
+
+  for (int i = 0; i < 10; i++) commands.create(Observed { i }, 0.5f);
+
+  commands.flush();
+
+  ASSERT_EQ(constructed, (std::vector<size_t> { 30, 35, 10 }));
+
+  registry.destroy_all();
+
+  ASSERT_EQ(destroyed, (std::vector<size_t> { 75, 35 }));
+}
+
+TEST(Registry, ReadEach_ReadOnlyPass_VersionsUntouched)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Transform>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 1000; i++) registry.create(Transform { static_cast<float>(i) });
+
+  size_t visited = 0;
+
+  const auto count = [&visited](auto, const Transform&)
+  { ++visited; };
+
+  const auto since = registry.version();
+
+  registry.tick();
+
+  float sum = 0.0f;
+
+  registry.read_each<Transform>([&sum](auto, const auto& transform)
+    { sum += transform.x; });
+
+  ASSERT_EQ(sum, 499500.0f);
+
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 0);
+
+  // Mutable iteration may write, so it still marks every block
+  registry.for_each<Transform>([](auto, auto&) {});
+
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 1000);
+}
+
+TEST(Registry, ForEachChangedSince_MostlyStatic_OnlyChangedBlocks)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Transform>>::
+      add<archetype<Transform, int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 1000; i++) registry.create(Transform { 0.0f });
+  for (int i = 0; i < 10; i++) registry.create(Transform { 0.0f }, i);
+
+  size_t visited = 0;
+
+  const auto count = [&visited](auto, const Transform&)
+  { ++visited; };
+
+  const auto since = registry.tick();
+
+  // Archetypes without change versions are always visited
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 10);
+
+  registry.tick();
+
+  registry.unpack<Transform>(5).x = 1.0f;
+  registry.read<Transform>(900);
+
+  visited = 0;
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 128 + 10);
+
+  // Iterating does not count as a write
+  visited = 0;
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 128 + 10);
+
+  registry.tick();
+
+  registry.for_each<Transform>([](auto, auto& transform)
+    { transform.x += 1.0f; });
+
+  visited = 0;
+  registry.for_each_changed_since<Transform>(since, count);
+
+  ASSERT_EQ(visited, 1010);
+}
+
+TEST(Registry, ForEachDirty_ArchetypeChanges_BitsKept)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Moved>>::
+      add<archetype<Moved, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 1000; i++) entities.push_back(registry.create(Moved { i }));
+
+  registry.clear_dirty<Moved>();
+
+  registry.mark_dirty<Moved>(entities[10]);
+  registry.mark_dirty<Moved>(entities[500]);
+
+  // Moving to another archetype keeps the bits, both of the dirty and of the clean entities
+  registry.add(entities[10], 1.0f);
+  registry.add(entities[20], 1.0f);
+
+  registry.view<Moved>().migrate<Moved, float>(entities.data() + 495, 10);
+
+  std::vector<entity_type> dirty;
+
+  registry.for_each_dirty<Moved>([&dirty](auto entity, auto& moved)
+    {
+      ASSERT_EQ(moved.x, static_cast<int>(entity));
+      dirty.push_back(entity);
+    });
+
+  std::sort(dirty.begin(), dirty.end());
+
+  ASSERT_EQ(dirty, (std::vector<entity_type> { entities[10], entities[500] }));
+
+  // Created entities are dirty
+  registry.create(Moved { 2000 }, 1.0f);
+
+  size_t visited = 0;
+
+  registry.for_each_dirty<Moved, float>([&visited](auto, auto&, auto&)
+    { ++visited; });
+
+  ASSERT_EQ(visited, 3);
+}
+
+TEST(Registry, ForEachDirty_ChangeVersions_OnlyVisitedBlocksStamped)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Sampled>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 1000; i++) registry.create(Sampled { i });
+
+  registry.clear_dirty<Sampled>();
+
+  const auto since = registry.version();
+
+  registry.tick();
+
+  registry.mark_dirty<Sampled>(500);
+
+  registry.for_each_dirty<Sampled>([](auto, auto& sampled)
+    { sampled.value = -1; });
+
+  size_t visited = 0;
+
+  registry.for_each_changed_since<Sampled>(since, [&visited](auto, const Sampled&)
+    { ++visited; });
+
+  ASSERT_EQ(visited, 64);
+}
+
+TEST(Registry, ForEach_EntityList_OnlyListedEnabledEntitiesVisited)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Enableable>>::
+      add<archetype<Enableable, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100; i++)
+  {
+    if (i % 2 == 0) entities.push_back(registry.create(Enableable { i }));
+    else
+      entities.push_back(registry.create(Enableable { i }, 0.0f));
+  }
+
+  std::vector<entity_type> listed;
+
+  for (size_t i = 0; i < entities.size(); i += 3) listed.push_back(entities[i]);
+
+  registry.disable(entities[3]);
+
+  std::vector<entity_type> visited;
+
+  registry.for_each<Enableable>(listed.data(), listed.size(), [&visited](auto entity, auto& enableable)
+    {
+      ASSERT_EQ(enableable.value, static_cast<int>(entity));
+      visited.push_back(entity);
+    });
+
+  listed.erase(std::find(listed.begin(), listed.end(), entities[3]));
+
+  ASSERT_EQ(visited, listed);
+}
+
+TEST(Registry, Cache_SelectiveQuery_UpdatedIncrementally)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Health>>::
+      add<archetype<Health, float>>::
+        add<archetype<float>>::
+          build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 500; i++) entities.push_back(registry.create(Health { i }));
+
+  auto& query = registry.cache<Health>([](auto, const Health& health)
+    { return health.value % 10 == 0; });
+
+  ASSERT_EQ(query.size(), 50);
+
+  // Created entities are evaluated
+  for (int i = 500; i < 1000; i++) entities.push_back(registry.create(Health { i }, 1.0f));
+
+  ASSERT_EQ(query.size(), 100);
+  ASSERT_TRUE(query.contains(entities[990]));
+  ASSERT_FALSE(query.contains(entities[991]));
+
+  // Destroyed entities and entities that lose the component are removed, other archetype changes keep them
+  registry.destroy(entities[0]);
+  registry.remove<Health>(entities[990]);
+  registry.add(entities[10], 1.0f);
+  registry.view<Health, float>().migrate<Health>(entities.data() + 500, 100);
+
+  ASSERT_EQ(query.size(), 98);
+  ASSERT_FALSE(query.contains(entities[990]));
+  ASSERT_TRUE(query.contains(entities[10]));
+  ASSERT_TRUE(query.contains(entities[500]));
+
+  // Written components are only evaluated again once dirty
+  registry.clear_dirty<Health>();
+
+  registry.unpack<Health>(entities[20]).value = 1;
+  registry.unpack<Health>(entities[21]).value = 30;
+
+  ASSERT_TRUE(query.contains(entities[20]));
+
+  query.update();
+  registry.clear_dirty<Health>();
+
+  ASSERT_FALSE(query.contains(entities[20]));
+  ASSERT_TRUE(query.contains(entities[21]));
+  ASSERT_EQ(query.size(), 98);
+
+  std::vector<entity_type> visited;
+
+  query.for_each([&visited](auto entity, auto& health)
+    {
+      ASSERT_EQ(health.value % 10, 0);
+      visited.push_back(entity);
+    });
+
+  std::vector<entity_type> expected;
+
+  registry.for_each<Health>([&expected](auto entity, auto& health)
+    {
+      if (health.value % 10 == 0) expected.push_back(entity);
+    });
+
+  std::sort(visited.begin(), visited.end());
+  std::sort(expected.begin(), expected.end());
+
+  ASSERT_EQ(visited, expected);
+
+  registry.destroy_all();
+
+  ASSERT_TRUE(query.empty());
+}
+
+TEST(Registry, Cache_StableArchetypeWithDeadRows_OnlyLiveEntitiesMatched)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Pinned>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 10; i++) registry.create(Pinned { i });
+
+  // The dead rows hold links to the next free row, which look like live entities
+  registry.destroy(2);
+  registry.destroy(4);
+
+  auto& query = registry.cache<Pinned>([](auto, const Pinned&)
+    { return true; });
+
+  ASSERT_EQ(query.size(), 8);
+
+  std::vector<entity_type> visited;
+
+  query.for_each([&visited](auto entity, auto& pinned)
+    {
+      ASSERT_EQ(pinned.value, static_cast<int>(entity));
+      visited.push_back(entity);
+    });
+
+  std::sort(visited.begin(), visited.end());
+
+  ASSERT_EQ(visited, (std::vector<entity_type> { 0, 1, 3, 5, 6, 7, 8, 9 }));
+}
+
+TEST(Registry, Cache_CompactIds_MatchesRenumbered)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Health>>::
+      add<archetype<Health, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    if (i % 2) registry.create(Health { i });
+    else
+      registry.create(Health { i }, 1.0f);
+  }
+
+  auto& query = registry.cache<Health>([](auto, const Health& health)
+    { return health.value % 10 == 0; });
+
+  ASSERT_EQ(query.size(), 100);
+
+  // Only a few low entities survive, the sparse_array shrinks below the old identifiers
+  for (entity_type entity = 0; entity < 900; entity++) registry.destroy(entity);
+
+  ASSERT_EQ(query.size(), 10);
+
+  std::vector<std::pair<entity_type, entity_type>> renumbered;
+
+  registry.compact_ids([&renumbered](auto old, auto id) { renumbered.emplace_back(old, id); });
+  registry.optimize();
+
+  ASSERT_EQ(query.size(), 10);
+
+  for (const auto& [old, id] : renumbered)
+  {
+    ASSERT_EQ(query.contains(id), old % 10 == 0);
+  }
+
+  std::vector<entity_type> visited;
+
+  query.for_each([&visited](auto entity, auto& health)
+    {
+      ASSERT_EQ(health.value % 10, 0);
+      visited.push_back(entity);
+    });
+
+  std::vector<entity_type> expected;
+
+  registry.for_each<Health>([&expected](auto entity, auto& health)
+    {
+      if (health.value % 10 == 0) expected.push_back(entity);
+    });
+
+  std::sort(visited.begin(), visited.end());
+  std::sort(expected.begin(), expected.end());
+
+  ASSERT_EQ(visited, expected);
+
+  // The query keeps following the registry with the new identifiers
+  const auto created = registry.create(Health { 1000 });
+
+  ASSERT_TRUE(query.contains(created));
+  ASSERT_EQ(query.size(), 11);
+}
+
+TEST(CommandBuffer, Flush_DuringForEach_EveryEntityVisitedOnce)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  for (int i = 0; i < 100; i++)
+  {
+    registry.create(i);
+  }
+
+  size_t visited = 0;
+
+  registry.for_each<int>([&](auto entity, auto i)
+    {
+      ++visited;
+
+      if (i % 2 == 0) commands.destroy<int>(entity);
+      else
+        commands.add(entity, 0.5f);
+
+      commands.create(i + 100);
+    });
+
+  ASSERT_EQ(visited, 100);
+  ASSERT_EQ(commands.size(), 200);
+  ASSERT_EQ(registry.size(), 100);
+
+  commands.flush();
+
+  ASSERT_TRUE(commands.empty());
+  ASSERT_EQ(registry.size(), 150);
+  ASSERT_EQ(registry.size<float>(), 50);
+
+  registry.for_each<int>([&registry](auto entity, auto i)
+    {
+      ASSERT_EQ(registry.has<float>(entity), i < 100);
+      ASSERT_TRUE(i >= 100 || i % 2 == 1);
+    });
+}
+
+TEST(CommandBuffer, Flush_ChangesOfSameEntity_AppliedInOrder)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        add<archetype<int, double>>::
+          add<archetype<int, double, float>>::
+            build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  auto entity1 = registry.create(1);
+  auto entity2 = commands.create(2);
+
+  commands.add(entity1, 0.5f);
+  commands.add(entity2, 2.0);
+  commands.add(entity1, 1.0);
+  commands.remove<float>(entity1);
+  commands.swap_archetype<int, float>(entity2);
+
+  commands.flush();
+
+  ASSERT_EQ(registry.size(), 2);
+  ASSERT_EQ((registry.size<int, double>()), 1);
+  ASSERT_EQ((registry.size<int, float>()), 1);
+  ASSERT_EQ(registry.unpack<int>(entity1), 1);
+  ASSERT_EQ(registry.unpack<double>(entity1), 1.0);
+  ASSERT_EQ(registry.unpack<int>(entity2), 2);
+  ASSERT_EQ(registry.unpack<float>(entity2), 0.0f);
+}
+
+TEST(CommandBuffer, Flush_AddRemoveFromSeveralArchetypes_ComponentsFollowEntities)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        add<archetype<int, double>>::
+          add<archetype<int, double, float>>::
+            build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 200; i++)
+  {
+    if (i % 2 == 0) entities.push_back(registry.create(i));
+    else
+      entities.push_back(registry.create(i, static_cast<double>(i)));
+  }
+
+  // Both source archetypes are moved in bulk, and the added values must follow their entities
+  for (int i = 0; i < 200; i++) commands.add(entities[i], static_cast<float>(i));
+
+  for (int i = 1; i < 200; i += 4) commands.remove<double>(entities[i]);
+
+  commands.destroy<int>(entities[2]);
+
+  commands.flush();
+
+  ASSERT_EQ(registry.size(), 199);
+  ASSERT_EQ((registry.size<int, float>()), 199);
+  ASSERT_EQ((registry.size<int, double, float>()), 50);
+
+  registry.for_each<int, float>([&registry](auto entity, auto i, auto f)
+    {
+      ASSERT_EQ(static_cast<float>(i), f);
+      ASSERT_EQ(registry.has<double>(entity), i % 4 == 3);
+    });
+}
+
+TEST(CommandBuffer, Clear_NonTrivialComponents_NotApplied)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<std::string>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  command_buffer commands { registry };
+
+  // Enough components to span multiple blocks of the arena
+  for (int i = 0; i < 2000; i++)
+  {
+    commands.create(std::string(i % 50, 'a'));
+  }
+
+  commands.clear();
+  commands.flush();
+
+  ASSERT_EQ(registry.size(), 0);
+
+  for (int i = 0; i < 2000; i++)
+  {
+    commands.create(std::string(i % 50, 'b'));
+  }
+
+  commands.flush();
+
+  ASSERT_EQ(registry.size(), 2000);
+
+  registry.for_each<std::string>([](auto, const auto& string)
+    { ASSERT_TRUE(string.empty() || string.front() == 'b'); });
+}
+
+TEST(ConcurrentCommandBuffer, Flush_RecordedOnThreads_Applied)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes, list<>, concurrent_entity_manager<entity_type>> registry;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    registry.create(i);
+  }
+
+  concurrent_command_buffer commands { registry, 4 };
+
+  std::vector<std::thread> threads;
+
+  for (size_t slot = 0; slot < commands.slots(); slot++)
+  {
+    threads.emplace_back([&registry, &commands, slot]()
+      {
+        auto& local = commands.local(slot);
+
+        // Every thread handles a quarter of the entities
+        registry.view<int>().for_each([&local, slot](auto entity, auto i)
+          {
+            if (static_cast<size_t>(i) % 4 != slot) return;
+
+            if (i % 2 == 0) local.add(entity, 0.5f);
+            else
+              local.destroy<int>(entity);
+
+            local.create(i + 1000);
+          });
+      });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(commands.size(), 2000);
+
+  commands.flush();
+
+  ASSERT_EQ(commands.size(), 0);
+  ASSERT_EQ(registry.size(), 1500);
+  ASSERT_EQ(registry.size<float>(), 500);
+
+  registry.for_each<int>([&registry](auto entity, auto i)
+    {
+      ASSERT_EQ(registry.has<float>(entity), i < 1000);
+    });
+}
+
+TEST(ConcurrentCommandBuffer, Flush_DifferentSchedules_SameStorages)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  using registry_type = registry<entity_type, registered_archetypes, list<>, concurrent_entity_manager<entity_type>>;
+
+  registry_type registries[2];
+
+  for (auto& registry : registries)
+  {
+    for (int i = 0; i < 100; i++) registry.create(i);
+  }
+
+  // Same commands per slot, but the slots are recorded in opposite orders
+  for (size_t r = 0; r < 2; r++)
+  {
+    concurrent_command_buffer commands { registries[r], 3 };
+
+    for (size_t s = 0; s < 3; s++)
+    {
+      const size_t slot = r == 0 ? s : 2 - s;
+
+      for (entity_type entity = static_cast<entity_type>(slot); entity < 100; entity += 3)
+      {
+        if (entity % 2) commands.local(slot).add(entity, static_cast<float>(slot));
+        else
+          commands.local(slot).destroy(entity);
+      }
+    }
+
+    commands.flush();
+  }
+
+  ASSERT_EQ(registries[0].size<float>(), 50);
+  ASSERT_EQ((registries[0].access<archetype<int, float>>().size()), (registries[1].access<archetype<int, float>>().size()));
+
+  auto& first = registries[0].access<archetype<int, float>>();
+  auto& second = registries[1].access<archetype<int, float>>();
+
+  for (auto it = first.begin(), other = second.begin(); it != first.end(); ++it, ++other)
+  {
+    ASSERT_EQ(*it, *other);
+  }
+}
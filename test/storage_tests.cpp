@@ -1,7 +1,11 @@
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
 #include <storage.hpp>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace xecs;
 
@@ -34,6 +38,185 @@ struct NonTrivial
   }
 };
 
+struct Enableable
+{
+  unsigned int value;
+};
+
+struct CompactEnableable
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Enableable>> : default_storage_traits
+{
+  static constexpr bool enableable = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<CompactEnableable>> : default_storage_traits
+{
+  static constexpr bool compact_disabled = true;
+};
+
+struct Grouped
+{
+  unsigned int group;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Grouped, unsigned int>> : default_storage_traits
+{
+  static constexpr size_t groups = 4;
+
+  using group_component = Grouped;
+
+  static size_t group(const Grouped& grouped) { return grouped.group; }
+};
+
+struct PagedEntity
+{};
+
+template<>
+struct xecs::entity_traits<PagedEntity> : entity_traits<unsigned int>
+{};
+
+template<>
+struct xecs::sparse_array_traits<PagedEntity> : default_sparse_array_traits
+{
+  static constexpr size_t page_size = 64;
+};
+
+struct Huge
+{
+  uint64_t value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Huge>> : default_storage_traits
+{
+  static constexpr bool huge_pages = true;
+};
+
+struct Deferred
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Deferred>> : default_storage_traits
+{
+  static constexpr bool deferred_erase = true;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Deferred, std::string>> : default_storage_traits
+{
+  static constexpr bool deferred_erase = true;
+};
+
+struct Ordered
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Ordered>> : default_storage_traits
+{
+  static constexpr bool ordered = true;
+};
+
+struct Stable
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Stable, std::string>> : default_storage_traits
+{
+  static constexpr bool stable_addresses = true;
+};
+
+struct Tracked
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Tracked, float>> : default_storage_traits
+{
+  static constexpr size_t version_block = 64;
+};
+
+struct Dirty
+{
+  unsigned int value;
+};
+
+template<>
+struct xecs::storage_traits<archetype<Dirty, float>> : default_storage_traits
+{
+  using dirty_components = list<Dirty>;
+};
+
+template<typename Component>
+void TestEachSkipsDisabled()
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Component>>;
+
+  storage_type storage;
+
+  entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, Component { i });
+
+    if (i % 3 == 0) storage.disable(i);
+  }
+
+  // Disabling twice does nothing
+  storage.disable(0);
+
+  for (entity_type i = 0; i < amount; i += 5)
+  {
+    storage.erase(i);
+  }
+
+  for (entity_type i = 0; i < amount; i += 7)
+  {
+    if (i % 5 != 0) storage.enable(i);
+  }
+
+  size_t expected = 0;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    if (i % 5 == 0) continue;
+
+    const bool enabled = i % 3 != 0 || i % 7 == 0;
+
+    ASSERT_EQ(storage.enabled(i), enabled);
+    ASSERT_EQ(storage.template unpack<Component>(i).value, i);
+
+    if (enabled) expected++;
+  }
+
+  size_t iterations = 0;
+
+  storage.each([&iterations, &storage](auto& it)
+    {
+      ASSERT_EQ(*it, it.template unpack<Component>().value);
+      ASSERT_TRUE(storage.enabled(*it));
+      iterations++;
+    });
+
+  ASSERT_EQ(iterations, expected);
+  ASSERT_EQ(storage.size(), amount - amount / 5);
+}
+
 TEST(Storage, Empty_AfterInitialization_True)
 {
   using entity_type = unsigned int;
@@ -766,3 +949,891 @@ TEST(StorageSharedSparseArray, Insert_TwoStoragesInsertSingle_UsingSharedMemory)
   ASSERT_TRUE(shared[100000] == storage2.size() - 2);
   ASSERT_TRUE(shared[453] == storage2.size() - 1);
 }
+
+TEST(StorageSharedSparseArray, Transfer_CommonComponentsMoved)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<entity_type>;
+  using source_type = storage<entity_type, archetype<int, std::string>>;
+  using destination_type = storage<entity_type, archetype<std::string, float>>;
+
+  sparse_type shared;
+
+  source_type source;
+  destination_type destination;
+
+  source.share(&shared);
+  destination.share(&shared);
+
+  source.insert(0, 1, std::string { "Test0" });
+  source.insert(1, 2, std::string { "Test1" });
+
+  source.transfer(0, destination, 0.5f);
+
+  ASSERT_EQ(source.size(), 1);
+  ASSERT_EQ(destination.size(), 1);
+  ASSERT_FALSE(source.contains(0));
+  ASSERT_TRUE(source.contains(1));
+  ASSERT_TRUE(destination.contains(0));
+  ASSERT_EQ(source.unpack<std::string>(1), "Test1");
+  ASSERT_EQ(destination.unpack<std::string>(0), "Test0");
+  ASSERT_EQ(destination.unpack<float>(0), 0.5f);
+
+  source.transfer(1, destination);
+
+  ASSERT_TRUE(source.empty());
+  ASSERT_EQ(destination.size(), 2);
+  ASSERT_EQ(destination.unpack<std::string>(1), "Test1");
+}
+
+TEST(Storage, Partition_Predicate_MatchingAtBack)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<entity_type>>;
+
+  storage_type storage;
+
+  entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, i);
+  }
+
+  auto matching = storage.partition([](auto it)
+    { return it.template unpack<entity_type>() % 3 == 0; });
+
+  ASSERT_EQ(matching, 334);
+
+  size_t iterations = 0;
+
+  // Iterators start from the back
+  for (auto it = storage.begin(); it != storage.end(); ++it, ++iterations)
+  {
+    ASSERT_EQ(*it, it.unpack<entity_type>());
+    ASSERT_EQ(iterations < matching, *it % 3 == 0);
+  }
+
+  ASSERT_EQ(iterations, amount);
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    ASSERT_TRUE(storage.contains(i));
+    ASSERT_EQ(storage.unpack<entity_type>(i), i);
+  }
+}
+
+TEST(Storage, SortBy_IntegralKey_IteratedInOrder)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, std::string>>;
+
+  storage_type storage;
+
+  entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, static_cast<int>((i * 7919) % amount) - 500, std::to_string(i));
+  }
+
+  // Scrambles the rows
+  for (entity_type i = 0; i < amount; i += 3)
+  {
+    storage.erase(i);
+  }
+
+  storage.sort_by([](auto it)
+    { return it.template unpack<int>(); });
+
+  std::vector<int> values;
+
+  for (auto it = storage.begin(); it != storage.end(); ++it)
+  {
+    values.push_back(it.unpack<int>());
+    ASSERT_EQ(it.unpack<std::string>(), std::to_string(*it));
+  }
+
+  ASSERT_EQ(values.size(), storage.size());
+  ASSERT_TRUE(std::is_sorted(values.begin(), values.end()));
+  ASSERT_EQ(values.front(), -499);
+
+  for (entity_type i = 1; i < amount; i += 3)
+  {
+    ASSERT_TRUE(storage.contains(i));
+    ASSERT_EQ(storage.unpack<std::string>(i), std::to_string(i));
+  }
+}
+
+TEST(Storage, Sort_Comparison_EquivalentKeepOrder)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<entity_type>>;
+
+  storage_type storage;
+
+  entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, i % 10);
+  }
+
+  std::vector<entity_type> before;
+
+  for (auto it = storage.begin(); it != storage.end(); ++it) before.push_back(*it);
+
+  storage.sort([](auto lhs, auto rhs)
+    { return lhs.template unpack<entity_type>() > rhs.template unpack<entity_type>(); });
+
+  std::vector<entity_type> after;
+
+  for (auto it = storage.begin(); it != storage.end(); ++it)
+  {
+    ASSERT_EQ(it.unpack<entity_type>(), *it % 10);
+    after.push_back(*it);
+  }
+
+  // Decreasing keys, then the previous order for the same key
+  for (size_t i = 1; i < after.size(); i++)
+  {
+    const auto previous = after[i - 1] % 10;
+    const auto current = after[i] % 10;
+
+    ASSERT_GE(previous, current);
+
+    if (previous == current)
+    {
+      const auto first = std::find(before.begin(), before.end(), after[i - 1]);
+      const auto second = std::find(before.begin(), before.end(), after[i]);
+
+      ASSERT_LT(first, second);
+    }
+  }
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    ASSERT_EQ(storage.unpack<entity_type>(i), i % 10);
+  }
+}
+
+TEST(Storage, Each_Disabled_Skipped)
+{
+  TestEachSkipsDisabled<Enableable>();
+}
+
+TEST(Storage, Each_CompactDisabled_Skipped)
+{
+  TestEachSkipsDisabled<CompactEnableable>();
+}
+
+TEST(Storage, Each_CompactDisabledAfterPartition_Skipped)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<CompactEnableable>>;
+
+  storage_type storage;
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    storage.insert(i, CompactEnableable { i });
+
+    if (i % 2 == 0) storage.disable(i);
+  }
+
+  auto matching = storage.partition([](auto it)
+    { return it.template unpack<CompactEnableable>().value % 4 == 0; });
+
+  ASSERT_EQ(matching, 25);
+
+  size_t iterations = 0;
+
+  storage.each([&iterations](auto& it)
+    {
+      ASSERT_EQ(*it % 2, 1);
+      iterations++;
+    });
+
+  ASSERT_EQ(iterations, 50);
+}
+
+TEST(Storage, Insert_EnableableAfterShrinkToEmpty_Enabled)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Enableable>>;
+
+  storage_type storage;
+
+  storage.insert(0);
+  storage.erase(0);
+  storage.shrink_to_fit();
+
+  storage.insert(1);
+  storage.disable(1);
+
+  ASSERT_FALSE(storage.enabled(1));
+
+  storage.enable(1);
+
+  ASSERT_TRUE(storage.enabled(1));
+}
+
+TEST(Storage, EachGroup_InsertEraseRegroup_OnlyGroup)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Grouped, entity_type>>;
+
+  storage_type storage;
+
+  entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, Grouped { i % 3 }, i);
+  }
+
+  for (entity_type i = 0; i < amount; i += 4)
+  {
+    storage.erase(i);
+  }
+
+  for (entity_type i = 1; i < amount; i += 4)
+  {
+    storage.unpack<Grouped>(i).group = 3;
+    storage.regroup(i);
+  }
+
+  size_t total = 0;
+
+  for (size_t group = 0; group < 4; group++)
+  {
+    size_t iterations = 0;
+
+    storage.each_group(group, [&iterations, group](auto& it)
+      {
+        ASSERT_EQ(it.template unpack<Grouped>().group, group);
+        ASSERT_EQ(*it, it.template unpack<entity_type>());
+        iterations++;
+      });
+
+    ASSERT_EQ(iterations, storage.group_size(group));
+
+    total += iterations;
+  }
+
+  ASSERT_EQ(total, storage.size());
+  ASSERT_EQ(storage.group_size(3), 250);
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    ASSERT_EQ(storage.contains(i), i % 4 != 0);
+  }
+}
+
+TEST(Storage, EachGroup_AfterPartition_Regrouped)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Grouped, entity_type>>;
+
+  storage_type storage;
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    storage.insert(i, Grouped { i % 4 }, i);
+  }
+
+  auto matching = storage.partition([](auto it)
+    { return it.template unpack<entity_type>() % 2 == 0; });
+
+  ASSERT_EQ(matching, 50);
+
+  for (size_t group = 0; group < 4; group++)
+  {
+    ASSERT_EQ(storage.group_size(group), 25);
+
+    storage.each_group(group, [group](auto& it)
+      { ASSERT_EQ(it.template unpack<Grouped>().group, group); });
+  }
+}
+
+TEST(StorageSharedSparseArray, Transfer_Paged_PagesFreedWhenEmpty)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<PagedEntity>;
+
+  static_assert(sparse_type::paged);
+
+  sparse_type sparse;
+
+  storage<PagedEntity, archetype<int>> storage1;
+  storage<PagedEntity, archetype<int, float>> storage2;
+
+  storage1.share(&sparse);
+  storage2.share(&sparse);
+
+  const entity_type high = 1 << 20;
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    storage1.insert(i, static_cast<int>(i));
+    storage1.insert(high + i, static_cast<int>(high + i));
+  }
+
+  ASSERT_EQ(sparse.allocated_pages(), 4);
+  ASSERT_GE(sparse.capacity(), high + 100);
+  ASSERT_FALSE(storage1.contains(high + 200));
+  ASSERT_FALSE(storage1.contains(high / 2));
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    storage1.transfer(high + i, storage2, 0.5f);
+  }
+
+  ASSERT_EQ(sparse.allocated_pages(), 4);
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    ASSERT_TRUE(storage1.contains(i));
+    ASSERT_FALSE(storage1.contains(high + i));
+    ASSERT_TRUE(storage2.contains(high + i));
+    ASSERT_EQ(storage2.unpack<int>(high + i), static_cast<int>(high + i));
+  }
+
+  for (entity_type i = 0; i < 100; i++)
+  {
+    storage2.erase(high + i);
+  }
+
+  ASSERT_EQ(sparse.allocated_pages(), 2);
+  ASSERT_FALSE(storage2.contains(high));
+
+  storage1.clear();
+
+  ASSERT_EQ(sparse.allocated_pages(), 0);
+}
+
+TEST(StorageSharedSparseArray, ShrinkToFit_Paged_PageTableShrunk)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<PagedEntity>;
+
+  sparse_type sparse;
+
+  storage<PagedEntity, archetype<int>> storage;
+
+  storage.share(&sparse);
+
+  for (entity_type i = 0; i < 10; i++)
+  {
+    storage.insert(i);
+    storage.insert(1000 + i);
+  }
+
+  const size_t pages = sparse.pages();
+
+  ASSERT_GT(pages, 2);
+  ASSERT_EQ(sparse.wasted_memory(storage.reach()), 0);
+
+  for (entity_type i = 0; i < 10; i++) storage.erase(1000 + i);
+
+  ASSERT_EQ(storage.reach(), 10);
+  ASSERT_GT(sparse.wasted_memory(storage.reach()), 0);
+
+  const size_t memory = sparse.memory();
+
+  sparse.shrink_to_fit(storage.reach());
+
+  ASSERT_EQ(sparse.pages(), 1);
+  ASSERT_EQ(sparse.memory(), memory - (pages - 1) * (sizeof(void*) + sizeof(size_t)));
+  ASSERT_TRUE(storage.contains(5));
+  ASSERT_FALSE(storage.contains(1005));
+}
+
+TEST(StorageSharedSparseArray, Release_Paged_MemoryDropsWhenPageEmpty)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<PagedEntity>;
+
+  const size_t page_bytes = sparse_type::page_size * sizeof(entity_type);
+
+  sparse_type sparse;
+
+  for (entity_type i = 0; i < 2 * sparse_type::page_size; i++) sparse.acquire(i);
+
+  ASSERT_EQ(sparse.allocated_pages(), 2);
+
+  const size_t memory = sparse.memory();
+
+  // The page stays allocated as long as one of its entities is contained
+  for (entity_type i = 0; i < sparse_type::page_size - 1; i++)
+  {
+    sparse.release(i);
+
+    ASSERT_EQ(sparse.memory(), memory);
+  }
+
+  sparse.release(sparse_type::page_size - 1);
+
+  ASSERT_EQ(sparse.allocated_pages(), 1);
+  ASSERT_EQ(sparse.memory(), memory - page_bytes);
+
+  for (entity_type i = sparse_type::page_size; i < 2 * sparse_type::page_size; i++) sparse.release(i);
+
+  ASSERT_EQ(sparse.allocated_pages(), 0);
+  ASSERT_EQ(sparse.memory(), memory - 2 * page_bytes);
+}
+
+TEST(StorageSharedSparseArray, Acquire_PagedHighIds_SinglePageAllocated)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<PagedEntity>;
+
+  sparse_type sparse;
+
+  const entity_type high = 1 << 20;
+
+  for (entity_type i = 0; i < sparse_type::page_size; i++) sparse.acquire(high + i);
+
+  ASSERT_EQ(sparse.allocated_pages(), 1);
+  ASSERT_EQ(sparse.pages(), high / sparse_type::page_size + 1);
+  ASSERT_EQ(sparse.memory(), sparse.pages() * (sizeof(void*) + sizeof(size_t))
+      + sparse_type::page_size * sizeof(entity_type));
+
+  // The page table is far smaller than a flat array of the same reach
+  ASSERT_LT(sparse.memory(), sparse.capacity() * sizeof(entity_type));
+
+  for (entity_type i = 0; i < sparse_type::page_size; i++) sparse.release(high + i);
+
+  ASSERT_EQ(sparse.allocated_pages(), 0);
+}
+
+TEST(StorageSharedSparseArray, ShrinkToFit_Paged_WastedMemoryGivenBack)
+{
+  using sparse_type = sparse_array<PagedEntity>;
+
+  const size_t entry_bytes = sizeof(void*) + sizeof(size_t);
+
+  sparse_type sparse;
+
+  sparse.acquire(0);
+  sparse.acquire(10 * sparse_type::page_size);
+
+  ASSERT_EQ(sparse.pages(), 11);
+  ASSERT_EQ(sparse.wasted_memory(sparse.capacity()), 0);
+  ASSERT_EQ(sparse.wasted_memory(10 * sparse_type::page_size + 1), 0);
+
+  sparse.release(10 * sparse_type::page_size);
+
+  // Reaches are rounded up to whole pages
+  ASSERT_EQ(sparse.wasted_memory(1), 10 * entry_bytes);
+  ASSERT_EQ(sparse.wasted_memory(sparse_type::page_size), 10 * entry_bytes);
+  ASSERT_EQ(sparse.wasted_memory(sparse_type::page_size + 1), 9 * entry_bytes);
+
+  const size_t memory = sparse.memory();
+  const size_t wasted = sparse.wasted_memory(1);
+
+  sparse.shrink_to_fit(1);
+
+  ASSERT_EQ(sparse.pages(), 1);
+  ASSERT_EQ(sparse.capacity(), sparse_type::page_size);
+  ASSERT_EQ(sparse.memory(), memory - wasted);
+  ASSERT_EQ(sparse.wasted_memory(1), 0);
+
+  // A larger reach never grows the page table
+  sparse.shrink_to_fit(100 * sparse_type::page_size);
+
+  ASSERT_EQ(sparse.pages(), 1);
+
+  sparse.release(0);
+  sparse.shrink_to_fit(0);
+
+  ASSERT_EQ(sparse.pages(), 0);
+  ASSERT_EQ(sparse.memory(), 0);
+
+  // The sparse array can grow again after being emptied
+  sparse.acquire(3);
+
+  ASSERT_EQ(sparse.pages(), 1);
+  ASSERT_EQ(sparse.allocated_pages(), 1);
+}
+
+TEST(StorageWithData, Insert_HugePagesTriggerGrowth)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Huge>>;
+
+  storage_type storage;
+
+  // Dense arrays end up bigger than a huge page
+  const entity_type amount = 1000000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, Huge { i });
+  }
+
+  // Huge allocations are staggered but always start on a cache line
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(&storage.unpack<Huge>(0)) % 64, 0);
+
+  for (entity_type i = amount / 2; i < amount; i++)
+  {
+    storage.erase(i);
+  }
+
+  storage.shrink_to_fit();
+
+  ASSERT_EQ(storage.size(), amount / 2);
+
+  for (entity_type i = 0; i < amount / 2; i++)
+  {
+    ASSERT_EQ(storage.unpack<Huge>(i).value, i);
+  }
+}
+
+TEST(Storage, Erase_DeferredWhileIterating_EveryEntityVisitedOnce)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Deferred>>;
+
+  storage_type storage;
+
+  const entity_type amount = 1000;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, Deferred { i });
+  }
+
+  std::vector<entity_type> visited;
+
+  storage.each([&](auto& it)
+    {
+      visited.push_back(*it);
+
+      // Erase the current entity, and sometimes an entity that was not visited yet
+      if (*it % 2 == 0) storage.erase(*it);
+      if (*it % 4 == 0 && *it > 0) storage.erase(*it - 1);
+    });
+
+  // Entities are visited from the back, the 249 entities erased ahead are skipped
+  ASSERT_EQ(visited.size(), 751);
+  ASSERT_EQ(storage.size(), 251);
+  ASSERT_EQ(storage.rows(), amount);
+  ASSERT_FALSE(storage.contains(0));
+  ASSERT_FALSE(storage.contains(995));
+  ASSERT_TRUE(storage.contains(997));
+
+  storage.compact();
+
+  ASSERT_EQ(storage.rows(), 251);
+
+  std::vector<entity_type> remaining;
+
+  storage.each([&](auto& it)
+    {
+      ASSERT_EQ(it.template unpack<Deferred>().value, *it);
+      remaining.push_back(*it);
+    });
+
+  // The iteration order is kept by compaction
+  ASSERT_TRUE(std::is_sorted(remaining.rbegin(), remaining.rend()));
+  ASSERT_EQ(remaining.size(), 251);
+
+  for (auto entity : remaining)
+  {
+    ASSERT_TRUE(storage.contains(entity));
+    ASSERT_EQ(storage.unpack<Deferred>(entity).value, entity);
+  }
+}
+
+TEST(Storage, Insert_StableAddresses_ComponentsNeverMove)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Stable, std::string>>;
+
+  storage_type storage;
+
+  const entity_type amount = 5000;
+
+  std::vector<Stable*> addresses;
+
+  for (entity_type i = 0; i < amount; i++)
+  {
+    storage.insert(i, Stable { i }, std::to_string(i));
+    addresses.push_back(&storage.unpack<Stable>(i));
+  }
+
+  for (entity_type i = 0; i < amount; i += 2)
+  {
+    storage.erase(i);
+  }
+
+  ASSERT_EQ(storage.size(), amount / 2);
+
+  // Dead rows are reused before growing
+  for (entity_type i = amount; i < amount * 2; i++)
+  {
+    storage.insert(i, Stable { i }, std::to_string(i));
+  }
+
+  ASSERT_EQ(storage.rows(), amount * 3 / 2);
+
+  for (entity_type i = 1; i < amount; i += 2)
+  {
+    ASSERT_EQ(&storage.unpack<Stable>(i), addresses[i]);
+    ASSERT_EQ(addresses[i]->value, i);
+    ASSERT_EQ(storage.unpack<std::string>(i), std::to_string(i));
+  }
+
+  for (entity_type i = amount; i < amount * 2; i++)
+  {
+    ASSERT_TRUE(storage.contains(i));
+    ASSERT_EQ(storage.unpack<Stable>(i).value, i);
+    ASSERT_EQ(storage.unpack<std::string>(i), std::to_string(i));
+  }
+
+  ASSERT_FALSE(storage.contains(0));
+
+  storage.shrink_to_fit();
+
+  ASSERT_EQ(&storage.unpack<Stable>(1), addresses[1]);
+}
+
+TEST(Storage, Each_Ordered_SameOrderWhateverTheHistory)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Ordered>>;
+
+  const entity_type amount = 1000;
+
+  std::vector<entity_type> entities;
+
+  for (entity_type i = 0; i < amount; i++) entities.push_back(i);
+
+  std::vector<entity_type> shuffled = entities;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937 { 42 });
+
+  storage_type first;
+  storage_type second;
+
+  for (auto entity : entities) first.insert(entity, Ordered { entity });
+  for (auto entity : shuffled) second.insert(entity, Ordered { entity });
+
+  // Same entities erased in different orders, with a compaction in between for one of them
+  for (size_t i = 0; i < amount; i += 3) first.erase(entities[i]);
+
+  for (size_t i = amount; i-- > 0;)
+  {
+    if (i % 3 == 0) second.erase(entities[i]);
+    if (i == amount / 2) second.compact();
+  }
+
+  std::vector<entity_type> reinserted;
+
+  for (entity_type i = 0; i < amount; i += 6) reinserted.push_back(i);
+
+  // Some of them reinserted, in different orders
+  for (auto entity : reinserted) first.insert(entity, Ordered { entity });
+
+  std::shuffle(reinserted.begin(), reinserted.end(), std::mt19937 { 7 });
+
+  for (auto entity : reinserted) second.insert(entity, Ordered { entity });
+
+  std::vector<entity_type> first_order;
+  std::vector<entity_type> second_order;
+
+  first.each([&](auto& it)
+    { first_order.push_back(*it); });
+
+  second.each([&](auto& it)
+    { second_order.push_back(*it); });
+
+  ASSERT_EQ(first.size(), second.size());
+  ASSERT_EQ(first_order, second_order);
+  ASSERT_TRUE(std::is_sorted(first_order.rbegin(), first_order.rend()));
+
+  for (auto entity : first_order)
+  {
+    ASSERT_TRUE(second.contains(entity));
+    ASSERT_EQ(second.unpack<Ordered>(entity).value, entity);
+  }
+}
+
+TEST(Storage, EachChanged_WritesAndErase_OnlyChangedBlocksVisited)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Tracked, float>>;
+
+  size_t clock = 1;
+
+  storage_type storage;
+  storage.track(&clock);
+
+  for (entity_type i = 0; i < 1000; i++) storage.insert(i, Tracked { i });
+
+  size_t visited = 0;
+
+  const auto count = [&visited](auto&)
+  { ++visited; };
+
+  storage.each_changed<Tracked, float>(1, count);
+
+  ASSERT_EQ(visited, 0);
+
+  clock = 2;
+
+  storage.unpack<Tracked>(500).value = 0;
+
+  // Reads do not count as writes
+  std::as_const(storage).unpack<float>(900);
+
+  storage.each_changed<Tracked>(1, [&visited](auto& it)
+    {
+      ASSERT_EQ(*it / 64, 500 / 64);
+      ++visited;
+    });
+
+  ASSERT_EQ(visited, 64);
+  ASSERT_EQ(storage.version<Tracked>(500), 2);
+  ASSERT_EQ(storage.version<float>(500), 1);
+
+  visited = 0;
+  storage.each_changed<float>(1, count);
+
+  ASSERT_EQ(visited, 0);
+
+  clock = 3;
+
+  // The last row is moved to the erased one
+  storage.erase(10);
+
+  visited = 0;
+  storage.each_changed<float>(2, count);
+
+  ASSERT_EQ(visited, 64);
+  ASSERT_EQ(storage.version<float>(999), 3);
+}
+
+TEST(Storage, EachDirty_ErasesAndSort_BitsFollowEntities)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Dirty, float>>;
+
+  storage_type storage;
+
+  for (entity_type i = 0; i < 1000; i++) storage.insert(i, Dirty { i });
+
+  size_t visited = 0;
+
+  // Inserted components are dirty
+  storage.each_dirty<Dirty>([&visited](auto&)
+    { ++visited; });
+
+  ASSERT_EQ(visited, 1000);
+
+  storage.clear_dirty<Dirty>();
+
+  visited = 0;
+  storage.each_dirty<Dirty>([&visited](auto&)
+    { ++visited; });
+
+  ASSERT_EQ(visited, 0);
+
+  const auto expected = [](const entity_type entity)
+  { return entity % 20 == 0 || entity >= 990; };
+
+  for (entity_type i = 0; i < 1000; i++)
+  {
+    if (i % 20 == 0) storage.mark_dirty<Dirty>(i);
+    else if (i >= 990)
+      storage.unpack<Dirty>(i).value = i;
+  }
+
+  // The last rows are dirty and are moved into the erased ones
+  for (entity_type i = 1; i < 200; i += 2) storage.erase(i);
+
+  storage.sort_by([](auto it)
+    { return it.template unpack<Dirty>().value % 7; });
+
+  std::vector<entity_type> dirty;
+
+  storage.each_dirty<Dirty>([&dirty](auto& it)
+    {
+      ASSERT_EQ(it.template unpack<Dirty>().value, *it);
+      dirty.push_back(*it);
+    });
+
+  std::vector<entity_type> remaining;
+
+  for (entity_type i = 0; i < 1000; i++)
+  {
+    if (i < 200 && i % 2 == 1) continue;
+
+    ASSERT_EQ(storage.dirty<Dirty>(i), expected(i));
+
+    if (expected(i)) remaining.push_back(i);
+  }
+
+  std::sort(dirty.begin(), dirty.end());
+
+  ASSERT_EQ(dirty, remaining);
+}
+
+TEST(Storage, EachDirty_AfterShrink_OnlyRemainingRowsScanned)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<Dirty, float>>;
+
+  storage_type storage;
+
+  // Enough rows for the summary to cover many words
+  for (entity_type i = 0; i < 5000; i++) storage.insert(i, Dirty { i });
+
+  for (entity_type i = 10; i < 5000; i++) storage.erase(i);
+
+  storage.shrink_to_fit();
+
+  storage.clear_dirty<Dirty>();
+
+  storage.mark_dirty<Dirty>(3);
+
+  std::vector<entity_type> dirty;
+
+  storage.each_dirty<Dirty>([&dirty](auto& it)
+    { dirty.push_back(*it); });
+
+  ASSERT_EQ(dirty, (std::vector<entity_type> { 3 }));
+}
+
+TEST(StorageSharedSparseArray, Transfer_DeferredSource_DeadRowNotContained)
+{
+  using entity_type = unsigned int;
+  using sparse_type = sparse_array<entity_type>;
+  using source_type = storage<entity_type, archetype<Deferred, std::string>>;
+  using destination_type = storage<entity_type, archetype<Deferred>>;
+
+  sparse_type shared;
+
+  source_type source;
+  destination_type destination;
+
+  source.share(&shared);
+  destination.share(&shared);
+
+  source.insert(0, Deferred { 0 }, std::string { "Test0" });
+  source.insert(1, Deferred { 1 }, std::string { "Test1" });
+
+  // The entity gets the same row in the destination as its dead row in the source
+  source.transfer(0, destination);
+
+  ASSERT_FALSE(source.contains(0));
+  ASSERT_TRUE(destination.contains(0));
+  ASSERT_EQ(source.size(), 1);
+
+  source.compact();
+
+  ASSERT_EQ(source.rows(), 1);
+  ASSERT_TRUE(source.contains(1));
+  ASSERT_EQ(source.unpack<std::string>(1), "Test1");
+  ASSERT_EQ(destination.unpack<Deferred>(0).value, 0);
+}